@@ -1,13 +1,16 @@
 #include "kvoice/kvoice.hpp"
 
+#include <cmath>
+#include <iterator>
 #include <sstream>
 #include <thread>
 #include <chrono>
 
 constexpr float radius = 5.f;
 
-std::unique_ptr<kvoice::stream> s1{};
-std::unique_ptr<kvoice::stream> s2{};
+std::unique_ptr<kvoice::voice_source> source{};
+std::unique_ptr<kvoice::stream>       s1{};
+std::unique_ptr<kvoice::stream>       s2{};
 
 bool s1_active = true;
 bool s2_active = true;
@@ -19,53 +22,67 @@ int main() {
     constexpr auto frames_per_buffer = 420;
     constexpr auto bitrate = 16000;
 
+    // output is opened in background while the input starts
+    kvoice::sound_output_options output_options;
+    output_options.stream_pool_size = 1;
+    auto output_future = kvoice::create_sound_output_async("", sample_rate, 32, output_options);
+
     auto [sound_input, error_msg] = kvoice::create_sound_input("", sample_rate, frames_per_buffer, bitrate);
 
-    sound_input->set_input_callback([](const void* buffer, std::size_t count) {
-        if (s1 && s1_active) s1->push_opus_buffer(buffer, count);
-        if (s2 && s2_active) s2->push_opus_buffer(buffer, count);
+    sound_input->set_input_callback([](const void* buffer, std::size_t count, kvoice::timestamp_t capture_time) {
+        if (source) source->push_opus_buffer(buffer, count, capture_time);
     });
     sound_input->set_raw_input_callback([](const void*, std::size_t, float) {
     });
+    sound_input->add_processor(kvoice::create_high_pass_filter(80.f));
+    sound_input->add_processor(kvoice::create_noise_gate(-50.f, 300));
     sound_input->enable_input();
 
-    auto [sound_output, error_msg1] = kvoice::create_sound_output("", sample_rate, 32);
+    auto [sound_output, error_msg1] = output_future.get();
 
     s1 = sound_output->create_stream();
     s1->set_max_distance(100.f);
     s1->set_max_distance(30.f);
 
-    s2 = sound_output->create_stream();
+    kvoice::stream_options low_latency_options;
+    low_latency_options.mode = kvoice::playback_mode::callback;
+    s2 = sound_output->create_stream(low_latency_options);
     s2->set_max_distance(100.f);
     s2->set_min_distance(30.f);
 
+    // both streams render the same speaker, so packets are decoded once
+    source = sound_output->create_voice_source();
+    source->attach(*s1);
+    source->attach(*s2);
+
     sound_output->set_my_position({ 0.f, 0.f, 0.f });
     sound_output->set_my_velocity({ 0.f, 0.f, 0.f });
 
     sound_output->set_my_orientation_front({ 0.f, 0.f, 1.f });
     sound_output->set_my_orientation_up({ 1.f, 0.f, 0.f });
+    sound_output->set_culling(true, 0.f);
 
     sound_output->update_me();
 
-    std::thread([]() {
+    std::thread([output = sound_output.get()]() {
         while (true) {
             std::this_thread::sleep_for(std::chrono::milliseconds(20));
             pos_on_circle += 0.02f;
-            float x = radius * cosf(pos_on_circle);
-            float y = radius * -sinf(pos_on_circle);
-            float z = 0;
-            s1->set_position({ x, y, z });
-            s1->set_velocity({ 0.0f, 0.0f, 0.0f });
-            s1->set_direction({ 0.0f, 0.0f, 1.0f });
+
+            // transforms of all streams are applied in one batch
+            kvoice::stream* const streams[]{ s1.get(), s2.get() };
+            const kvoice::vector positions[]{
+                { radius * cosf(pos_on_circle), radius * -sinf(pos_on_circle), 0.f },
+                { radius * cosf(pos_on_circle + 1.5f), radius * -sinf(pos_on_circle + 1.5f), 0.f }
+            };
+            const kvoice::vector velocities[]{ { 0.f, 0.f, 0.f }, { 0.f, 0.f, 0.f } };
+            const kvoice::vector directions[]{ { 0.f, 0.f, 1.f }, { 0.f, 0.f, 1.f } };
+
+            output->set_stream_transforms(streams, positions, velocities, directions, std::size(streams));
+            output->commit_transforms();
+
             if (!s1->update())
                 return 1;
-
-            x = radius * cosf(pos_on_circle + 1.5f);
-            y = radius * -sinf(pos_on_circle + 1.5f);
-            z = 0;
-            s2->set_position({ x, y, z });
-            s2->set_velocity({ 0.0f, 0.0f, 0.0f });
-            s2->set_direction({ 0.0f, 0.0f, 1.0f });
             if (!s2->update())
                 return 1;
         }
@@ -73,8 +90,14 @@ int main() {
 
     while (true) {
         int key = getchar();
-        if (key == '1') s1_active = !s1_active;
-        if (key == '2') s2_active = !s2_active;
+        if (key == '1') {
+            s1_active = !s1_active;
+            s1->set_gain(s1_active ? 1.f : 0.f);
+        }
+        if (key == '2') {
+            s2_active = !s2_active;
+            s2->set_gain(s2_active ? 1.f : 0.f);
+        }
 
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
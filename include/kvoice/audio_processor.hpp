@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kvoice {
+/**
+ * @brief processing stage of capture chain
+ * @details processors run on the capture thread in the order they were inserted, right before encoding.
+ * One processor instance should be inserted into one chain only.
+ */
+class audio_processor {
+public:
+    /**
+     * @brief destructor
+     */
+    virtual ~audio_processor() = default;
+
+    /**
+     * @brief prepares processor for a format, called on the inserting thread before the processor is used
+     * @details all allocations should be done here
+     * @param sample_rate sampling rate of processed frames
+     * @param frame_size count of samples in every processed frame
+     */
+    virtual void prepare(std::uint32_t sample_rate, std::size_t frame_size) = 0;
+
+    /**
+     * @brief processes frame in place, called on the capture thread
+     * @details shouldn't allocate memory, lock or block
+     * @param samples frame samples
+     * @param count count of samples in @p samples, equals to frame size passed to @p prepare
+     */
+    virtual void process(float* samples, std::size_t count) = 0;
+};
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string_view>
+
+namespace kvoice {
+/**
+ * @brief kind of audio device
+ */
+enum class device_type {
+    input,
+    output
+};
+
+/**
+ * @brief change of system device list
+ */
+enum class device_event {
+    added,
+    removed,
+    default_changed
+};
+
+/**
+ * @brief type of user defined callback that being called after device list change
+ * @param type kind of changed device
+ * @param event kind of change
+ * @param device_name name of added or removed device, or name of new default device
+ */
+using on_device_event_t = void(device_type type, device_event event, std::string_view device_name);
+}
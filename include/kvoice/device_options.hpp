@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#include "latency_profile.hpp"
+#include "sample_format.hpp"
+#include "stream.hpp"
+
+namespace kvoice {
+/**
+ * @brief type of user defined callback that being called on library thread start, before the thread does any work
+ * @param thread_name name of the thread
+ * @param realtime true if requested realtime scheduling was applied
+ */
+using on_thread_start_t = void(std::string_view thread_name, bool realtime);
+
+/**
+ * @brief scheduling policy of library thread
+ */
+enum class thread_scheduling {
+    /**
+     * @brief default system scheduling
+     */
+    normal,
+    /**
+     * @brief realtime first in first out(SCHED_FIFO, time critical priority on windows)
+     */
+    fifo,
+    /**
+     * @brief realtime round robin(SCHED_RR, time critical priority on windows)
+     */
+    round_robin
+};
+
+/**
+ * @brief options of thread owned by the library
+ */
+struct thread_options {
+    /**
+     * @brief thread name visible in debuggers and profilers(truncated to 15 characters on linux)
+     */
+    std::string name;
+    /**
+     * @brief mask of CPUs the thread may run on, 0 to keep system default
+     */
+    std::uint64_t affinity_mask{ 0 };
+    /**
+     * @brief scheduling policy, thread keeps normal scheduling if realtime one isn't permitted
+     */
+    thread_scheduling scheduling{ thread_scheduling::normal };
+    /**
+     * @brief realtime priority, clamped to the range supported by the policy
+     */
+    int priority{ 0 };
+    /**
+     * @brief user callback(called on the started thread)
+     */
+    std::function<on_thread_start_t> on_start{};
+};
+
+/**
+ * @brief additional options of created sound output
+ */
+struct sound_output_options {
+    /**
+     * @brief resource of device memory, streams, voice sources and codec states(default resource if nullptr)
+     * @details should outlive the device, allocations may be done from several threads
+     */
+    std::pmr::memory_resource* memory_resource{ nullptr };
+    /**
+     * @brief count of streams created together with the device
+     * @details @p create_stream with @p pooled_stream_options takes a stream from the pool, so it doesn't open
+     * decoder and OpenAL buffers on the calling thread. Pool isn't refilled.
+     */
+    std::uint32_t stream_pool_size{ 0 };
+    /**
+     * @brief options of pooled streams
+     */
+    stream_options pooled_stream_options{};
+    /**
+     * @brief options of thread that creates the device for asynchronous creation
+     */
+    thread_options open_thread{ "kvoice-open" };
+    /**
+     * @brief create loopback output(ALC_SOFT_loopback), that is mixed by @p sound_output::render
+     * @details device name is ignored, sampling rate should be set
+     */
+    bool loopback{ false };
+    /**
+     * @brief buffering of streams, can be changed later by @p sound_output::set_latency_profile
+     */
+    latency_profile latency{ latency_profile::balanced };
+};
+
+/**
+ * @brief additional options of created sound input
+ */
+struct sound_input_options {
+    /**
+     * @brief format of samples captured from the device
+     * @details int16 halves capture buffer memory, samples are converted to float for processing and encoding
+     */
+    sample_format capture_format{ sample_format::float32 };
+    /**
+     * @brief options of capture and encoding thread
+     */
+    thread_options capture_thread{ "kvoice-capture" };
+    /**
+     * @brief options of thread that opens devices for asynchronous device change
+     */
+    thread_options device_thread{ "kvoice-device" };
+    /**
+     * @brief resource of device memory, capture buffers and encoder state(default resource if nullptr)
+     * @details should outlive the device
+     */
+    std::pmr::memory_resource* memory_resource{ nullptr };
+    /**
+     * @brief options of thread that creates the device for asynchronous creation
+     */
+    thread_options open_thread{ "kvoice-open" };
+    /**
+     * @brief encoder mode, can be changed later by @p sound_input::set_latency_profile
+     */
+    latency_profile latency{ latency_profile::balanced };
+};
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+namespace kvoice {
+/**
+ * @brief timestamp in microseconds since @p std::chrono::steady_clock epoch
+ * @details timestamps received from remote peers should be converted to the local clock before passing them to kvoice
+ */
+using timestamp_t = std::int64_t;
+
+/**
+ * @brief returns current timestamp
+ * @return microseconds since @p std::chrono::steady_clock epoch
+ */
+inline timestamp_t get_timestamp() noexcept {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief type of user defined clock, that replaces steady clock inside the library(e.g. virtual time of replay)
+ * @return microseconds
+ */
+using clock_source_t = timestamp_t (*)() noexcept;
+
+/**
+ * @brief converts count of samples to duration in microseconds
+ * @param samples count of samples
+ * @param sample_rate sampling rate of samples
+ * @return duration in microseconds
+ */
+constexpr timestamp_t samples_to_timestamp(std::int64_t samples, std::int64_t sample_rate) noexcept {
+    return samples * 1000000 / sample_rate;
+}
+}
@@ -1,8 +1,17 @@
 ﻿#pragma once
 
 #include "sound_input.hpp"
+#include "audio_processor.hpp"
 #include "sound_output.hpp"
+#include "opus_packet.hpp"
+#include "device_events.hpp"
+#include "device_options.hpp"
+#include "recorder.hpp"
+#include "packet_trace.hpp"
+#include "mixer.hpp"
 
+#include <functional>
+#include <future>
 #include <vector>
 #include <string>
 
@@ -25,13 +34,13 @@ namespace kvoice {
  * @brief for internal usage
  * @details constructs a new view to string at current enumerator pos and increments enumerator by its size
  * useful for splitting OpenAL device list into strings
- * @param enumerator strings split with two \0
+ * @param enumerator strings split with \0, list ends with two \0
  * @return view to a string at current enumerator pos
  */
 inline std::string_view get_next_str(const char*& enumerator) {
     if (enumerator && *enumerator != '\0') {
         std::string_view res{ enumerator };
-        enumerator += res.size() + 2;
+        enumerator += res.size() + 1;
         return res;
     }
     return "";
@@ -54,15 +63,47 @@ struct create_sound_device_result {
 };
 
 /**
- * @brief transforms internal OpenAL device list, and returns it
+ * @brief type of user defined callback that being called when asynchronously created output is ready
+ * @param result created device or error message
+ */
+using on_sound_output_created_t = void(create_sound_device_result<sound_output> result);
+/**
+ * @brief type of user defined callback that being called when asynchronously created input is ready
+ * @param result created device or error message
+ */
+using on_sound_input_created_t = void(create_sound_device_result<sound_input> result);
+
+/**
+ * @brief returns cached OpenAL device list, it is refreshed in background
  * @return list of OpenAL input devices
  */
 KVOICE_API std::vector<std::string> get_input_devices();
 /**
- * @brief transforms internal OpenAL device list, and returns it
+ * @brief returns cached OpenAL device list, it is refreshed in background
  * @return list of OpenAL output devices
  */
 KVOICE_API std::vector<std::string> get_output_devices();
+/**
+ * @brief returns cached name of default input device
+ * @return name of default OpenAL input device
+ */
+KVOICE_API std::string get_default_input_device();
+/**
+ * @brief returns cached name of default output device
+ * @return name of default OpenAL output device
+ */
+KVOICE_API std::string get_default_output_device();
+/**
+ * @brief subscribes to device list changes
+ * @param cb user callback(called from background thread)
+ * @return subscription id
+ */
+KVOICE_API std::size_t subscribe_device_events(std::function<on_device_event_t> cb);
+/**
+ * @brief unsubscribes from device list changes
+ * @param subscription_id id returned by @p subscribe_device_events
+ */
+KVOICE_API void unsubscribe_device_events(std::size_t subscription_id);
 
 /**
  * @brief creates OpenAL sound output device
@@ -74,6 +115,42 @@ KVOICE_API std::vector<std::string> get_output_devices();
 KVOICE_API create_sound_device_result<sound_output> create_sound_output(std::string_view device_name,
                                                                         std::uint32_t    sample_rate,
                                                                         std::uint32_t    src_count);
+/**
+ * @brief creates OpenAL sound output device
+ * @param device_name name of output device
+ * @param sample_rate output device sampling rate
+ * @param src_count count of max sound sources
+ * @param options additional output options
+ * @return pointer to sound device if successful, else error message string
+ */
+KVOICE_API create_sound_device_result<sound_output> create_sound_output(std::string_view            device_name,
+                                                                        std::uint32_t               sample_rate,
+                                                                        std::uint32_t               src_count,
+                                                                        const sound_output_options& options);
+/**
+ * @brief creates OpenAL sound output device on background thread
+ * @details device, context, sources, and pooled streams are created on @p options.open_thread
+ * @param device_name name of output device
+ * @param sample_rate output device sampling rate
+ * @param src_count count of max sound sources
+ * @param options additional output options
+ * @return future of pointer to sound device if successful, else error message string
+ */
+KVOICE_API std::future<create_sound_device_result<sound_output>> create_sound_output_async(
+    std::string_view device_name, std::uint32_t sample_rate, std::uint32_t src_count,
+    const sound_output_options& options);
+/**
+ * @brief creates OpenAL sound output device on background thread
+ * @details device, context, sources, and pooled streams are created on @p options.open_thread
+ * @param device_name name of output device
+ * @param sample_rate output device sampling rate
+ * @param src_count count of max sound sources
+ * @param options additional output options
+ * @param cb user callback(called from background thread)
+ */
+KVOICE_API void create_sound_output_async(std::string_view device_name, std::uint32_t sample_rate,
+                                          std::uint32_t src_count, const sound_output_options& options,
+                                          std::function<on_sound_output_created_t> cb);
 /**
  * @brief creates OpenAL sound input device
  * @param device_name name of input device
@@ -86,4 +163,109 @@ KVOICE_API create_sound_device_result<sound_input> create_sound_input(std::strin
                                                                       std::uint32_t    sample_rate,
                                                                       std::uint32_t    frames_per_buffer,
                                                                       std::uint32_t    bitrate);
+/**
+ * @brief creates OpenAL sound input device
+ * @param device_name name of input device
+ * @param sample_rate input device sampling rate
+ * @param frames_per_buffer count of frames captured every tick
+ * @param bitrate input device bitrate
+ * @param options additional input options
+ * @return pointer to sound device if successful, else error message string
+ */
+KVOICE_API create_sound_device_result<sound_input> create_sound_input(std::string_view           device_name,
+                                                                      std::uint32_t              sample_rate,
+                                                                      std::uint32_t              frames_per_buffer,
+                                                                      std::uint32_t              bitrate,
+                                                                      const sound_input_options& options);
+/**
+ * @brief creates OpenAL sound input device on background thread
+ * @details device and encoder are created on @p options.open_thread
+ * @param device_name name of input device
+ * @param sample_rate input device sampling rate
+ * @param frames_per_buffer count of frames captured every tick
+ * @param bitrate input device bitrate
+ * @param options additional input options
+ * @return future of pointer to sound device if successful, else error message string
+ */
+KVOICE_API std::future<create_sound_device_result<sound_input>> create_sound_input_async(
+    std::string_view device_name, std::uint32_t sample_rate, std::uint32_t frames_per_buffer,
+    std::uint32_t    bitrate, const sound_input_options& options);
+/**
+ * @brief creates OpenAL sound input device on background thread
+ * @details device and encoder are created on @p options.open_thread
+ * @param device_name name of input device
+ * @param sample_rate input device sampling rate
+ * @param frames_per_buffer count of frames captured every tick
+ * @param bitrate input device bitrate
+ * @param options additional input options
+ * @param cb user callback(called from background thread)
+ */
+KVOICE_API void create_sound_input_async(std::string_view device_name, std::uint32_t sample_rate,
+                                         std::uint32_t frames_per_buffer, std::uint32_t bitrate,
+                                         const sound_input_options& options,
+                                         std::function<on_sound_input_created_t> cb);
+
+/**
+ * @brief replaces clock used by the library for timestamps, buffering and drift estimation
+ * @details intended for deterministic replay, timestamps passed to the library should come from the same clock.
+ * Should be set before devices are created
+ * @param clock user clock(nullptr restores steady clock)
+ */
+KVOICE_API void set_clock_source(clock_source_t clock);
+
+/**
+ * @brief creates recorder of encoded packets to Ogg Opus files
+ * @param options recorder options
+ * @return recorder
+ */
+KVOICE_API std::unique_ptr<recorder> create_recorder(const recorder_options& options);
+
+/**
+ * @brief opens packet trace written by @p recorder::start_trace
+ * @details file is memory mapped, record cut by unfinished recording is ignored
+ * @param path trace file path
+ * @return opened trace
+ * @throws voice_exception if file can't be opened or isn't a packet trace
+ */
+KVOICE_API std::unique_ptr<packet_trace> open_packet_trace(const std::filesystem::path& path);
+
+/**
+ * @brief creates mixer, that doesn't need audio devices(e.g. for voice server)
+ * @param options mixer options
+ * @return mixer
+ * @throws voice_exception if sampling rate or frame duration isn't supported by opus
+ */
+KVOICE_API std::unique_ptr<mixer> create_mixer(const mixer_options& options);
+
+/**
+ * @brief reads opus packet header and SILK flags without decoding the packet
+ * @param data buffer with opus encoded data
+ * @param count size of @p data
+ * @param sample_rate sampling rate used to calculate sample counts
+ * @param[out] info packet information
+ * @return true if packet is valid, else false
+ */
+KVOICE_API bool inspect_opus_packet(const void* data, std::size_t count, std::int32_t sample_rate,
+                                    opus_packet_info& info);
+
+/**
+ * @brief creates second order high-pass filter for capture processing chain
+ * @param cutoff_frequency cutoff frequency in Hz
+ * @return processor
+ */
+KVOICE_API std::shared_ptr<audio_processor> create_high_pass_filter(float cutoff_frequency);
+/**
+ * @brief creates automatic gain control for capture processing chain
+ * @param target_level_db target RMS level in dBFS
+ * @param max_gain_db max amplification in dB
+ * @return processor
+ */
+KVOICE_API std::shared_ptr<audio_processor> create_automatic_gain_control(float target_level_db, float max_gain_db);
+/**
+ * @brief creates noise gate for capture processing chain
+ * @param threshold_db RMS level in dBFS that opens the gate
+ * @param hold_time_ms time the gate stays open after level drops below the threshold
+ * @return processor
+ */
+KVOICE_API std::shared_ptr<audio_processor> create_noise_gate(float threshold_db, std::uint32_t hold_time_ms);
 }
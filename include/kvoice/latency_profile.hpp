@@ -0,0 +1,21 @@
+#pragma once
+
+namespace kvoice {
+/**
+ * @brief tradeoff between delay and robustness to network jitter and loss
+ */
+enum class latency_profile {
+    /**
+     * @brief small upload chunks and short source queue, playback starts early, encoder runs in low delay mode
+     */
+    ultra_low,
+    /**
+     * @brief moderate buffering for typical networks
+     */
+    balanced,
+    /**
+     * @brief deep buffering for unstable networks, encoder adds in-band FEC
+     */
+    robust
+};
+}
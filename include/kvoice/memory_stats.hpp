@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kvoice {
+/**
+ * @brief snapshot of memory allocated by a device and objects created from it
+ */
+struct memory_stats {
+    /**
+     * @brief bytes that are currently allocated from memory resource
+     */
+    std::size_t bytes_in_use{ 0 };
+    /**
+     * @brief max value of @p bytes_in_use
+     */
+    std::size_t peak_bytes{ 0 };
+    /**
+     * @brief total count of allocations, it doesn't grow in steady state
+     */
+    std::uint64_t allocation_count{ 0 };
+};
+}
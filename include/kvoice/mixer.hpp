@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+
+#include "device_options.hpp"
+#include "kv_vector.hpp"
+#include "memory_stats.hpp"
+
+namespace kvoice {
+/**
+ * @brief id of mixer participant
+ */
+using participant_id = std::uint32_t;
+
+/**
+ * @brief type of user defined callback that receives mixed packet of a listener
+ * @param listener listener id
+ * @param data buffer with opus encoded data
+ * @param size size of @p data
+ */
+using on_mixed_packet_t = void(participant_id listener, const void* data, std::size_t size);
+
+/**
+ * @brief distance attenuation of spatial mixing(inverse distance clamped model of OpenAL)
+ */
+struct mixer_attenuation {
+    /**
+     * @brief distance, that has full gain
+     */
+    float reference_distance{ 1.f };
+    /**
+     * @brief speakers further than this distance aren't mixed
+     */
+    float max_distance{ 50.f };
+    float rolloff_factor{ 1.f };
+};
+
+/**
+ * @brief options of created mixer
+ */
+struct mixer_options {
+    /**
+     * @brief sampling rate of decoding, mixing and encoding(8000, 12000, 16000, 24000 or 48000)
+     */
+    std::uint32_t sample_rate{ 48000 };
+    /**
+     * @brief duration of mixed frame(10, 20, 40 or 60 ms)
+     */
+    std::uint32_t frame_duration_ms{ 20 };
+    /**
+     * @brief bitrate of encoded mixes
+     */
+    std::uint32_t bitrate{ 32000 };
+    /**
+     * @brief count of worker threads, the thread that calls @p mixer::mix_frame works too
+     */
+    std::uint32_t worker_count{ 0 };
+    /**
+     * @brief options of worker threads
+     */
+    thread_options worker_thread{ "kvoice-mixer" };
+    /**
+     * @brief resource of participants, codec states and packet queues(default resource if nullptr)
+     * @details should outlive the mixer
+     */
+    std::pmr::memory_resource* memory_resource{ nullptr };
+};
+
+/**
+ * @brief snapshot of mixer statistics
+ */
+struct mixer_stats {
+    std::size_t participants{ 0 };
+    /**
+     * @brief count of participants, that were heard in the last frame
+     */
+    std::size_t active_speakers{ 0 };
+    std::uint64_t decoded_packets{ 0 };
+    /**
+     * @brief count of frames generated by decoder because the packet didn't arrive in time
+     */
+    std::uint64_t concealed_frames{ 0 };
+    /**
+     * @brief count of packets dropped because the participant queue was full or too long
+     */
+    std::uint64_t dropped_packets{ 0 };
+    /**
+     * @brief count of encoded packets
+     */
+    std::uint64_t encoded_packets{ 0 };
+    /**
+     * @brief count of delivered packets, higher than @p encoded_packets when listeners share the same mix
+     */
+    std::uint64_t delivered_packets{ 0 };
+};
+
+/**
+ * @brief device-free mixer, that decodes packets of many speakers and encodes one mix-minus packet per listener
+ * @details every participant is a speaker and a listener, its own voice is excluded from its mix. Speaker frames
+ * are decoded once and shared by all mixes. Without spatial mixing all listeners, that don't speak, hear the same
+ * mix, so it is encoded once for them. Decoding, mixing and encoding are spread over worker threads.
+ */
+class mixer {
+public:
+    /**
+     * @brief destructor
+     */
+    virtual ~mixer() = default;
+
+    /**
+     * @brief adds participant, it can be called from any thread
+     * @return id of participant
+     */
+    virtual participant_id add_participant() = 0;
+    /**
+     * @brief removes participant, it can be called from any thread
+     * @param id participant id
+     */
+    virtual void remove_participant(participant_id id) = 0;
+
+    /**
+     * @brief queues packet of participant, it can be called from any thread
+     * @param id participant id
+     * @param data buffer with opus encoded data
+     * @param count size of @p data
+     * @return false if participant doesn't exist or its queue is full
+     */
+    virtual bool push_opus_buffer(participant_id id, const void* data, std::size_t count) = 0;
+
+    /**
+     * @brief sets gain of participant voice in mixes of other participants
+     * @param id participant id
+     * @param gain gain
+     */
+    virtual void set_gain(participant_id id, float gain) = 0;
+    /**
+     * @brief sets participant position used by spatial mixing
+     * @param id participant id
+     * @param pos position
+     */
+    virtual void set_position(participant_id id, vector pos) = 0;
+    /**
+     * @brief enables packets for participant, participant that doesn't listen is only a speaker
+     * @param id participant id
+     * @param listening true to receive mixed packets
+     */
+    virtual void set_listening(participant_id id, bool listening) = 0;
+    /**
+     * @brief enables distance attenuation, every listener gets its own mix when it is enabled
+     * @param enabled true to enable spatial mixing
+     * @param attenuation distance model
+     */
+    virtual void set_spatial(bool enabled, const mixer_attenuation& attenuation) = 0;
+
+    /**
+     * @brief mixes one frame and passes packets of all listeners to @p cb
+     * @details should be called every frame duration, @p cb is called on the calling thread
+     * @param cb receiver of packets
+     */
+    virtual void mix_frame(const std::function<on_mixed_packet_t>& cb) = 0;
+
+    /**
+     * @brief returns mixer statistics, can be called from any thread
+     * @return statistics snapshot
+     */
+    virtual mixer_stats get_stats() const = 0;
+    /**
+     * @brief returns memory used by the mixer
+     * @return memory statistics
+     */
+    virtual memory_stats get_memory_stats() const = 0;
+};
+}
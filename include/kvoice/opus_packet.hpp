@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+namespace kvoice {
+/**
+ * @brief coding mode of opus packet
+ */
+enum class opus_mode {
+    silk,
+    hybrid,
+    celt
+};
+
+/**
+ * @brief audio bandwidth of opus packet
+ */
+enum class opus_bandwidth {
+    narrowband,
+    mediumband,
+    wideband,
+    superwideband,
+    fullband
+};
+
+/**
+ * @brief information extracted from opus packet without decoding it
+ */
+struct opus_packet_info {
+    opus_mode      mode{ opus_mode::silk };
+    opus_bandwidth bandwidth{ opus_bandwidth::narrowband };
+    /**
+     * @brief count of coded channels
+     */
+    std::int32_t channels{ 1 };
+    /**
+     * @brief count of opus frames in packet
+     */
+    std::int32_t frame_count{ 0 };
+    /**
+     * @brief samples per frame at requested sampling rate
+     */
+    std::int32_t samples_per_frame{ 0 };
+    /**
+     * @brief total count of samples in packet at requested sampling rate
+     */
+    std::int32_t sample_count{ 0 };
+    /**
+     * @brief true if encoder detected voice in any frame(always true for non-DTX CELT packets)
+     */
+    bool voice_activity{ false };
+    /**
+     * @brief true if packet carries no audio data(discontinuous transmission)
+     */
+    bool is_dtx{ false };
+    /**
+     * @brief true if packet carries forward error correction data for the previous packet
+     */
+    bool has_fec{ false };
+};
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "kv_clock.hpp"
+
+namespace kvoice {
+/**
+ * @brief max size of encoded capture packet(max size of one opus frame)
+ */
+constexpr std::size_t kMaxCapturedPacketSize = 1275;
+
+/**
+ * @brief reader of encoded packets of sound input
+ * @details every subscription has its own read position, so slow subscriber doesn't delay capture or other
+ * subscribers. When subscriber falls behind by more than the input keeps, the oldest packets are skipped and
+ * counted as overflows. Subscription can be used from one thread at a time and should be destroyed before the input
+ */
+class packet_subscription {
+public:
+    /**
+     * @brief destructor, unsubscribes
+     */
+    virtual ~packet_subscription() = default;
+
+    /**
+     * @brief reads the oldest unread packet
+     * @param[out] buffer buffer of at least @p kMaxCapturedPacketSize bytes
+     * @param[out] capture_time timestamp of the moment when first sample of the packet was captured
+     * @return size of packet, 0 if there isn't unread packet
+     */
+    virtual std::size_t read(void* buffer, timestamp_t& capture_time) = 0;
+
+    /**
+     * @brief returns count of packets, that were overwritten before this subscriber read them
+     * @return overflow count
+     */
+    virtual std::uint64_t get_overflows() const = 0;
+};
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kv_clock.hpp"
+#include "sample_format.hpp"
+#include "stream.hpp"
+
+namespace kvoice {
+/**
+ * @brief configuration of traced stream, replayed stream should be created with the same one
+ */
+struct trace_info {
+    /**
+     * @brief opus decoder sampling rate of the stream
+     */
+    std::uint32_t decode_sample_rate{ 0 };
+    /**
+     * @brief mixing rate of the output the stream played to
+     */
+    std::uint32_t mixing_rate{ 0 };
+    /**
+     * @brief playback mode the stream really used
+     */
+    playback_mode mode{ playback_mode::queued };
+    /**
+     * @brief format of the stream buffer
+     */
+    sample_format format{ sample_format::float32 };
+};
+
+/**
+ * @brief type of traced event
+ */
+enum class trace_event_type : std::uint32_t {
+    /**
+     * @brief packet pushed to the stream
+     */
+    packet = 1,
+    /**
+     * @brief call of @p stream::update
+     */
+    update = 2
+};
+
+/**
+ * @brief traced event, packet data points into the mapped trace file
+ */
+struct trace_event {
+    trace_event_type type{ trace_event_type::packet };
+    /**
+     * @brief arrival time of packet or time of update
+     */
+    timestamp_t time{ 0 };
+    /**
+     * @brief capture time passed with the packet, valid if @p has_capture_time is set
+     */
+    timestamp_t capture_time{ 0 };
+    bool        has_capture_time{ false };
+
+    const std::uint8_t* data{ nullptr };
+    std::size_t         size{ 0 };
+};
+
+/**
+ * @brief packet trace opened for replay
+ * @details file is memory mapped, events stay valid while the trace is alive
+ */
+class packet_trace {
+public:
+    virtual ~packet_trace() = default;
+
+    /**
+     * @brief returns configuration of traced stream
+     */
+    [[nodiscard]] virtual const trace_info& get_info() const noexcept = 0;
+    /**
+     * @brief returns traced events sorted by time
+     */
+    [[nodiscard]] virtual const std::vector<trace_event>& get_events() const noexcept = 0;
+};
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "device_options.hpp"
+#include "sound_input.hpp"
+#include "stream.hpp"
+#include "voice_source.hpp"
+
+namespace kvoice {
+/**
+ * @brief what recorder does with packets that don't fit the queue
+ */
+enum class recorder_overflow {
+    /**
+     * @brief dropped packets are skipped, recording becomes shorter than real time
+     */
+    skip,
+    /**
+     * @brief dropped packets are replaced with empty packets of the same duration, that are concealed by decoder
+     */
+    fill_silence
+};
+
+/**
+ * @brief options of created recorder
+ */
+struct recorder_options {
+    /**
+     * @brief policy for packets, that don't fit the queue of recorded source
+     */
+    recorder_overflow overflow{ recorder_overflow::fill_silence };
+    /**
+     * @brief size of data collected for one file write
+     */
+    std::size_t write_buffer_size{ 256 * 1024 };
+    /**
+     * @brief interval of writing queued packets
+     */
+    std::uint32_t write_interval_ms{ 200 };
+    /**
+     * @brief options of I/O thread
+     */
+    thread_options io_thread{ "kvoice-recorder" };
+};
+
+/**
+ * @brief snapshot of recorder statistics
+ */
+struct recorder_stats {
+    /**
+     * @brief count of sources being recorded or traced
+     */
+    std::size_t active_tracks{ 0 };
+    /**
+     * @brief count of packets written to files
+     */
+    std::uint64_t recorded_packets{ 0 };
+    /**
+     * @brief count of packets dropped because of full queue
+     */
+    std::uint64_t dropped_packets{ 0 };
+    /**
+     * @brief count of bytes written to files
+     */
+    std::uint64_t written_bytes{ 0 };
+};
+
+/**
+ * @brief records encoded packets of inputs, streams and voice sources to Ogg Opus files without re-encoding,
+ * and packet traces of streams
+ * @details packets are copied to a bounded lock-free queue on the source thread and written to files on background
+ * thread, full queue drops packets instead of blocking. Recording of destroyed source is finished automatically.
+ */
+class recorder {
+public:
+    /**
+     * @brief destructor, finishes all files
+     */
+    virtual ~recorder() = default;
+
+    /**
+     * @brief starts recording of packets encoded by the input(replaces previous recording of the input)
+     * @param input sound input
+     * @param path output file path
+     */
+    virtual void start_recording(sound_input& input, const std::filesystem::path& path) = 0;
+    /**
+     * @brief starts recording of packets pushed to the stream(replaces previous recording of the stream)
+     * @param s stream
+     * @param path output file path
+     */
+    virtual void start_recording(stream& s, const std::filesystem::path& path) = 0;
+    /**
+     * @brief starts recording of packets pushed to the voice source(replaces previous recording of the source)
+     * @param source voice source
+     * @param path output file path
+     */
+    virtual void start_recording(voice_source& source, const std::filesystem::path& path) = 0;
+
+    /**
+     * @brief stops recording of the input, queued packets are still written
+     * @param input sound input
+     */
+    virtual void stop_recording(sound_input& input) = 0;
+    /**
+     * @brief stops recording of the stream, queued packets are still written
+     * @param s stream
+     */
+    virtual void stop_recording(stream& s) = 0;
+    /**
+     * @brief stops recording of the voice source, queued packets are still written
+     * @param source voice source
+     */
+    virtual void stop_recording(voice_source& source) = 0;
+
+    /**
+     * @brief starts packet trace of the stream(replaces previous trace of the stream)
+     * @details trace stores every pushed packet with its arrival and capture times and times of stream updates,
+     * it is read by @p open_packet_trace and replayed with the same jitter and update timing
+     * @param s stream
+     * @param path output file path
+     */
+    virtual void start_trace(stream& s, const std::filesystem::path& path) = 0;
+    /**
+     * @brief stops packet trace of the stream, queued events are still written
+     * @param s stream
+     */
+    virtual void stop_trace(stream& s) = 0;
+
+    /**
+     * @brief returns recorder statistics, can be called from any thread
+     * @return statistics snapshot
+     */
+    virtual recorder_stats get_stats() const = 0;
+};
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+namespace kvoice {
+/**
+ * @brief format of stored and transferred PCM samples
+ */
+enum class sample_format {
+    /**
+     * @brief 32-bit float samples in range [-1, 1]
+     */
+    float32,
+    /**
+     * @brief signed 16-bit integer samples, half of float memory and bandwidth
+     */
+    int16
+};
+}
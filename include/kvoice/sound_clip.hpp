@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "kv_vector.hpp"
+
+namespace kvoice {
+/**
+ * @brief parameters of one clip playback
+ */
+struct clip_play_options {
+    float gain{ 1.f };
+    /**
+     * @brief playback speed, changes pitch too
+     */
+    float pitch{ 1.f };
+    /**
+     * @brief false to play the clip at the listener without attenuation(UI sounds)
+     */
+    bool spatial{ false };
+    vector position{ 0.f, 0.f, 0.f };
+    vector velocity{ 0.f, 0.f, 0.f };
+    float min_distance{ 0.f };
+    float max_distance{ 100.f };
+    float rolloff_factor{ 1.f };
+};
+
+/**
+ * @brief short sound decoded once and kept in OpenAL buffer of the output, that loaded it
+ * @details clip is immutable and can be played many times at once, each playback takes a source from the pool
+ * shared with streams. Clip should be destroyed before the output
+ */
+class sound_clip {
+public:
+    /**
+     * @brief destructor
+     */
+    virtual ~sound_clip() = default;
+
+    /**
+     * @brief returns count of samples at output mixing rate
+     */
+    virtual std::size_t get_sample_count() const = 0;
+    /**
+     * @brief returns clip duration in ms
+     */
+    virtual std::uint32_t get_duration_ms() const = 0;
+};
+}
@@ -1,5 +1,13 @@
 #pragma once
 #include <functional>
+#include <memory>
+#include <string_view>
+
+#include "kv_clock.hpp"
+#include "audio_processor.hpp"
+#include "latency_profile.hpp"
+#include "memory_stats.hpp"
+#include "packet_subscription.hpp"
 
 namespace kvoice {
 /**
@@ -9,12 +17,25 @@ namespace kvoice {
  */
 using on_voice_input_t = void(const void* buffer, std::size_t size);
 /**
- * @brief type of user defined callback that being called before processing
- * @param buffer buffer with raw data
+ * @brief type of user defined callback that being called after processing
+ * @param buffer buffer with data
  * @param size size of @p buffer
+ * @param capture_time timestamp of the moment when first sample of the frame was captured
+ */
+using on_voice_input_timed_t = void(const void* buffer, std::size_t size, timestamp_t capture_time);
+/**
+ * @brief type of user defined callback that being called before processing
+ * @param buffer buffer with raw data(samples in capture format)
+ * @param size count of samples in @p buffer
  * @param mic_level max input volume
  */
 using on_voice_raw_input = void(const void* buffer, std::size_t size, float mic_level);
+/**
+ * @brief type of user defined callback that being called after asynchronous device change
+ * @param success true if new device is used for capture, false if it couldn't be open
+ * @param device_name name of requested device
+ */
+using on_device_changed_t = void(bool success, std::string_view device_name);
 
 class sound_input {
 public:
@@ -39,20 +60,74 @@ public:
      */
     virtual void set_mic_gain(float gain) = 0;
     /**
-     * @brief changes input device immediately
+     * @brief sets encoder mode
+     * @details encoder is reinitialized by capture thread before the next frame, so one frame may click
+     * @param profile latency profile
+     */
+    virtual void set_latency_profile(latency_profile profile) = 0;
+    /**
+     * @brief opens new input device on calling thread, capture switches to it at the next frame boundary
      * @param device_name new device name
-     * @throws voice_exception if device couldn't be open
+     * @throws voice_exception if device couldn't be open(previous device is kept)
      */
     virtual void change_device(std::string_view device_name) = 0;
     /**
-     * @brief sets input callback(called after applying gain and noise suppression)
+     * @brief opens new input device in background, capture switches to it at the next frame boundary
+     * @details partially captured frame and input state are carried over to the new device,
+     * previous device is kept if the new one couldn't be open
+     * @param device_name new device name
+     * @param cb user callback(called from background thread when the switch is completed or failed)
+     */
+    virtual void change_device_async(std::string_view device_name, std::function<on_device_changed_t> cb) = 0;
+    /**
+     * @brief appends processor to the end of capture processing chain
+     * @details processor is prepared on calling thread, capture thread picks up the new chain without locking
+     * @param processor processor
+     */
+    virtual void add_processor(std::shared_ptr<audio_processor> processor) = 0;
+    /**
+     * @brief inserts processor into capture processing chain
+     * @param index position in chain, processor is appended if @p index is out of chain
+     * @param processor processor
+     */
+    virtual void insert_processor(std::size_t index, std::shared_ptr<audio_processor> processor) = 0;
+    /**
+     * @brief removes processor from capture processing chain
+     * @details returns after capture thread stops using the processor
+     * @param processor processor
+     * @return true if processor was found in chain
+     */
+    virtual bool remove_processor(const std::shared_ptr<audio_processor>& processor) = 0;
+    /**
+     * @brief sets input callback(called after applying gain and processing chain)
+     * @details callback is replaced without locking capture thread, this function returns after capture thread
+     * stops using the previous callback, so it shouldn't be called from the callback
      * @param cb user callback
      */
     virtual void set_input_callback(std::function<on_voice_input_t> cb) = 0;
+    /**
+     * @brief sets input callback with capture timestamps(called after applying gain and processing chain)
+     * @param cb user callback
+     */
+    virtual void set_input_callback(std::function<on_voice_input_timed_t> cb) = 0;
     /**
      * @brief sets raw input callback(called before processing)
      * @param cb user callback
      */
     virtual void set_raw_input_callback(std::function<on_voice_raw_input> cb) = 0;
+
+    /**
+     * @brief subscribes to encoded packets
+     * @details every packet is written once by capture thread, subscribers read it at their own pace, subscribing
+     * and unsubscribing never block capture
+     * @return subscription, destroying it unsubscribes
+     */
+    virtual std::unique_ptr<packet_subscription> subscribe_packets() = 0;
+
+    /**
+     * @brief returns memory used by the device and objects created from it
+     * @return memory statistics
+     */
+    virtual memory_stats get_memory_stats() const = 0;
 };
 }
@@ -2,7 +2,12 @@
 #include "kv_vector.hpp"
 #include <string_view>
 #include <memory>
+#include "latency_profile.hpp"
+#include "sample_format.hpp"
+#include "sound_clip.hpp"
 #include "stream.hpp"
+#include "voice_source.hpp"
+#include "memory_stats.hpp"
 
 namespace kvoice {
 class sound_output {
@@ -55,16 +60,122 @@ public:
      */
     virtual void change_device(std::string_view device_name) = 0;
 
+    /**
+     * @brief stages transforms of many streams, only changed values are applied by @p commit_transforms
+     * @details arrays are parallel, element i of every array belongs to @p streams[i]
+     * @param streams streams created by this output
+     * @param positions new positions(nullptr to keep current)
+     * @param velocities new velocities(nullptr to keep current)
+     * @param directions new directions(nullptr to keep current)
+     * @param count count of elements in every array
+     */
+    virtual void set_stream_transforms(stream* const* streams, const vector* positions, const vector* velocities,
+                                       const vector* directions, std::size_t count) = 0;
+
+    /**
+     * @brief applies staged stream transforms to OpenAL in one deferred batch
+     */
+    virtual void commit_transforms() = 0;
+
+    /**
+     * @brief enables culling of inaudible spatial streams
+     * @details culled streams don't hold a source and don't decode packets, their buffered audio is dropped
+     * at playback rate, so they resume in sync when become audible again
+     * @param enabled true to cull streams, that are silent at the listener position in the current distance model
+     * (with clamped inverse model streams beyond their max distance keep the gain of max distance)
+     * @param min_gain streams with estimated gain below this value are culled too(0 to cull only silent streams)
+     */
+    virtual void set_culling(bool enabled, float min_gain) = 0;
+
     /**
      * @brief sets output buffering time
+     * @details streams wait until this much audio is buffered before playback and then keep buffered audio near
+     * this level by changing tempo without changing pitch. Levels of latency profile are used if they are higher
      * @param time_ms time in ms
      */
     virtual void set_buffering_time(std::uint32_t time_ms) = 0;
 
+    /**
+     * @brief sets upload chunk size, source queue depth and buffer levels of all streams
+     * @details existing streams use new profile from their next update
+     * @param profile latency profile
+     */
+    virtual void set_latency_profile(latency_profile profile) = 0;
+
     /**
      * @brief creates new stream on output
      * @return pointer to stream
      */
     virtual std::unique_ptr<stream> create_stream() = 0;
+    /**
+     * @brief creates new stream on output
+     * @param options stream options
+     * @return pointer to stream
+     * @throws voice_exception if options are invalid
+     */
+    virtual std::unique_ptr<stream> create_stream(const stream_options& options) = 0;
+
+    /**
+     * @brief creates new voice source that decodes packets once for all attached streams of this output
+     * @return pointer to voice source
+     */
+    virtual std::unique_ptr<voice_source> create_voice_source() = 0;
+    /**
+     * @brief creates new voice source that decodes packets once for all attached streams of this output
+     * @param decode_sample_rate opus decoder sampling rate(8000, 12000, 16000, 24000 or 48000, 0 for default)
+     * @return pointer to voice source
+     * @throws voice_exception if sampling rate is not supported by opus
+     */
+    virtual std::unique_ptr<voice_source> create_voice_source(std::uint32_t decode_sample_rate) = 0;
+
+    /**
+     * @brief loads PCM clip, it is converted once to output mixing rate and kept in OpenAL buffer
+     * @param samples mono samples
+     * @param count count of samples
+     * @param format format of @p samples
+     * @param sample_rate sampling rate of @p samples
+     * @return loaded clip
+     * @throws voice_exception if clip couldn't be loaded
+     */
+    virtual std::shared_ptr<sound_clip> load_clip(const void* samples, std::size_t count, sample_format format,
+                                                  std::uint32_t sample_rate) = 0;
+    /**
+     * @brief loads opus clip, packets are decoded once and kept in OpenAL buffer
+     * @param packets mono opus packets in playback order
+     * @param sizes sizes of @p packets
+     * @param count count of packets
+     * @return loaded clip
+     * @throws voice_exception if packet couldn't be decoded
+     */
+    virtual std::shared_ptr<sound_clip> load_opus_clip(const void* const* packets, const std::size_t* sizes,
+                                                       std::size_t count) = 0;
+    /**
+     * @brief plays clip once on a source taken from the pool shared with streams
+     * @details source returns to the pool after the clip ends, the clip is kept alive until then
+     * @param clip clip loaded by this output
+     * @param options playback parameters
+     * @return false if there isn't free source
+     */
+    virtual bool play_clip(const std::shared_ptr<sound_clip>& clip, const clip_play_options& options) = 0;
+    /**
+     * @brief stops all playing clips and returns their sources to the pool
+     */
+    virtual void stop_clips() = 0;
+
+    /**
+     * @brief returns memory used by the device and objects created from it
+     * @return memory statistics
+     */
+    virtual memory_stats get_memory_stats() const = 0;
+
+    /**
+     * @brief mixes next block of loopback output
+     * @details loopback output isn't connected to audio hardware, the mixer advances only when this function is
+     * called, so rendering is deterministic
+     * @param samples buffer for interleaved stereo float samples
+     * @param frames count of frames to mix
+     * @return false if the output isn't loopback one
+     */
+    virtual bool render(float* samples, std::uint32_t frames) = 0;
 };
 }
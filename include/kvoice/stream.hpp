@@ -1,9 +1,111 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include "kv_vector.hpp"
+#include "kv_clock.hpp"
+#include "sample_format.hpp"
 
 namespace kvoice {
+/**
+ * @brief level of audio decoded by a stream, measured before stream and output gains
+ */
+struct stream_level {
+    /**
+     * @brief smoothed RMS level, from 0 to 1
+     */
+    float rms{ 0.f };
+    /**
+     * @brief peak level with slow decay, from 0 to 1
+     */
+    float peak{ 0.f };
+    /**
+     * @brief true if RMS level is above speaking threshold, with attack and release timing applied
+     */
+    bool speaking{ false };
+};
+
+/**
+ * @brief snapshot of stream playback statistics
+ */
+struct stream_stats {
+    /**
+     * @brief time from capturing a sample on the sender side to playing it through the speaker, 0 if unknown
+     */
+    timestamp_t mouth_to_ear_latency{ 0 };
+    /**
+     * @brief time from queueing a sample on the source to playing it through the speaker, 0 if unknown
+     */
+    timestamp_t output_latency{ 0 };
+    /**
+     * @brief count of decoded samples that are waiting to be queued on the source
+     */
+    std::size_t buffered_samples{ 0 };
+    /**
+     * @brief current tempo of time-stretch that keeps buffer level near the target, 1 is the normal speed
+     */
+    float playback_speed{ 1.f };
+    /**
+     * @brief estimated rate difference between sender capture clock and local output clock in ppm
+     * @details positive value means the sender produces samples faster than they are played, 0 until it is known
+     */
+    double clock_drift_ppm{ 0.0 };
+    /**
+     * @brief count of received DTX packets, they are not decoded
+     */
+    std::uint64_t dtx_packets{ 0 };
+    /**
+     * @brief count of packets dropped because the stream buffer was full
+     */
+    std::uint64_t dropped_packets{ 0 };
+    /**
+     * @brief count of playback stops caused by empty buffer while packets were still arriving(not DTX or the end of
+     * sender's packets)
+     */
+    std::uint64_t underruns{ 0 };
+    /**
+     * @brief total time playback was stopped by underruns, until it was resumed or the sender went silent
+     */
+    timestamp_t underrun_time{ 0 };
+};
+
+/**
+ * @brief how decoded audio is delivered to the output mixer
+ */
+enum class playback_mode {
+    /**
+     * @brief audio is uploaded in chunks to queued source buffers on @p stream::update
+     */
+    queued,
+    /**
+     * @brief mixer pulls audio from the stream buffer on its own thread(AL_SOFT_callback_buffer)
+     * @details latency doesn't depend on update period and chunk size, queued mode is used if the extension
+     * isn't supported
+     */
+    callback
+};
+
+/**
+ * @brief options of created stream
+ */
+struct stream_options {
+    /**
+     * @brief opus decoder sampling rate(8000, 12000, 16000, 24000 or 48000)
+     * @details decoded audio is resampled once to the output mixing rate, 0 selects the nearest opus rate
+     */
+    std::uint32_t decode_sample_rate{ 0 };
+    /**
+     * @brief how decoded audio is delivered to the output mixer
+     */
+    playback_mode mode{ playback_mode::queued };
+    /**
+     * @brief format of decoded samples in the stream buffer and in source buffers
+     * @details int16 halves stream memory and upload bandwidth, audio is decoded directly to 16-bit samples
+     * when it doesn't need resampling
+     */
+    sample_format format{ sample_format::float32 };
+};
+
 class stream {
 public:
     /**
@@ -18,6 +120,14 @@ public:
      * @return true on success, false on fail
      */
     virtual bool push_opus_buffer(const void* data, std::size_t count) = 0;
+    /**
+     * @brief pushes buffer with data to encoder and then to the sound output
+     * @param data buffer with opus encoded data
+     * @param count size of @p buffer
+     * @param capture_time sender timestamp of the first sample in @p data(in local clock)
+     * @return true on success, false on fail
+     */
+    virtual bool push_opus_buffer(const void* data, std::size_t count, timestamp_t capture_time) = 0;
 
     /**
      * @brief sets source position
@@ -72,5 +182,25 @@ public:
      * @return true on success, false on fail
      */
     virtual bool update() = 0;
+
+    /**
+     * @brief returns playback statistics, can be called from any thread
+     * @return statistics snapshot
+     */
+    virtual stream_stats get_stats() const = 0;
+
+    /**
+     * @brief returns level of received audio, can be called from any thread
+     * @details level is measured while decoded audio is written to the stream buffer, culled stream reports silence
+     * @return level snapshot
+     */
+    virtual stream_level get_level() const = 0;
+    /**
+     * @brief sets speaking detection parameters(-40 dBFS, 30 ms attack and 300 ms release by default)
+     * @param threshold_db RMS level in dBFS that is treated as speaking
+     * @param attack_ms time level should stay above the threshold to start speaking
+     * @param release_ms time level should stay below the threshold to stop speaking
+     */
+    virtual void set_speaking_detection(float threshold_db, std::uint32_t attack_ms, std::uint32_t release_ms) = 0;
 };
 }
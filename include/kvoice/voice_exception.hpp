@@ -17,7 +17,7 @@ public:
 
     ~voice_exception() override = default;
 
-    [[nodiscard]] const char* what() const override { return error_msg.c_str(); }
+    [[nodiscard]] const char* what() const noexcept override { return error_msg.c_str(); }
 };
 
 /**
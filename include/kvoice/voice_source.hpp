@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include "kv_clock.hpp"
+#include "stream.hpp"
+
+namespace kvoice {
+/**
+ * @brief remote speaker that decodes each packet once and feeds it to all attached streams
+ * @details every attached stream applies only its own gain and spatial settings to the shared decoded frame.
+ * Attached streams must not be fed with @p stream::push_opus_buffer, and the source must outlive them
+ */
+class voice_source {
+public:
+    /**
+     * @brief destructor
+     */
+    virtual ~voice_source() = default;
+
+    /**
+     * @brief decodes buffer once and pushes decoded data to every attached stream
+     * @param data buffer with opus encoded data
+     * @param count size of @p buffer
+     * @return true on success, false on fail
+     */
+    virtual bool push_opus_buffer(const void* data, std::size_t count) = 0;
+    /**
+     * @brief decodes buffer once and pushes decoded data to every attached stream
+     * @param data buffer with opus encoded data
+     * @param count size of @p buffer
+     * @param capture_time sender timestamp of the first sample in @p data(in local clock)
+     * @return true on success, false on fail
+     */
+    virtual bool push_opus_buffer(const void* data, std::size_t count, timestamp_t capture_time) = 0;
+
+    /**
+     * @brief attaches stream to the source(detaches it from previous source if any)
+     * @param s stream created by the same output
+     */
+    virtual void attach(stream& s) = 0;
+    /**
+     * @brief detaches stream from the source
+     * @param s previously attached stream
+     */
+    virtual void detach(stream& s) = 0;
+};
+}
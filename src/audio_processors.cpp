@@ -0,0 +1,154 @@
+#include "audio_processors.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "simd.hpp"
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+// level below this is treated as silence by AGC
+constexpr float kNoiseFloorDb = -60.f;
+// max sample value after AGC
+constexpr float kMaxPeak = 0.98f;
+// time constants of gain decrease and increase of AGC
+constexpr double kAttackTime = 0.02;
+constexpr double kReleaseTime = 0.8;
+// time of noise gate fade out
+constexpr double kGateReleaseTime = 0.05;
+
+float db_to_linear(float db) {
+    return std::pow(10.f, db / 20.f);
+}
+
+float frame_rms(const float* samples, std::size_t count) {
+    return count ? std::sqrt(kvoice::simd::dot(samples, samples, count) / static_cast<float>(count)) : 0.f;
+}
+}
+
+kvoice::high_pass_filter::high_pass_filter(float cutoff_frequency)
+    : cutoff_frequency(cutoff_frequency) {
+}
+
+void kvoice::high_pass_filter::prepare(std::uint32_t sample_rate, std::size_t) {
+    // RBJ cookbook high-pass with Q = 1 / sqrt(2)
+    const double w0 = 2.0 * kPi * std::min<double>(cutoff_frequency, sample_rate * 0.45) / sample_rate;
+    const double alpha = std::sin(w0) / std::sqrt(2.0);
+    const double cos_w0 = std::cos(w0);
+    const double a0 = 1.0 + alpha;
+
+    b0 = static_cast<float>((1.0 + cos_w0) / 2.0 / a0);
+    b1 = static_cast<float>(-(1.0 + cos_w0) / a0);
+    b2 = b0;
+    a1 = static_cast<float>(-2.0 * cos_w0 / a0);
+    a2 = static_cast<float>((1.0 - alpha) / a0);
+
+    // response of the block to every input sample and state element separately
+    for (std::size_t j = 0; j < kBlockSize + kStateSize; ++j) {
+        std::array<double, kBlockSize> x{};
+        std::array<double, kStateSize> s{};
+        if (j < kBlockSize)
+            x[j] = 1.0;
+        else
+            s[j - kBlockSize] = 1.0;
+
+        for (std::size_t k = 0; k < kBlockSize; ++k) {
+            const double y = b0 * x[k] + b1 * s[0] + b2 * s[1] - a1 * s[2] - a2 * s[3];
+            s = { x[k], s[0], y, s[2] };
+            block_matrix[j][k] = static_cast<float>(y);
+        }
+    }
+
+    state.fill(0.f);
+}
+
+void kvoice::high_pass_filter::process(float* samples, std::size_t count) {
+    std::size_t i = 0;
+    for (; i + kBlockSize <= count; i += kBlockSize) {
+        float* x = samples + i;
+
+        const std::array<float, kBlockSize + kStateSize> inputs{
+            x[0], x[1], x[2], x[3], state[0], state[1], state[2], state[3]
+        };
+#ifdef KVOICE_SIMD_SSE
+        __m128 y = _mm_setzero_ps();
+        for (std::size_t j = 0; j < inputs.size(); ++j)
+            y = _mm_add_ps(y, _mm_mul_ps(_mm_loadu_ps(block_matrix[j].data()), _mm_set1_ps(inputs[j])));
+        _mm_storeu_ps(x, y);
+#else
+        std::array<float, kBlockSize> y{};
+        for (std::size_t j = 0; j < inputs.size(); ++j) {
+            for (std::size_t k = 0; k < kBlockSize; ++k)
+                y[k] += block_matrix[j][k] * inputs[j];
+        }
+        std::copy(y.begin(), y.end(), x);
+#endif
+        state = { inputs[3], inputs[2], x[3], x[2] };
+    }
+
+    for (; i < count; ++i) {
+        const float x = samples[i];
+        const float y = b0 * x + b1 * state[0] + b2 * state[1] - a1 * state[2] - a2 * state[3];
+        state = { x, state[0], y, state[2] };
+        samples[i] = y;
+    }
+}
+
+kvoice::automatic_gain_control::automatic_gain_control(float target_level_db, float max_gain_db)
+    : target_level(db_to_linear(target_level_db)),
+      max_gain(db_to_linear(max_gain_db)) {
+}
+
+void kvoice::automatic_gain_control::prepare(std::uint32_t sample_rate, std::size_t frame_size) {
+    const double frame_duration = static_cast<double>(frame_size) / sample_rate;
+    attack = static_cast<float>(1.0 - std::exp(-frame_duration / kAttackTime));
+    release = static_cast<float>(1.0 - std::exp(-frame_duration / kReleaseTime));
+    gain = 1.f;
+}
+
+void kvoice::automatic_gain_control::process(float* samples, std::size_t count) {
+    const float rms = frame_rms(samples, count);
+
+    float next_gain = gain;
+    if (rms > db_to_linear(kNoiseFloorDb)) {
+        const float desired = std::min(target_level / rms, max_gain);
+        next_gain += (desired - gain) * (desired < gain ? attack : release);
+    }
+
+    float from = gain;
+    if (const float peak = simd::peak(samples, count); peak > 0.f) {
+        from = std::min(from, kMaxPeak / peak);
+        next_gain = std::min(next_gain, kMaxPeak / peak);
+    }
+
+    simd::ramp(samples, count, from, next_gain);
+    gain = next_gain;
+}
+
+kvoice::noise_gate::noise_gate(float threshold_db, std::uint32_t hold_time_ms)
+    : threshold(db_to_linear(threshold_db)),
+      hold_time_ms(hold_time_ms) {
+}
+
+void kvoice::noise_gate::prepare(std::uint32_t sample_rate, std::size_t frame_size) {
+    const double frame_duration = static_cast<double>(frame_size) / sample_rate;
+    hold_frames = static_cast<std::uint32_t>(std::ceil(hold_time_ms / 1000.0 / frame_duration));
+    release_step = static_cast<float>(std::min(1.0, frame_duration / kGateReleaseTime));
+    frames_left = 0;
+    gain = 0.f;
+}
+
+void kvoice::noise_gate::process(float* samples, std::size_t count) {
+    float target = 0.f;
+    if (frame_rms(samples, count) >= threshold) {
+        frames_left = hold_frames;
+        target = 1.f;
+    } else if (frames_left > 0) {
+        --frames_left;
+        target = 1.f;
+    }
+
+    const float next_gain = target > gain ? target : std::max(target, gain - release_step);
+    simd::ramp(samples, count, gain, next_gain);
+    gain = next_gain;
+}
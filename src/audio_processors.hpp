@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "audio_processor.hpp"
+
+namespace kvoice {
+/**
+ * @brief second order butterworth high-pass filter
+ * @details recursion is unrolled by blocks of four samples, so each block is a product of a constant matrix and
+ * vector of four inputs and filter state, that is calculated with SIMD
+ */
+class high_pass_filter final : public audio_processor {
+    static constexpr std::size_t kBlockSize = 4;
+    // x[n - 1], x[n - 2], y[n - 1], y[n - 2]
+    static constexpr std::size_t kStateSize = 4;
+
+public:
+    explicit high_pass_filter(float cutoff_frequency);
+
+    void prepare(std::uint32_t sample_rate, std::size_t frame_size) override;
+    void process(float* samples, std::size_t count) override;
+
+private:
+    float cutoff_frequency{ 0.f };
+
+    float b0{ 1.f };
+    float b1{ 0.f };
+    float b2{ 0.f };
+    float a1{ 0.f };
+    float a2{ 0.f };
+
+    // column j holds responses of four block outputs to j-th input of block or state
+    std::array<std::array<float, kBlockSize>, kBlockSize + kStateSize> block_matrix{};
+    std::array<float, kStateSize>                                        state{};
+};
+
+/**
+ * @brief automatic gain control, that moves frame RMS level towards the target level
+ * @details gain drops fast on loud input and rises slowly, frames below noise floor keep current gain, gain is
+ * interpolated along the frame and limited to avoid clipping
+ */
+class automatic_gain_control final : public audio_processor {
+public:
+    automatic_gain_control(float target_level_db, float max_gain_db);
+
+    void prepare(std::uint32_t sample_rate, std::size_t frame_size) override;
+    void process(float* samples, std::size_t count) override;
+
+private:
+    float target_level{ 0.f };
+    float max_gain{ 1.f };
+    float attack{ 1.f };
+    float release{ 1.f };
+    float gain{ 1.f };
+};
+
+/**
+ * @brief noise gate, that mutes frames with RMS level below the threshold
+ * @details gate opens in one frame, stays open for the hold time after the level drops and then fades out
+ */
+class noise_gate final : public audio_processor {
+public:
+    noise_gate(float threshold_db, std::uint32_t hold_time_ms);
+
+    void prepare(std::uint32_t sample_rate, std::size_t frame_size) override;
+    void process(float* samples, std::size_t count) override;
+
+private:
+    float         threshold{ 0.f };
+    std::uint32_t hold_time_ms{ 0 };
+    std::uint32_t hold_frames{ 0 };
+    std::uint32_t frames_left{ 0 };
+    float         release_step{ 1.f };
+    float         gain{ 0.f };
+};
+}
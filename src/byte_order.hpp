@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kvoice {
+/**
+ * @brief stores integer in little-endian byte order
+ * @param dst destination, at least sizeof(T) bytes
+ * @param value value
+ */
+template <typename T>
+void put_le(std::uint8_t* dst, T value) noexcept {
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+        dst[i] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(value) >> i * 8);
+}
+
+/**
+ * @brief loads integer stored in little-endian byte order
+ * @param src source, at least sizeof(T) bytes
+ * @return value
+ */
+template <typename T>
+T get_le(const std::uint8_t* src) noexcept {
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+        value |= static_cast<std::uint64_t>(src[i]) << i * 8;
+    return static_cast<T>(value);
+}
+}
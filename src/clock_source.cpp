@@ -0,0 +1,17 @@
+#include "clock_source.hpp"
+
+#include <atomic>
+
+namespace {
+std::atomic<kvoice::clock_source_t> clock_source{ nullptr };
+}
+
+kvoice::timestamp_t kvoice::get_clock_time() noexcept {
+    if (const auto clock = clock_source.load(std::memory_order_relaxed))
+        return clock();
+    return get_timestamp();
+}
+
+void kvoice::set_clock_time_source(clock_source_t clock) noexcept {
+    clock_source.store(clock, std::memory_order_relaxed);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "kv_clock.hpp"
+
+namespace kvoice {
+/**
+ * @brief returns library time, steady clock unless user clock source is set
+ * @return microseconds
+ */
+timestamp_t get_clock_time() noexcept;
+
+/**
+ * @brief replaces clock used by the library
+ * @param clock user clock(nullptr restores steady clock)
+ */
+void set_clock_time_source(clock_source_t clock) noexcept;
+}
@@ -0,0 +1,82 @@
+#include "clock_tracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+kvoice::clock_tracker::clock_tracker(std::int32_t sample_rate, bool detect_lost_frames)
+    : sample_rate(sample_rate),
+      detect_lost_frames(detect_lost_frames) {
+}
+
+void kvoice::clock_tracker::add(timestamp_t time, std::uint64_t position) {
+    const auto frame_duration = position > last_position
+                                    ? samples_to_timestamp(static_cast<std::int64_t>(position - last_position),
+                                                           sample_rate)
+                                    : 0;
+    last_position = position;
+
+    // clock that runs faster than nominal makes offset decrease
+    const timestamp_t offset = time - samples_to_timestamp(static_cast<std::int64_t>(position), sample_rate) -
+                               lost_duration;
+
+    if (current && time - current->start_time >= kBlockDuration)
+        finish_block();
+
+    if (!current) {
+        current = block{ time, offset };
+        return;
+    }
+
+    if (offset < current->min_offset) {
+        current->min_offset = offset;
+        current->outliers = 0;
+    } else if (detect_lost_frames && offset > current->min_offset + kStepThreshold) {
+        // jitter only delays observations, persistent delay means that samples were lost
+        current->outlier_min_offset = current->outliers ? std::min(current->outlier_min_offset, offset) : offset;
+        if (++current->outliers >= kStepConfirmCount)
+            on_step(frame_duration);
+    } else {
+        current->outliers = 0;
+    }
+}
+
+void kvoice::clock_tracker::reset() noexcept {
+    current.reset();
+    previous.reset();
+}
+
+void kvoice::clock_tracker::on_step(timestamp_t frame_duration) {
+    const auto step = current->outlier_min_offset - current->min_offset;
+    const auto frames = frame_duration > 0 ? std::llround(static_cast<double>(step) / frame_duration) : 0;
+
+    // delivery delay that isn't close to a whole count of frames can't be compensated
+    if (frames > 0 && std::llabs(step - frames * frame_duration) < frame_duration / 4) {
+        lost_duration += frames * frame_duration;
+        current->outliers = 0;
+    } else {
+        reset();
+    }
+}
+
+void kvoice::clock_tracker::finish_block() {
+    if (previous) {
+        const auto offset_change = current->min_offset - previous->min_offset;
+
+        if (std::llabs(offset_change) < kStepThreshold) {
+            total_offset += static_cast<double>(offset_change);
+            total_time += static_cast<double>(current->start_time - previous->start_time);
+
+            if (total_time > kWindowDuration) {
+                total_offset /= 2.0;
+                total_time /= 2.0;
+            }
+
+            deviation.store(-total_offset / total_time, std::memory_order_relaxed);
+            observed_time.store(static_cast<timestamp_t>(total_time), std::memory_order_relaxed);
+        }
+    }
+
+    previous = current;
+    current.reset();
+}
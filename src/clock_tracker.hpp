@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+#include "kv_clock.hpp"
+
+namespace kvoice {
+/**
+ * @brief estimates rate of a sample clock against local steady clock
+ * @details offset between local time and sample position is sampled continuously, its minimum over every block
+ * filters out delivery jitter and slope of minimums gives relative rate deviation. Steps that are multiples of frame
+ * duration(lost packets) are compensated, other steps are excluded, so only slow drift is accumulated.
+ * Updated from one thread, results can be read from any thread.
+ */
+class clock_tracker {
+    // duration of block where offset minimum is searched
+    static constexpr timestamp_t kBlockDuration = 1000000;
+    // offset change that is treated as discontinuity
+    static constexpr timestamp_t kStepThreshold = 5000;
+    // count of consecutive observations above the block minimum that confirms discontinuity inside a block
+    static constexpr auto kStepConfirmCount = 25;
+    // older observations are forgotten gradually after this time
+    static constexpr timestamp_t kWindowDuration = 900000000;
+
+    struct block {
+        timestamp_t start_time{ 0 };
+        timestamp_t min_offset{ 0 };
+        timestamp_t outlier_min_offset{ 0 };
+        int         outliers{ 0 };
+    };
+public:
+    /**
+     * @brief Constructor
+     * @param sample_rate nominal sampling rate of the clock
+     * @param detect_lost_frames compensate steps inside blocks that are multiples of frame duration
+     */
+    clock_tracker(std::int32_t sample_rate, bool detect_lost_frames);
+
+    /**
+     * @brief adds an observation
+     * @param time local time of observation
+     * @param position count of samples produced or consumed by the clock since some point
+     */
+    void add(timestamp_t time, std::uint64_t position);
+
+    /**
+     * @brief marks discontinuity, next observation starts a new segment
+     */
+    void reset() noexcept;
+
+    /**
+     * @brief returns relative deviation of clock rate from nominal sampling rate
+     */
+    [[nodiscard]] double get_deviation() const noexcept { return deviation.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief returns time that was used for estimation
+     */
+    [[nodiscard]] timestamp_t get_observed_time() const noexcept {
+        return observed_time.load(std::memory_order_relaxed);
+    }
+
+private:
+    void finish_block();
+    void on_step(timestamp_t frame_duration);
+
+    std::int32_t sample_rate{ 0 };
+    bool         detect_lost_frames{ false };
+
+    std::uint64_t last_position{ 0 };
+    // duration of lost frames that is excluded from offset
+    timestamp_t   lost_duration{ 0 };
+
+    std::optional<block> current{};
+    std::optional<block> previous{};
+
+    double total_offset{ 0.0 };
+    double total_time{ 0.0 };
+
+    std::atomic<double>      deviation{ 0.0 };
+    std::atomic<timestamp_t> observed_time{ 0 };
+};
+}
@@ -0,0 +1,184 @@
+#include "device_registry.hpp"
+
+#include <AL/alc.h>
+#include <AL/alext.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "kvoice.hpp"
+#include "thread_utils.hpp"
+
+namespace {
+// fallback polling period when the implementation doesn't notify about device changes
+constexpr auto kPollPeriod = std::chrono::seconds{ 2 };
+// safety refresh period when device changes are notified
+constexpr auto kEventsRefreshPeriod = std::chrono::seconds{ 30 };
+
+void ALC_APIENTRY on_system_event(ALCenum, ALCenum, ALCdevice*, ALCsizei, const ALCchar*, void* user_param) {
+    // ALC must not be called from the event callback, so enumeration is done on the refresh thread
+    static_cast<kvoice::device_registry*>(user_param)->request_refresh();
+}
+}
+
+kvoice::device_registry& kvoice::device_registry::instance() {
+    static device_registry registry;
+    return registry;
+}
+
+kvoice::device_registry::device_registry()
+    : input_list(enumerate(device_type::input)),
+      output_list(enumerate(device_type::output)) {
+    if (alcIsExtensionPresent(nullptr, "ALC_SOFT_system_events")) {
+        auto event_control = reinterpret_cast<LPALCEVENTCONTROLSOFT>(
+            alcGetProcAddress(nullptr, "alcEventControlSOFT"));
+        auto event_callback = reinterpret_cast<LPALCEVENTCALLBACKSOFT>(
+            alcGetProcAddress(nullptr, "alcEventCallbackSOFT"));
+
+        if (event_control && event_callback) {
+            const ALCenum events[]{
+                ALC_EVENT_TYPE_DEFAULT_DEVICE_CHANGED_SOFT,
+                ALC_EVENT_TYPE_DEVICE_ADDED_SOFT,
+                ALC_EVENT_TYPE_DEVICE_REMOVED_SOFT
+            };
+
+            event_callback(&on_system_event, this);
+            system_events = event_control(static_cast<ALCsizei>(std::size(events)), events, ALC_TRUE) == ALC_TRUE;
+        }
+    }
+
+    refresh_alive = true;
+    refresh_thread = start_thread(thread_options{ "kvoice-registry" }, [this]() { process_refresh(); });
+}
+
+kvoice::device_registry::~device_registry() {
+    if (system_events) {
+        auto event_callback = reinterpret_cast<LPALCEVENTCALLBACKSOFT>(
+            alcGetProcAddress(nullptr, "alcEventCallbackSOFT"));
+        if (event_callback)
+            event_callback(nullptr, nullptr);
+    }
+
+    {
+        std::lock_guard lck(refresh_mutex);
+        refresh_alive = false;
+    }
+    refresh_cv.notify_one();
+    refresh_thread.join();
+}
+
+std::vector<std::string> kvoice::device_registry::get_devices(device_type type) {
+    std::lock_guard lck(lists_mutex);
+    return type == device_type::input ? input_list.devices : output_list.devices;
+}
+
+std::string kvoice::device_registry::get_default_device(device_type type) {
+    std::lock_guard lck(lists_mutex);
+    return type == device_type::input ? input_list.default_device : output_list.default_device;
+}
+
+std::size_t kvoice::device_registry::subscribe(std::function<on_device_event_t> cb) {
+    std::lock_guard lck(subscribers_mutex);
+    const auto id = next_subscriber_id++;
+    subscribers.emplace_back(id, std::move(cb));
+    return id;
+}
+
+void kvoice::device_registry::unsubscribe(std::size_t id) {
+    std::lock_guard lck(subscribers_mutex);
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                     [id](const auto& subscriber) { return subscriber.first == id; }),
+                      subscribers.end());
+}
+
+void kvoice::device_registry::request_refresh() {
+    {
+        std::lock_guard lck(refresh_mutex);
+        refresh_requested = true;
+    }
+    refresh_cv.notify_one();
+}
+
+kvoice::device_registry::device_list kvoice::device_registry::enumerate(device_type type) {
+    device_list result;
+
+    const char* enumerator = nullptr;
+    const char* default_device = nullptr;
+
+    if (alcIsExtensionPresent(nullptr, "ALC_enumeration_EXT")) {
+        if (type == device_type::input) {
+            enumerator = alcGetString(nullptr, ALC_CAPTURE_DEVICE_SPECIFIER);
+            default_device = alcGetString(nullptr, ALC_CAPTURE_DEFAULT_DEVICE_SPECIFIER);
+        } else if (!alcIsExtensionPresent(nullptr, "ALC_enumerate_all_EXT")) {
+            enumerator = alcGetString(nullptr, ALC_DEVICE_SPECIFIER);
+            default_device = alcGetString(nullptr, ALC_DEFAULT_DEVICE_SPECIFIER);
+        } else {
+            enumerator = alcGetString(nullptr, ALC_ALL_DEVICES_SPECIFIER);
+            default_device = alcGetString(nullptr, ALC_DEFAULT_ALL_DEVICES_SPECIFIER);
+        }
+    }
+
+    std::string_view s;
+
+    while (!(s = get_next_str(enumerator)).empty()) {
+        result.devices.emplace_back(s.data(), s.size());
+    }
+
+    if (default_device)
+        result.default_device = default_device;
+
+    return result;
+}
+
+void kvoice::device_registry::process_refresh() {
+    std::unique_lock lck(refresh_mutex);
+
+    while (refresh_alive) {
+        refresh_cv.wait_for(lck, system_events ? kEventsRefreshPeriod : kPollPeriod,
+                            [this]() { return !refresh_alive || refresh_requested; });
+        if (!refresh_alive) return;
+
+        refresh_requested = false;
+
+        lck.unlock();
+        refresh();
+        lck.lock();
+    }
+}
+
+void kvoice::device_registry::refresh() {
+    for (auto type : { device_type::input, device_type::output }) {
+        device_list current = enumerate(type);
+        device_list previous;
+
+        {
+            std::lock_guard lck(lists_mutex);
+            auto&           list = type == device_type::input ? input_list : output_list;
+            previous = std::exchange(list, current);
+        }
+
+        for (const auto& device : previous.devices) {
+            if (std::find(current.devices.begin(), current.devices.end(), device) == current.devices.end())
+                notify(type, device_event::removed, device);
+        }
+        for (const auto& device : current.devices) {
+            if (std::find(previous.devices.begin(), previous.devices.end(), device) == previous.devices.end())
+                notify(type, device_event::added, device);
+        }
+        if (current.default_device != previous.default_device)
+            notify(type, device_event::default_changed, current.default_device);
+    }
+}
+
+void kvoice::device_registry::notify(device_type type, device_event event, std::string_view device_name) {
+    decltype(subscribers) callbacks;
+    {
+        std::lock_guard lck(subscribers_mutex);
+        callbacks = subscribers;
+    }
+
+    // callbacks are called without lock, so they can unsubscribe
+    for (const auto& [id, cb] : callbacks) {
+        cb(type, event, device_name);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "device_events.hpp"
+
+namespace kvoice {
+/**
+ * @brief caches OpenAL device lists and notifies subscribers about their changes
+ * @details lists are refreshed on background thread, on ALC_SOFT_system_events notification if supported,
+ * else periodically
+ */
+class device_registry {
+    struct device_list {
+        std::vector<std::string> devices;
+        std::string              default_device;
+    };
+
+public:
+    static device_registry& instance();
+
+    device_registry(const device_registry&) = delete;
+    device_registry& operator=(const device_registry&) = delete;
+
+    std::vector<std::string> get_devices(device_type type);
+    std::string              get_default_device(device_type type);
+
+    std::size_t subscribe(std::function<on_device_event_t> cb);
+    void        unsubscribe(std::size_t id);
+
+    /**
+     * @brief wakes refresh thread to re-enumerate devices
+     */
+    void request_refresh();
+
+private:
+    device_registry();
+    ~device_registry();
+
+    static device_list enumerate(device_type type);
+
+    void process_refresh();
+    void refresh();
+    void notify(device_type type, device_event event, std::string_view device_name);
+
+    std::mutex  lists_mutex;
+    device_list input_list{};
+    device_list output_list{};
+
+    std::mutex                                                            subscribers_mutex;
+    std::vector<std::pair<std::size_t, std::function<on_device_event_t>>> subscribers{};
+    std::size_t                                                           next_subscriber_id{ 1 };
+
+    std::mutex              refresh_mutex;
+    std::condition_variable refresh_cv;
+    std::thread             refresh_thread;
+    bool                    refresh_requested{ false };
+    bool                    refresh_alive{ false };
+    bool                    system_events{ false };
+};
+}
@@ -1,52 +1,83 @@
 ﻿#include "kvoice.hpp"
 
-#include <alc.h>
-
+#include "audio_processors.hpp"
+#include "clock_source.hpp"
+#include "device_registry.hpp"
 #include "voice_exception.hpp"
 #include "sound_output_impl.hpp"
 #include "sound_input_impl.hpp"
+#include "recorder_impl.hpp"
+#include "mixer_impl.hpp"
+#include "packet_trace_reader.hpp"
+#include "thread_utils.hpp"
 
-std::vector<std::string> kvoice::get_input_devices() {
-    const char* enumerator = nullptr;
-    if (alcIsExtensionPresent(nullptr, "ALC_enumeration_EXT"))
-        enumerator = alcGetString(nullptr, ALC_CAPTURE_DEVICE_SPECIFIER);
-
-    std::vector<std::string> res;
+namespace {
+/**
+ * @brief calls @p create on the thread configured by @p options and passes its result to @p cb
+ */
+template <typename DeviceT, typename F>
+void create_async(const kvoice::thread_options& options, F&& create,
+                  std::function<void(kvoice::create_sound_device_result<DeviceT>)> cb) {
+    kvoice::start_thread(options, [create = std::forward<F>(create), cb = std::move(cb)]() {
+        kvoice::create_sound_device_result<DeviceT> result;
+        try {
+            result = create();
+        } catch (std::exception& e) {
+            result = { nullptr, e.what() };
+        }
+        if (cb) cb(std::move(result));
+    }).detach();
+}
 
-    std::string_view s;
+template <typename DeviceT>
+std::function<void(kvoice::create_sound_device_result<DeviceT>)> make_promise_callback(
+    std::future<kvoice::create_sound_device_result<DeviceT>>& future) {
+    auto promise = std::make_shared<std::promise<kvoice::create_sound_device_result<DeviceT>>>();
+    future = promise->get_future();
+    return [promise](kvoice::create_sound_device_result<DeviceT> result) { promise->set_value(std::move(result)); };
+}
+}
 
-    while (!(s = get_next_str(enumerator)).empty()) {
-        res.emplace_back(s.data(), s.size());
-    }
-    return res;
+std::vector<std::string> kvoice::get_input_devices() {
+    return device_registry::instance().get_devices(device_type::input);
 }
 
 std::vector<std::string> kvoice::get_output_devices() {
-    const char* enumerator = nullptr;
-    if (alcIsExtensionPresent(nullptr, "ALC_enumeration_EXT")) {
-        if (!alcIsExtensionPresent(nullptr, "ALC_enumerate_all_EXT"))
-            enumerator = alcGetString(nullptr, ALC_DEVICE_SPECIFIER);
-        else
-            enumerator = alcGetString(nullptr, ALC_ALL_DEVICES_SPECIFIER);
-    }
+    return device_registry::instance().get_devices(device_type::output);
+}
 
-    std::vector<std::string> res;
+std::string kvoice::get_default_input_device() {
+    return device_registry::instance().get_default_device(device_type::input);
+}
 
-    std::string_view s;
+std::string kvoice::get_default_output_device() {
+    return device_registry::instance().get_default_device(device_type::output);
+}
 
-    while (!(s = get_next_str(enumerator)).empty()) {
-        res.emplace_back(s.data(), s.size());
-    }
+std::size_t kvoice::subscribe_device_events(std::function<on_device_event_t> cb) {
+    return device_registry::instance().subscribe(std::move(cb));
+}
 
-    return res;
+void kvoice::unsubscribe_device_events(std::size_t subscription_id) {
+    device_registry::instance().unsubscribe(subscription_id);
 }
 
 kvoice::create_sound_device_result<kvoice::sound_output> kvoice::create_sound_output(
     std::string_view device_name, std::uint32_t sample_rate,
     std::uint32_t    src_count) {
+    return create_sound_output(device_name, sample_rate, src_count, sound_output_options{});
+}
+
+kvoice::create_sound_device_result<kvoice::sound_output> kvoice::create_sound_output(
+    std::string_view device_name, std::uint32_t sample_rate, std::uint32_t src_count,
+    const sound_output_options& options) {
+    auto* memory = options.memory_resource ? options.memory_resource : std::pmr::get_default_resource();
 
     try {
-        auto output = std::make_unique<sound_output_impl>(device_name, sample_rate, src_count);
+        std::unique_ptr<sound_output_impl> output{ new (memory) sound_output_impl(device_name, sample_rate, src_count,
+                                                                                  memory, options.loopback) };
+        output->set_latency_profile(options.latency);
+        output->fill_stream_pool(options.stream_pool_size, options.pooled_stream_options);
         return { std::move(output), "" };
     } catch (voice_exception& e) {
         return { nullptr, e.what() };
@@ -56,10 +87,84 @@ kvoice::create_sound_device_result<kvoice::sound_output> kvoice::create_sound_ou
 kvoice::create_sound_device_result<kvoice::sound_input> kvoice::create_sound_input(
     std::string_view device_name, std::uint32_t       sample_rate,
     std::uint32_t    frames_per_buffer, std::uint32_t bitrate) {
+    return create_sound_input(device_name, sample_rate, frames_per_buffer, bitrate, sound_input_options{});
+}
+
+kvoice::create_sound_device_result<kvoice::sound_input> kvoice::create_sound_input(
+    std::string_view device_name, std::uint32_t sample_rate, std::uint32_t frames_per_buffer,
+    std::uint32_t    bitrate, const sound_input_options& options) {
     try {
-        auto output = std::make_unique<sound_input_impl>(device_name, sample_rate, frames_per_buffer, bitrate);
+        auto* memory = options.memory_resource ? options.memory_resource : std::pmr::get_default_resource();
+        std::unique_ptr<sound_input_impl> output{ new (memory) sound_input_impl(device_name, sample_rate,
+                                                                                frames_per_buffer, bitrate, options) };
         return { std::move(output), "" };
     } catch (voice_exception& e) {
         return { nullptr, e.what() };
     }
 }
+
+std::future<kvoice::create_sound_device_result<kvoice::sound_output>> kvoice::create_sound_output_async(
+    std::string_view device_name, std::uint32_t sample_rate, std::uint32_t src_count,
+    const sound_output_options& options) {
+    std::future<create_sound_device_result<sound_output>> result;
+    create_sound_output_async(device_name, sample_rate, src_count, options, make_promise_callback(result));
+    return result;
+}
+
+void kvoice::create_sound_output_async(std::string_view device_name, std::uint32_t sample_rate,
+                                       std::uint32_t src_count, const sound_output_options& options,
+                                       std::function<on_sound_output_created_t> cb) {
+    create_async<sound_output>(options.open_thread, [name = std::string{ device_name }, sample_rate, src_count,
+                                                     options]() {
+        return create_sound_output(name, sample_rate, src_count, options);
+    }, std::move(cb));
+}
+
+std::future<kvoice::create_sound_device_result<kvoice::sound_input>> kvoice::create_sound_input_async(
+    std::string_view device_name, std::uint32_t sample_rate, std::uint32_t frames_per_buffer,
+    std::uint32_t    bitrate, const sound_input_options& options) {
+    std::future<create_sound_device_result<sound_input>> result;
+    create_sound_input_async(device_name, sample_rate, frames_per_buffer, bitrate, options,
+                             make_promise_callback(result));
+    return result;
+}
+
+void kvoice::create_sound_input_async(std::string_view device_name, std::uint32_t sample_rate,
+                                      std::uint32_t frames_per_buffer, std::uint32_t bitrate,
+                                      const sound_input_options& options,
+                                      std::function<on_sound_input_created_t> cb) {
+    create_async<sound_input>(options.open_thread, [name = std::string{ device_name }, sample_rate,
+                                                    frames_per_buffer, bitrate, options]() {
+        return create_sound_input(name, sample_rate, frames_per_buffer, bitrate, options);
+    }, std::move(cb));
+}
+
+void kvoice::set_clock_source(clock_source_t clock) {
+    set_clock_time_source(clock);
+}
+
+std::unique_ptr<kvoice::recorder> kvoice::create_recorder(const recorder_options& options) {
+    return std::make_unique<recorder_impl>(options);
+}
+
+std::unique_ptr<kvoice::packet_trace> kvoice::open_packet_trace(const std::filesystem::path& path) {
+    return std::make_unique<packet_trace_reader>(path);
+}
+
+std::unique_ptr<kvoice::mixer> kvoice::create_mixer(const mixer_options& options) {
+    auto* memory = options.memory_resource ? options.memory_resource : std::pmr::get_default_resource();
+    return std::unique_ptr<mixer_impl>{ new (memory) mixer_impl(options) };
+}
+
+std::shared_ptr<kvoice::audio_processor> kvoice::create_high_pass_filter(float cutoff_frequency) {
+    return std::make_shared<high_pass_filter>(cutoff_frequency);
+}
+
+std::shared_ptr<kvoice::audio_processor> kvoice::create_automatic_gain_control(float target_level_db,
+                                                                               float max_gain_db) {
+    return std::make_shared<automatic_gain_control>(target_level_db, max_gain_db);
+}
+
+std::shared_ptr<kvoice::audio_processor> kvoice::create_noise_gate(float threshold_db, std::uint32_t hold_time_ms) {
+    return std::make_shared<noise_gate>(threshold_db, hold_time_ms);
+}
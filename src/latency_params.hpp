@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+#include <opus.h>
+
+#include "kv_clock.hpp"
+#include "latency_profile.hpp"
+
+namespace kvoice {
+/**
+ * @brief playback buffering chosen by latency profile, durations are converted to samples at stream rate
+ */
+struct playback_latency {
+    /**
+     * @brief duration of audio uploaded to one source buffer
+     */
+    timestamp_t   chunk_time;
+    /**
+     * @brief max count of source buffers queued at once
+     */
+    std::uint32_t queue_depth;
+    /**
+     * @brief buffered audio, that starts playback
+     */
+    timestamp_t   start_level;
+    /**
+     * @brief buffer level kept by time-stretch
+     */
+    timestamp_t   target_level;
+};
+
+/**
+ * @brief encoder settings chosen by latency profile
+ */
+struct capture_latency {
+    int  application;
+    bool inband_fec;
+    // loss expected by encoder, controls amount of FEC data
+    int  packet_loss_perc;
+};
+
+constexpr playback_latency get_playback_latency(latency_profile profile) noexcept {
+    switch (profile) {
+    case latency_profile::ultra_low:
+        return { 5000, 4, 20000, 30000 };
+    case latency_profile::robust:
+        return { 40000, 16, 150000, 200000 };
+    case latency_profile::balanced:
+    default:
+        return { 20000, 8, 60000, 80000 };
+    }
+}
+
+constexpr capture_latency get_capture_latency(latency_profile profile) noexcept {
+    switch (profile) {
+    case latency_profile::ultra_low:
+        // CELT-only mode removes SILK lookahead
+        return { OPUS_APPLICATION_RESTRICTED_LOWDELAY, false, 0 };
+    case latency_profile::robust:
+        return { OPUS_APPLICATION_VOIP, true, 10 };
+    case latency_profile::balanced:
+    default:
+        return { OPUS_APPLICATION_VOIP, false, 0 };
+    }
+}
+}
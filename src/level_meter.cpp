@@ -0,0 +1,75 @@
+#include "level_meter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr float kDefaultThresholdDb = -40.f;
+constexpr auto  kDefaultAttackMs = 30u;
+constexpr auto  kDefaultReleaseMs = 300u;
+}
+
+kvoice::level_meter::level_meter(std::int32_t sample_rate)
+    : sample_rate(sample_rate) {
+    set_speaking_detection(kDefaultThresholdDb, kDefaultAttackMs, kDefaultReleaseMs);
+}
+
+void kvoice::level_meter::set_speaking_detection(float threshold_db, std::uint32_t attack_ms,
+                                                 std::uint32_t release_ms) noexcept {
+    threshold_mean_square.store(std::pow(10.f, threshold_db / 10.f), std::memory_order_relaxed);
+    attack_samples.store(static_cast<std::uint32_t>(static_cast<std::uint64_t>(attack_ms) * sample_rate / 1000),
+                         std::memory_order_relaxed);
+    release_samples.store(static_cast<std::uint32_t>(static_cast<std::uint64_t>(release_ms) * sample_rate / 1000),
+                          std::memory_order_relaxed);
+}
+
+void kvoice::level_meter::add(float sum_squares, float peak, std::size_t count) noexcept {
+    if (!count) return;
+
+    const float duration = static_cast<float>(count) / static_cast<float>(sample_rate);
+    const float rms_coef = std::exp(-duration / kRmsTime);
+    const float peak_coef = std::exp(-duration / kPeakDecayTime);
+
+    mean_square = mean_square * rms_coef + sum_squares / static_cast<float>(count) * (1.f - rms_coef);
+    peak_level = std::max(peak, peak_level * peak_coef);
+
+    if (mean_square >= threshold_mean_square.load(std::memory_order_relaxed)) {
+        above_samples += count;
+        below_samples = 0;
+        if (!speaking_state && above_samples >= attack_samples.load(std::memory_order_relaxed))
+            speaking_state = true;
+    } else {
+        below_samples += count;
+        above_samples = 0;
+        if (speaking_state && below_samples >= release_samples.load(std::memory_order_relaxed))
+            speaking_state = false;
+    }
+
+    rms_out.store(std::sqrt(mean_square), std::memory_order_relaxed);
+    peak_out.store(peak_level, std::memory_order_relaxed);
+    speaking_out.store(speaking_state, std::memory_order_relaxed);
+}
+
+kvoice::stream_level kvoice::level_meter::get_level(std::size_t silent_count) const noexcept {
+    stream_level level;
+    level.rms = rms_out.load(std::memory_order_relaxed);
+    level.peak = peak_out.load(std::memory_order_relaxed);
+    level.speaking = speaking_out.load(std::memory_order_relaxed);
+    if (!silent_count) return level;
+
+    // same decay as add_silence, mean square decays with kRmsTime, so RMS decays twice slower
+    const float duration = static_cast<float>(silent_count) / static_cast<float>(sample_rate);
+    const float mean_square_level = level.rms * level.rms;
+    level.rms *= std::exp(-duration / (2.f * kRmsTime));
+    level.peak *= std::exp(-duration / kPeakDecayTime);
+
+    // speaking ends after level falls below the threshold and stays there for release time
+    if (level.speaking) {
+        const float threshold = threshold_mean_square.load(std::memory_order_relaxed);
+        const float crossing = mean_square_level > threshold ? kRmsTime * std::log(mean_square_level / threshold) : 0.f;
+        const float release = static_cast<float>(release_samples.load(std::memory_order_relaxed)) /
+                              static_cast<float>(sample_rate);
+        level.speaking = duration < crossing + release;
+    }
+    return level;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "stream.hpp"
+
+namespace kvoice {
+/**
+ * @brief smoothed RMS and peak level with speaking detection
+ * @details level is updated with block sums that are collected by the gain pass, so audio isn't scanned twice.
+ * Speaking starts after level stays above the threshold for attack time and ends after it stays below the threshold
+ * for release time. Updated from one thread, results can be read from any thread.
+ */
+class level_meter {
+    // integration time of RMS level in seconds
+    static constexpr float kRmsTime = 0.05f;
+    // time of peak level decay by 1/e in seconds
+    static constexpr float kPeakDecayTime = 0.5f;
+public:
+    /**
+     * @brief Constructor
+     * @param sample_rate sampling rate of measured audio
+     */
+    explicit level_meter(std::int32_t sample_rate);
+
+    /**
+     * @brief sets speaking detection parameters, can be called from any thread
+     * @param threshold_db RMS level in dBFS that is treated as speaking
+     * @param attack_ms time level should stay above the threshold to start speaking
+     * @param release_ms time level should stay below the threshold to stop speaking
+     */
+    void set_speaking_detection(float threshold_db, std::uint32_t attack_ms, std::uint32_t release_ms) noexcept;
+
+    /**
+     * @brief adds measured block
+     * @param sum_squares sum of squared samples
+     * @param peak max absolute sample value
+     * @param count count of samples in the block
+     */
+    void add(float sum_squares, float peak, std::size_t count) noexcept;
+
+    /**
+     * @brief adds block of silence(DTX or skipped audio)
+     * @param count count of samples in the block
+     */
+    void add_silence(std::size_t count) noexcept { add(0.f, 0.f, count); }
+
+    /**
+     * @brief returns current level
+     * @param silent_count count of samples of silence that passed after the last added block, level is decayed by
+     * it without changing the meter, so it can be called from any thread
+     */
+    [[nodiscard]] stream_level get_level(std::size_t silent_count = 0) const noexcept;
+
+private:
+    std::int32_t sample_rate{ 0 };
+
+    // threshold is compared with mean square, so no root or logarithm is taken per block
+    std::atomic<float>         threshold_mean_square{ 0.f };
+    std::atomic<std::uint32_t> attack_samples{ 0 };
+    std::atomic<std::uint32_t> release_samples{ 0 };
+
+    float       mean_square{ 0.f };
+    float       peak_level{ 0.f };
+    bool        speaking_state{ false };
+    std::size_t above_samples{ 0 };
+    std::size_t below_samples{ 0 };
+
+    std::atomic<float> rms_out{ 0.f };
+    std::atomic<float> peak_out{ 0.f };
+    std::atomic<bool>  speaking_out{ false };
+};
+}
@@ -0,0 +1,52 @@
+#include "memory.hpp"
+
+namespace {
+/**
+ * @brief stored in front of object allocated by @p resource_allocated
+ */
+struct allocation_header {
+    std::pmr::memory_resource* resource{ nullptr };
+    std::size_t                size{ 0 };
+};
+
+constexpr std::size_t kHeaderSize = (sizeof(allocation_header) + alignof(std::max_align_t) - 1) /
+                                    alignof(std::max_align_t) * alignof(std::max_align_t);
+
+allocation_header* get_header(void* ptr) {
+    return reinterpret_cast<allocation_header*>(static_cast<std::byte*>(ptr) - kHeaderSize);
+}
+}
+
+void* kvoice::counting_resource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    void* result = upstream->allocate(bytes, alignment);
+
+    const auto in_use = bytes_in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+    auto peak = peak_bytes.load(std::memory_order_relaxed);
+    while (in_use > peak && !peak_bytes.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {
+    }
+    return result;
+}
+
+void kvoice::counting_resource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+    upstream->deallocate(p, bytes, alignment);
+    bytes_in_use.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void* kvoice::resource_allocated::operator new(std::size_t size, std::pmr::memory_resource* resource) {
+    void* memory = resource->allocate(size + kHeaderSize, alignof(std::max_align_t));
+    new (memory) allocation_header{ resource, size + kHeaderSize };
+    return static_cast<std::byte*>(memory) + kHeaderSize;
+}
+
+void kvoice::resource_allocated::operator delete(void* ptr, std::pmr::memory_resource*) noexcept {
+    operator delete(ptr);
+}
+
+void kvoice::resource_allocated::operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+
+    const allocation_header header = *get_header(ptr);
+    header.resource->deallocate(get_header(ptr), header.size, alignof(std::max_align_t));
+}
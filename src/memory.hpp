@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <queue>
+#include <utility>
+
+#include "memory_stats.hpp"
+
+namespace kvoice {
+/**
+ * @brief memory resource, that counts bytes allocated from upstream resource
+ */
+class counting_resource final : public std::pmr::memory_resource {
+public:
+    /**
+     * @brief Constructor
+     * @param upstream resource that provides memory(default resource if nullptr)
+     */
+    explicit counting_resource(std::pmr::memory_resource* upstream)
+        : upstream(upstream ? upstream : std::pmr::get_default_resource()) {
+    }
+
+    [[nodiscard]] memory_stats get_stats() const noexcept {
+        memory_stats stats;
+        stats.bytes_in_use = bytes_in_use.load(std::memory_order_relaxed);
+        stats.peak_bytes = peak_bytes.load(std::memory_order_relaxed);
+        stats.allocation_count = allocation_count.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void  do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    std::pmr::memory_resource* upstream{ nullptr };
+
+    std::atomic<std::size_t>   bytes_in_use{ 0 };
+    std::atomic<std::size_t>   peak_bytes{ 0 };
+    std::atomic<std::uint64_t> allocation_count{ 0 };
+};
+
+template <typename T>
+using pmr_queue = std::queue<T, std::pmr::deque<T>>;
+
+/**
+ * @brief deleter of objects constructed in memory of resource
+ */
+template <typename T>
+struct resource_deleter {
+    std::pmr::memory_resource* resource{ nullptr };
+
+    void operator()(T* ptr) const {
+        ptr->~T();
+        resource->deallocate(ptr, sizeof(T), alignof(T));
+    }
+};
+
+template <typename T>
+using resource_ptr = std::unique_ptr<T, resource_deleter<T>>;
+
+/**
+ * @brief constructs object in memory of resource
+ * @param resource memory resource
+ * @param args constructor arguments
+ * @return owning pointer, that returns memory to @p resource
+ */
+template <typename T, typename... Args>
+resource_ptr<T> make_resource_ptr(std::pmr::memory_resource* resource, Args&&... args) {
+    void* memory = resource->allocate(sizeof(T), alignof(T));
+    try {
+        return resource_ptr<T>{ new (memory) T(std::forward<Args>(args)...), resource_deleter<T>{ resource } };
+    } catch (...) {
+        resource->deallocate(memory, sizeof(T), alignof(T));
+        throw;
+    }
+}
+
+/**
+ * @brief base of objects that are returned to the user as std::unique_ptr, but are allocated from memory resource
+ * @details resource is stored in front of the object, so default deleter returns memory to it
+ */
+class resource_allocated {
+public:
+    static void* operator new(std::size_t size, std::pmr::memory_resource* resource);
+    // called when constructor throws
+    static void operator delete(void* ptr, std::pmr::memory_resource* resource) noexcept;
+    static void operator delete(void* ptr) noexcept;
+};
+}
@@ -0,0 +1,393 @@
+#include "mixer_impl.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <opus.h>
+
+#include "kvoice.hpp"
+#include "simd.hpp"
+#include "voice_exception.hpp"
+
+namespace {
+/**
+ * @brief checks mixer options and returns count of samples in mixed frame
+ */
+std::size_t get_frame_size(const kvoice::mixer_options& options) {
+    switch (options.sample_rate) {
+        case 8000:
+        case 12000:
+        case 16000:
+        case 24000:
+        case 48000:
+            break;
+        default:
+            throw kvoice::voice_exception::create_formatted("Unsupported mixer sampling rate {}", options.sample_rate);
+    }
+
+    switch (options.frame_duration_ms) {
+        case 10:
+        case 20:
+        case 40:
+        case 60:
+            break;
+        default:
+            throw kvoice::voice_exception::create_formatted("Unsupported mixer frame duration {} ms",
+                                                            options.frame_duration_ms);
+    }
+
+    return static_cast<std::size_t>(options.sample_rate / 1000 * options.frame_duration_ms);
+}
+}
+
+kvoice::mix_encoder::mix_encoder(std::int32_t sample_rate, std::size_t frame_size, std::uint32_t bitrate,
+                                 std::pmr::memory_resource* memory)
+    : memory(memory),
+      frame_size(frame_size) {
+    encoder = static_cast<OpusEncoder*>(memory->allocate(opus_encoder_get_size(1), alignof(std::max_align_t)));
+
+    // silent mixes are sent as DTX packets, so idle listeners cost almost nothing
+    int opus_err = opus_encoder_init(encoder, sample_rate, 1, OPUS_APPLICATION_VOIP);
+    if (opus_err == OPUS_OK)
+        opus_err = opus_encoder_ctl(encoder, OPUS_SET_BITRATE(static_cast<opus_int32>(bitrate)));
+    if (opus_err == OPUS_OK)
+        opus_err = opus_encoder_ctl(encoder, OPUS_SET_DTX(1));
+
+    if (opus_err != OPUS_OK) {
+        memory->deallocate(encoder, opus_encoder_get_size(1), alignof(std::max_align_t));
+        throw voice_exception::create_formatted("Couldn't create opus encoder (errc = {})", opus_err);
+    }
+}
+
+kvoice::mix_encoder::~mix_encoder() {
+    memory->deallocate(encoder, opus_encoder_get_size(1), alignof(std::max_align_t));
+}
+
+bool kvoice::mix_encoder::encode(const float* mix) {
+    const auto result = opus_encode_float(encoder, mix, static_cast<int>(frame_size), packet.data(),
+                                          static_cast<opus_int32>(packet.size()));
+    packet_size = result > 0 ? static_cast<std::size_t>(result) : 0;
+    return result > 0;
+}
+
+kvoice::mixer_participant::mixer_participant(participant_id id, std::int32_t sample_rate, std::size_t frame_size,
+                                             std::uint32_t bitrate, std::pmr::memory_resource* memory)
+    : id(id),
+      frame(frame_size, 0.f, memory),
+      mix(frame_size, 0.f, memory),
+      encoder(sample_rate, frame_size, bitrate, memory),
+      memory(memory),
+      sample_rate(sample_rate),
+      frame_size(frame_size),
+      queue(std::make_unique<jnk0le::Ringbuffer<std::uint8_t, kQueueSize, true>>()),
+      pending(kMaxPacketSamples + frame_size, 0.f, memory) {
+    decoder = static_cast<OpusDecoder*>(memory->allocate(opus_decoder_get_size(1), alignof(std::max_align_t)));
+
+    if (const int opus_err = opus_decoder_init(decoder, sample_rate, 1); opus_err != OPUS_OK) {
+        memory->deallocate(decoder, opus_decoder_get_size(1), alignof(std::max_align_t));
+        throw voice_exception::create_formatted("Couldn't create opus decoder (errc = {})", opus_err);
+    }
+}
+
+kvoice::mixer_participant::~mixer_participant() {
+    memory->deallocate(decoder, opus_decoder_get_size(1), alignof(std::max_align_t));
+}
+
+bool kvoice::mixer_participant::push(const void* data, std::size_t count) {
+    if (count > kMaxPacketSize) {
+        dropped_packets.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // size and packet are queued by one write, so the mixer never sees a partial packet
+    std::array<std::uint8_t, sizeof(std::uint32_t) + kMaxPacketSize> buffer;
+    const auto size = static_cast<std::uint32_t>(count);
+    std::memcpy(buffer.data(), &size, sizeof(size));
+    std::memcpy(buffer.data() + sizeof(size), data, count);
+
+    std::lock_guard lck(mutex);
+    if (queue->writeAvailable() < sizeof(size) + count) {
+        dropped_packets.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    queue->writeBuff(buffer.data(), sizeof(size) + count);
+    queued_packets.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool kvoice::mixer_participant::pop_packet(std::array<std::uint8_t, kMaxPacketSize>& data, std::size_t& count) {
+    if (queue->readAvailable() < sizeof(std::uint32_t)) return false;
+
+    std::uint32_t size;
+    queue->readBuff(reinterpret_cast<std::uint8_t*>(&size), sizeof(size));
+    queue->readBuff(data.data(), size);
+    queued_packets.fetch_sub(1, std::memory_order_release);
+
+    count = size;
+    return true;
+}
+
+void kvoice::mixer_participant::decode_frame(std::uint32_t& decoded, bool& concealed) {
+    decoded = 0;
+    concealed = false;
+
+    {
+        std::lock_guard lck(mutex);
+        frame_gain = gain;
+        frame_position = position;
+        frame_listening = listening;
+    }
+
+    std::array<std::uint8_t, kMaxPacketSize> data;
+    std::size_t                              count;
+
+    // sender runs ahead of the mixer, oldest packets are dropped to keep latency bounded
+    while (queued_packets.load(std::memory_order_acquire) > kMaxQueuedPackets && pop_packet(data, count))
+        dropped_packets.fetch_add(1, std::memory_order_relaxed);
+
+    bool voiced = false;
+    while (pending_count < frame_size && pop_packet(data, count)) {
+        opus_packet_info info;
+        if (!inspect_opus_packet(data.data(), count, sample_rate, info) ||
+            static_cast<std::size_t>(info.sample_count) > kMaxPacketSamples) {
+            dropped_packets.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // comfort noise of every idle speaker would add up in the mix, DTX is mixed as silence
+        if (info.is_dtx) {
+            std::fill_n(pending.data() + pending_count, info.sample_count, 0.f);
+            pending_count += info.sample_count;
+            missing_frames = kMaxConcealedFrames;
+            continue;
+        }
+
+        const auto samples = opus_decode_float(decoder, data.data(), static_cast<opus_int32>(count),
+                                               pending.data() + pending_count, static_cast<int>(kMaxPacketSamples),
+                                               0);
+        if (samples < 0) {
+            dropped_packets.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        pending_count += samples;
+        missing_frames = 0;
+        voiced = true;
+        ++decoded;
+    }
+
+    if (pending_count < frame_size) {
+        // speaker was talking a moment ago, lost packet is concealed instead of cutting the voice
+        if (pending_count == 0 && missing_frames < kMaxConcealedFrames &&
+            opus_decode_float(decoder, nullptr, 0, pending.data(), static_cast<int>(frame_size), 0) > 0) {
+            pending_count = frame_size;
+            concealed = true;
+            voiced = true;
+            ++missing_frames;
+        } else {
+            std::fill(pending.begin() + pending_count, pending.begin() + frame_size, 0.f);
+            pending_count = frame_size;
+        }
+    }
+
+    std::copy_n(pending.begin(), frame_size, frame.begin());
+    pending_count -= frame_size;
+    std::copy_n(pending.begin() + frame_size, pending_count, pending.begin());
+
+    // samples left from the previous packet can carry voice too
+    active = voiced || simd::peak(frame.data(), frame_size) > 0.f;
+}
+
+kvoice::mixer_impl::mixer_impl(const mixer_options& options)
+    : memory(options.memory_resource ? options.memory_resource : std::pmr::get_default_resource()),
+      sample_rate(static_cast<std::int32_t>(options.sample_rate)),
+      frame_size(get_frame_size(options)),
+      bitrate(options.bitrate),
+      total_mix(frame_size, 0.f, &memory),
+      shared_encoder(sample_rate, frame_size, bitrate, &memory),
+      workers(options.worker_count, options.worker_thread) {}
+
+kvoice::mixer_impl::~mixer_impl() = default;
+
+kvoice::participant_id kvoice::mixer_impl::add_participant() {
+    std::lock_guard lck(participants_mutex);
+    const auto      id = next_id++;
+    participants.emplace(id, std::allocate_shared<mixer_participant>(
+                             std::pmr::polymorphic_allocator<mixer_participant>{ &memory }, id, sample_rate,
+                             frame_size, bitrate, &memory));
+    return id;
+}
+
+void kvoice::mixer_impl::remove_participant(participant_id id) {
+    std::lock_guard lck(participants_mutex);
+    if (const auto it = participants.find(id); it != participants.end()) {
+        removed_dropped_packets.fetch_add(it->second->dropped_packets.load(std::memory_order_relaxed),
+                                          std::memory_order_relaxed);
+        participants.erase(it);
+    }
+}
+
+std::shared_ptr<kvoice::mixer_participant> kvoice::mixer_impl::find(participant_id id) const {
+    std::lock_guard lck(participants_mutex);
+    const auto      it = participants.find(id);
+    return it != participants.end() ? it->second : nullptr;
+}
+
+bool kvoice::mixer_impl::push_opus_buffer(participant_id id, const void* data, std::size_t count) {
+    const auto participant = find(id);
+    return participant && participant->push(data, count);
+}
+
+void kvoice::mixer_impl::set_gain(participant_id id, float gain) {
+    if (const auto participant = find(id)) {
+        std::lock_guard lck(participant->mutex);
+        participant->gain = gain;
+    }
+}
+
+void kvoice::mixer_impl::set_position(participant_id id, vector pos) {
+    if (const auto participant = find(id)) {
+        std::lock_guard lck(participant->mutex);
+        participant->position = pos;
+    }
+}
+
+void kvoice::mixer_impl::set_listening(participant_id id, bool listening) {
+    if (const auto participant = find(id)) {
+        std::lock_guard lck(participant->mutex);
+        participant->listening = listening;
+    }
+}
+
+void kvoice::mixer_impl::set_spatial(bool enabled, const mixer_attenuation& attenuation) {
+    std::lock_guard lck(participants_mutex);
+    spatial = enabled;
+    this->attenuation = attenuation;
+}
+
+float kvoice::mixer_impl::get_attenuation(const vector& listener, const vector& speaker) const noexcept {
+    const auto dx = speaker.x - listener.x;
+    const auto dy = speaker.y - listener.y;
+    const auto dz = speaker.z - listener.z;
+    const auto distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+    if (distance > frame_attenuation.max_distance) return 0.f;
+
+    const auto reference = frame_attenuation.reference_distance;
+    const auto clamped = std::clamp(distance, reference, std::max(reference, frame_attenuation.max_distance));
+    const auto denominator = reference + frame_attenuation.rolloff_factor * (clamped - reference);
+    return denominator > 0.f ? reference / denominator : 1.f;
+}
+
+void kvoice::mixer_impl::mix_listener(mixer_participant& listener) {
+    if (!frame_spatial) {
+        // mix-minus, the listener doesn't hear itself
+        std::copy(total_mix.begin(), total_mix.end(), listener.mix.begin());
+        simd::accumulate(listener.mix.data(), listener.frame.data(), frame_size, -listener.frame_gain);
+        return;
+    }
+
+    std::fill(listener.mix.begin(), listener.mix.end(), 0.f);
+    for (const auto* speaker : frame_speakers) {
+        if (speaker == &listener) continue;
+
+        const auto gain = speaker->frame_gain * get_attenuation(listener.frame_position, speaker->frame_position);
+        if (gain > 0.f)
+            simd::accumulate(listener.mix.data(), speaker->frame.data(), frame_size, gain);
+    }
+}
+
+void kvoice::mixer_impl::mix_frame(const std::function<on_mixed_packet_t>& cb) {
+    {
+        std::lock_guard lck(participants_mutex);
+        frame_participants.clear();
+        for (const auto& [id, participant] : participants)
+            frame_participants.push_back(participant);
+        frame_spatial = spatial;
+        frame_attenuation = attenuation;
+    }
+
+    // every speaker is decoded once, its frame is shared by all mixes
+    std::atomic<std::uint64_t> frame_decoded{ 0 };
+    std::atomic<std::uint64_t> frame_concealed{ 0 };
+    workers.run(frame_participants.size(), [&](std::size_t i) {
+        std::uint32_t decoded;
+        bool          concealed;
+        frame_participants[i]->decode_frame(decoded, concealed);
+        frame_decoded.fetch_add(decoded, std::memory_order_relaxed);
+        if (concealed) frame_concealed.fetch_add(1, std::memory_order_relaxed);
+    });
+
+    frame_speakers.clear();
+    for (const auto& participant : frame_participants)
+        if (participant->active) frame_speakers.push_back(participant.get());
+
+    std::fill(total_mix.begin(), total_mix.end(), 0.f);
+    if (!frame_spatial) {
+        for (const auto* speaker : frame_speakers)
+            simd::accumulate(total_mix.data(), speaker->frame.data(), frame_size, speaker->frame_gain);
+    }
+
+    // listeners, that don't speak, hear the whole mix, it is encoded once for all of them
+    frame_listeners.clear();
+    bool shared_needed = false;
+    for (const auto& participant : frame_participants) {
+        if (!participant->frame_listening) continue;
+
+        participant->uses_shared_mix = !frame_spatial && !participant->active;
+        if (participant->uses_shared_mix)
+            shared_needed = true;
+        else
+            frame_listeners.push_back(participant.get());
+    }
+
+    // the shared mix is encoded by the last task
+    std::atomic<std::uint64_t> frame_encoded{ 0 };
+    workers.run(frame_listeners.size() + (shared_needed ? 1 : 0), [&](std::size_t i) {
+        if (i == frame_listeners.size()) {
+            if (shared_encoder.encode(total_mix.data())) frame_encoded.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto& listener = *frame_listeners[i];
+        mix_listener(listener);
+        if (listener.encoder.encode(listener.mix.data())) frame_encoded.fetch_add(1, std::memory_order_relaxed);
+    });
+
+    std::uint64_t delivered = 0;
+    for (const auto& participant : frame_participants) {
+        if (!participant->frame_listening) continue;
+
+        const auto& encoder = participant->uses_shared_mix ? shared_encoder : participant->encoder;
+        if (encoder.get_packet_size() == 0) continue;
+
+        if (cb) cb(participant->id, encoder.get_packet(), encoder.get_packet_size());
+        ++delivered;
+    }
+
+    // removed participants are released here, not by the thread, that removed them
+    frame_participants.clear();
+
+    active_speakers.store(frame_speakers.size(), std::memory_order_relaxed);
+    decoded_packets.fetch_add(frame_decoded.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    concealed_frames.fetch_add(frame_concealed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    encoded_packets.fetch_add(frame_encoded.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    delivered_packets.fetch_add(delivered, std::memory_order_relaxed);
+}
+
+kvoice::mixer_stats kvoice::mixer_impl::get_stats() const {
+    mixer_stats stats;
+    stats.active_speakers = active_speakers.load(std::memory_order_relaxed);
+    stats.decoded_packets = decoded_packets.load(std::memory_order_relaxed);
+    stats.concealed_frames = concealed_frames.load(std::memory_order_relaxed);
+    stats.encoded_packets = encoded_packets.load(std::memory_order_relaxed);
+    stats.delivered_packets = delivered_packets.load(std::memory_order_relaxed);
+
+    std::lock_guard lck(participants_mutex);
+    stats.participants = participants.size();
+    stats.dropped_packets = removed_dropped_packets.load(std::memory_order_relaxed);
+    for (const auto& [id, participant] : participants)
+        stats.dropped_packets += participant->dropped_packets.load(std::memory_order_relaxed);
+    return stats;
+}
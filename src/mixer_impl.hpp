@@ -0,0 +1,208 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "mixer.hpp"
+#include "memory.hpp"
+#include "ringbuffer.hpp"
+#include "worker_pool.hpp"
+
+struct OpusDecoder;
+struct OpusEncoder;
+
+namespace kvoice {
+/**
+ * @brief encoder of mixed frames, state is placed in memory of the mixer
+ */
+class mix_encoder {
+public:
+    static constexpr std::size_t kMaxPacketSize = 1500;
+
+    /**
+     * @brief Constructor
+     * @param sample_rate encoder sampling rate
+     * @param frame_size count of samples in mixed frame
+     * @param bitrate encoder bitrate
+     * @param memory resource of the mixer
+     */
+    mix_encoder(std::int32_t sample_rate, std::size_t frame_size, std::uint32_t bitrate,
+                std::pmr::memory_resource* memory);
+    ~mix_encoder();
+
+    mix_encoder(const mix_encoder&) = delete;
+    mix_encoder& operator=(const mix_encoder&) = delete;
+
+    /**
+     * @brief encodes one frame, packet is kept until the next call
+     * @param mix frame samples
+     * @return false if encoder failed
+     */
+    bool encode(const float* mix);
+
+    [[nodiscard]] const std::uint8_t* get_packet() const noexcept { return packet.data(); }
+    [[nodiscard]] std::size_t         get_packet_size() const noexcept { return packet_size; }
+
+private:
+    std::pmr::memory_resource* memory{ nullptr };
+    std::size_t                frame_size{ 0 };
+    OpusEncoder*               encoder{ nullptr };
+
+    std::array<std::uint8_t, kMaxPacketSize> packet{};
+    std::size_t                              packet_size{ 0 };
+};
+
+/**
+ * @brief speaker and listener of the mixer
+ */
+class mixer_participant {
+    // size of packet queue in bytes, about a second of voice
+    static constexpr std::size_t   kQueueSize = 16384;
+    // max size of queued packet, bigger packets are dropped
+    static constexpr std::size_t   kMaxPacketSize = 1500;
+    // older packets are dropped when sender runs ahead of the mixer, so latency stays bounded
+    static constexpr std::uint32_t kMaxQueuedPackets = 6;
+    // frames concealed by decoder after the last received packet, then the speaker is silent
+    static constexpr std::uint32_t kMaxConcealedFrames = 3;
+    // opus packet is at most 120 ms
+    static constexpr std::size_t   kMaxPacketSamples = 5760;
+public:
+    /**
+     * @brief Constructor, places codec states in @p memory
+     * @param id participant id
+     * @param sample_rate codec sampling rate
+     * @param frame_size count of samples in mixed frame
+     * @param bitrate encoder bitrate
+     * @param memory resource of the mixer
+     */
+    mixer_participant(participant_id id, std::int32_t sample_rate, std::size_t frame_size, std::uint32_t bitrate,
+                      std::pmr::memory_resource* memory);
+    ~mixer_participant();
+
+    mixer_participant(const mixer_participant&) = delete;
+    mixer_participant& operator=(const mixer_participant&) = delete;
+
+    /**
+     * @brief queues packet, can be called from any thread
+     * @return false if packet doesn't fit the queue
+     */
+    bool push(const void* data, std::size_t count);
+
+    /**
+     * @brief copies parameters set by control threads and decodes the next frame to @p frame
+     * @details sets @p active if the frame has speech
+     * @param[out] decoded count of decoded packets
+     * @param[out] concealed true if the frame was generated by packet loss concealment
+     */
+    void decode_frame(std::uint32_t& decoded, bool& concealed);
+
+    const participant_id id;
+
+    // guarded by mutex, copied to frame state at the start of every frame
+    std::mutex mutex;
+    float      gain{ 1.f };
+    vector     position{ 0.f, 0.f, 0.f };
+    bool       listening{ true };
+
+    std::atomic<std::uint64_t> dropped_packets{ 0 };
+
+    // frame state, used only by the mixing thread and workers
+    float                   frame_gain{ 1.f };
+    vector                  frame_position{ 0.f, 0.f, 0.f };
+    bool                    frame_listening{ true };
+    bool                    active{ false };
+    // listener gets the shared packet instead of its own one
+    bool                    uses_shared_mix{ false };
+    std::pmr::vector<float> frame;
+    std::pmr::vector<float> mix;
+    mix_encoder             encoder;
+
+private:
+    bool pop_packet(std::array<std::uint8_t, kMaxPacketSize>& data, std::size_t& count);
+
+    std::pmr::memory_resource* memory{ nullptr };
+    std::int32_t               sample_rate{ 48000 };
+    std::size_t                frame_size{ 0 };
+    OpusDecoder*               decoder{ nullptr };
+
+    // producers are serialized by the mutex, consumer is the mixing thread
+    std::unique_ptr<jnk0le::Ringbuffer<std::uint8_t, kQueueSize, true>> queue;
+    std::atomic<std::uint32_t>                                          queued_packets{ 0 };
+
+    // decoded samples, that don't fit the current frame
+    std::pmr::vector<float> pending;
+    std::size_t             pending_count{ 0 };
+    std::uint32_t           missing_frames{ kMaxConcealedFrames };
+};
+
+class mixer_impl final : public mixer, public resource_allocated {
+public:
+    /**
+     * @brief Constructor
+     * @param options mixer options
+     */
+    explicit mixer_impl(const mixer_options& options);
+    ~mixer_impl() override;
+
+    participant_id add_participant() override;
+    void           remove_participant(participant_id id) override;
+
+    bool push_opus_buffer(participant_id id, const void* data, std::size_t count) override;
+
+    void set_gain(participant_id id, float gain) override;
+    void set_position(participant_id id, vector pos) override;
+    void set_listening(participant_id id, bool listening) override;
+    void set_spatial(bool enabled, const mixer_attenuation& attenuation) override;
+
+    void mix_frame(const std::function<on_mixed_packet_t>& cb) override;
+
+    mixer_stats  get_stats() const override;
+    memory_stats get_memory_stats() const override { return memory.get_stats(); }
+
+private:
+    [[nodiscard]] std::shared_ptr<mixer_participant> find(participant_id id) const;
+
+    void mix_listener(mixer_participant& listener);
+    [[nodiscard]] float get_attenuation(const vector& listener, const vector& speaker) const noexcept;
+
+    // declared first, so it outlives everything allocated from it
+    counting_resource memory;
+
+    std::int32_t  sample_rate{ 48000 };
+    std::size_t   frame_size{ 960 };
+    std::uint32_t bitrate{ 32000 };
+
+    mutable std::mutex                                                           participants_mutex;
+    std::pmr::unordered_map<participant_id, std::shared_ptr<mixer_participant>> participants{ &memory };
+    participant_id                                                               next_id{ 1 };
+    bool                                                                         spatial{ false };
+    mixer_attenuation                                                            attenuation{};
+
+    // frame state, used only by the mixing thread and workers
+    std::pmr::vector<std::shared_ptr<mixer_participant>> frame_participants{ &memory };
+    std::pmr::vector<mixer_participant*>                 frame_speakers{ &memory };
+    std::pmr::vector<mixer_participant*>                 frame_listeners{ &memory };
+    std::pmr::vector<float>                              total_mix{ &memory };
+    bool                                                 frame_spatial{ false };
+    mixer_attenuation                                    frame_attenuation{};
+
+    // encoder of the mix heard by every listener, that doesn't speak
+    mix_encoder shared_encoder;
+
+    std::atomic<std::size_t>   active_speakers{ 0 };
+    std::atomic<std::uint64_t> decoded_packets{ 0 };
+    std::atomic<std::uint64_t> concealed_frames{ 0 };
+    std::atomic<std::uint64_t> removed_dropped_packets{ 0 };
+    std::atomic<std::uint64_t> encoded_packets{ 0 };
+    std::atomic<std::uint64_t> delivered_packets{ 0 };
+
+    worker_pool workers;
+};
+}
@@ -0,0 +1,181 @@
+#include "ogg_opus_writer.hpp"
+
+#include <array>
+#include <cstring>
+
+#include "byte_order.hpp"
+#include "voice_exception.hpp"
+
+namespace {
+constexpr std::uint8_t kBeginOfStream = 0x02;
+constexpr std::uint8_t kEndOfStream = 0x04;
+constexpr std::size_t  kPageHeaderSize = 27;
+constexpr char         kVendor[] = "kvoice";
+
+/**
+ * @brief returns lookup table of Ogg CRC-32(polynomial 0x04c11db7, no reflection)
+ */
+const std::array<std::uint32_t, 256>& get_crc_table() {
+    static const auto table = []() {
+        std::array<std::uint32_t, 256> result{};
+        for (std::uint32_t i = 0; i < result.size(); ++i) {
+            std::uint32_t crc = i << 24;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = crc & 0x80000000u ? crc << 1 ^ 0x04c11db7u : crc << 1;
+            result[i] = crc;
+        }
+        return result;
+    }();
+    return table;
+}
+
+std::uint32_t update_crc(std::uint32_t crc, const std::uint8_t* data, std::size_t count) {
+    const auto& table = get_crc_table();
+    for (std::size_t i = 0; i < count; ++i)
+        crc = crc << 8 ^ table[(crc >> 24 ^ data[i]) & 0xff];
+    return crc;
+}
+
+void append_lacing(std::vector<std::uint8_t>& segments, std::size_t count) {
+    // packet of size multiple of 255 ends with zero lacing value
+    for (; count >= 255; count -= 255)
+        segments.push_back(255);
+    segments.push_back(static_cast<std::uint8_t>(count));
+}
+
+/**
+ * @brief returns one byte opus packet, that has a single empty frame of given duration
+ * @details decoder treats empty frame as lost and conceals it, so gap keeps its duration in the file
+ */
+std::uint8_t get_empty_packet(std::uint32_t samples) {
+    // CELT-only fullband configurations 28-31 are 2.5, 5, 10 and 20 ms frames
+    if (samples >= 960) return 31 << 3;
+    if (samples >= 480) return 30 << 3;
+    if (samples >= 240) return 29 << 3;
+    return 28 << 3;
+}
+}
+
+kvoice::ogg_opus_writer::ogg_opus_writer(const std::filesystem::path& path, std::uint32_t serial,
+                                         std::uint32_t input_sample_rate, std::size_t write_buffer_size,
+                                         bool fill_gaps)
+    : file(path, std::ios::binary | std::ios::trunc),
+      serial(serial),
+      write_buffer_size(write_buffer_size),
+      fill_gaps(fill_gaps) {
+    if (!file) throw voice_exception::create_formatted("Couldn't open record file {}", path.u8string());
+
+    write_buffer.reserve(write_buffer_size);
+    page_body.reserve(kMaxSegments * 255);
+    page_segments.reserve(kMaxSegments);
+
+    // identification header: mono, no pre-skip, RTP mapping family
+    std::array<std::uint8_t, 19> head{ 'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 1 };
+    put_le<std::uint16_t>(head.data() + 10, 0);
+    put_le<std::uint32_t>(head.data() + 12, input_sample_rate);
+    put_le<std::int16_t>(head.data() + 16, 0);
+    head[18] = 0;
+
+    std::uint8_t lacing = static_cast<std::uint8_t>(head.size());
+    write_page(head.data(), head.size(), &lacing, 1, 0, kBeginOfStream);
+
+    // comment header with vendor string and no comments
+    constexpr auto vendor_size = sizeof(kVendor) - 1;
+    std::array<std::uint8_t, 8 + 4 + vendor_size + 4> tags{ 'O', 'p', 'u', 's', 'T', 'a', 'g', 's' };
+    put_le<std::uint32_t>(tags.data() + 8, vendor_size);
+    std::memcpy(tags.data() + 12, kVendor, vendor_size);
+    put_le<std::uint32_t>(tags.data() + 12 + vendor_size, 0);
+
+    lacing = static_cast<std::uint8_t>(tags.size());
+    write_page(tags.data(), tags.size(), &lacing, 1, 0, 0);
+}
+
+kvoice::ogg_opus_writer::~ogg_opus_writer() {
+    try {
+        finish();
+    } catch (...) {
+    }
+}
+
+void kvoice::ogg_opus_writer::write_packet(const recorded_packet& packet) {
+    if (packet.gap_samples && fill_gaps)
+        write_gap(packet.gap_samples);
+
+    write_raw(packet.data, packet.size, packet.samples);
+}
+
+void kvoice::ogg_opus_writer::write_raw(const void* data, std::size_t count, std::uint32_t samples) {
+    if (finished) return;
+
+    if (page_segments.size() + count / 255 + 1 > kMaxSegments)
+        flush_page();
+
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    page_body.insert(page_body.end(), bytes, bytes + count);
+    append_lacing(page_segments, count);
+    granule_position += samples;
+
+    if (granule_position - page_start_granule >= kPageDuration)
+        flush_page();
+}
+
+void kvoice::ogg_opus_writer::write_gap(std::uint32_t samples) {
+    // gap is rounded to the shortest opus frame
+    while (samples >= 120) {
+        const std::uint8_t toc = get_empty_packet(samples);
+        const std::uint32_t duration = 120u << ((toc >> 3) - 28);
+        write_raw(&toc, 1, duration);
+        samples -= duration;
+    }
+}
+
+void kvoice::ogg_opus_writer::finish() {
+    if (finished) return;
+    finished = true;
+
+    // end of stream flag should be set on the last page, even if it is empty
+    flush_page(kEndOfStream);
+    flush_buffer();
+    file.flush();
+}
+
+void kvoice::ogg_opus_writer::write_page(const std::uint8_t* body, std::size_t body_size,
+                                         const std::uint8_t* segments, std::size_t segment_count,
+                                         std::uint64_t granule, std::uint8_t flags) {
+    std::array<std::uint8_t, kPageHeaderSize> header{ 'O', 'g', 'g', 'S', 0, flags };
+    put_le<std::uint64_t>(header.data() + 6, granule);
+    put_le<std::uint32_t>(header.data() + 14, serial);
+    put_le<std::uint32_t>(header.data() + 18, page_sequence++);
+    put_le<std::uint32_t>(header.data() + 22, 0);
+    header[26] = static_cast<std::uint8_t>(segment_count);
+
+    std::uint32_t crc = update_crc(0, header.data(), header.size());
+    crc = update_crc(crc, segments, segment_count);
+    crc = update_crc(crc, body, body_size);
+    put_le<std::uint32_t>(header.data() + 22, crc);
+
+    write_buffer.insert(write_buffer.end(), header.begin(), header.end());
+    write_buffer.insert(write_buffer.end(), segments, segments + segment_count);
+    write_buffer.insert(write_buffer.end(), body, body + body_size);
+
+    if (write_buffer.size() >= write_buffer_size)
+        flush_buffer();
+}
+
+void kvoice::ogg_opus_writer::flush_page(std::uint8_t flags) {
+    if (page_segments.empty() && !(flags & kEndOfStream)) return;
+
+    write_page(page_body.data(), page_body.size(), page_segments.data(), page_segments.size(), granule_position,
+               flags);
+    page_body.clear();
+    page_segments.clear();
+    page_start_granule = granule_position;
+}
+
+void kvoice::ogg_opus_writer::flush_buffer() {
+    if (write_buffer.empty()) return;
+
+    file.write(reinterpret_cast<const char*>(write_buffer.data()), static_cast<std::streamsize>(write_buffer.size()));
+    written_bytes += write_buffer.size();
+    write_buffer.clear();
+}
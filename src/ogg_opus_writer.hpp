@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "record_sink.hpp"
+
+namespace kvoice {
+/**
+ * @brief writes mono Opus packets to Ogg Opus file(RFC 7845) without re-encoding
+ * @details pages are collected in memory and written to the file in large sequential blocks
+ */
+class ogg_opus_writer final : public record_sink {
+    // max count of lacing values in one page
+    static constexpr std::size_t kMaxSegments = 255;
+    // page is completed after this count of samples at 48 kHz, so players can seek the file
+    static constexpr std::uint64_t kPageDuration = 48000;
+public:
+    /**
+     * @brief Constructor, writes identification and comment headers
+     * @param path output file path
+     * @param serial logical stream serial number
+     * @param input_sample_rate original sampling rate stored in the header
+     * @param write_buffer_size size of data collected before writing to the file
+     * @param fill_gaps replace dropped packets with empty packets of the same duration
+     */
+    ogg_opus_writer(const std::filesystem::path& path, std::uint32_t serial, std::uint32_t input_sample_rate,
+                    std::size_t write_buffer_size, bool fill_gaps);
+    ~ogg_opus_writer() override;
+
+    ogg_opus_writer(const ogg_opus_writer&) = delete;
+    ogg_opus_writer& operator=(const ogg_opus_writer&) = delete;
+
+    /**
+     * @brief adds packet to the current page, preceded by empty packets of dropped duration if gaps are filled
+     * @param packet recorded packet
+     */
+    void write_packet(const recorded_packet& packet) override;
+
+    /**
+     * @brief updates aren't stored in Ogg Opus file
+     */
+    void write_update(timestamp_t) override {}
+
+    /**
+     * @brief writes the last page with end of stream flag and flushes the file
+     */
+    void finish() override;
+
+    /**
+     * @brief returns count of bytes written to the file
+     */
+    [[nodiscard]] std::uint64_t get_written_bytes() const noexcept override { return written_bytes; }
+
+private:
+    /**
+     * @brief adds packet to the current page
+     * @param data packet data
+     * @param count size of @p data
+     * @param samples duration of packet in samples at 48 kHz
+     */
+    void write_raw(const void* data, std::size_t count, std::uint32_t samples);
+    void write_gap(std::uint32_t samples);
+    void write_page(const std::uint8_t* body, std::size_t body_size, const std::uint8_t* segments,
+                    std::size_t segment_count, std::uint64_t granule, std::uint8_t flags);
+    void flush_page(std::uint8_t flags = 0);
+    void flush_buffer();
+
+    std::ofstream             file;
+    std::uint32_t             serial{ 0 };
+    std::uint32_t             page_sequence{ 0 };
+    std::uint64_t             granule_position{ 0 };
+    std::uint64_t             page_start_granule{ 0 };
+    std::uint64_t             written_bytes{ 0 };
+    std::vector<std::uint8_t> page_body{};
+    std::vector<std::uint8_t> page_segments{};
+    std::vector<std::uint8_t> write_buffer{};
+    std::size_t               write_buffer_size{ 0 };
+    bool                      fill_gaps{ true };
+    bool                      finished{ false };
+};
+}
@@ -0,0 +1,83 @@
+#include "kvoice.hpp"
+
+#include <opus.h>
+
+namespace {
+constexpr auto kMaxPacketFrames = 48;
+constexpr auto kSilkFrameSamples = 960;
+
+kvoice::opus_mode get_mode(unsigned char toc) {
+    const auto config = toc >> 3;
+    if (config < 12) return kvoice::opus_mode::silk;
+    if (config < 16) return kvoice::opus_mode::hybrid;
+    return kvoice::opus_mode::celt;
+}
+
+kvoice::opus_bandwidth get_bandwidth(int bandwidth) {
+    switch (bandwidth) {
+    case OPUS_BANDWIDTH_MEDIUMBAND: return kvoice::opus_bandwidth::mediumband;
+    case OPUS_BANDWIDTH_WIDEBAND: return kvoice::opus_bandwidth::wideband;
+    case OPUS_BANDWIDTH_SUPERWIDEBAND: return kvoice::opus_bandwidth::superwideband;
+    case OPUS_BANDWIDTH_FULLBAND: return kvoice::opus_bandwidth::fullband;
+    default: return kvoice::opus_bandwidth::narrowband;
+    }
+}
+}
+
+bool kvoice::inspect_opus_packet(const void* data, std::size_t count, std::int32_t sample_rate,
+                                 opus_packet_info& info) {
+    if (!data || count == 0) return false;
+
+    const auto* packet = static_cast<const unsigned char*>(data);
+    const auto  len = static_cast<opus_int32>(count);
+
+    const unsigned char* frames[kMaxPacketFrames];
+    opus_int16           sizes[kMaxPacketFrames];
+
+    const int frame_count = opus_packet_parse(packet, len, nullptr, frames, sizes, nullptr);
+    if (frame_count <= 0) return false;
+
+    info.mode = get_mode(packet[0]);
+    info.bandwidth = get_bandwidth(opus_packet_get_bandwidth(packet));
+    info.channels = opus_packet_get_nb_channels(packet);
+    info.frame_count = frame_count;
+    info.samples_per_frame = opus_packet_get_samples_per_frame(packet, sample_rate);
+    info.sample_count = info.samples_per_frame * frame_count;
+
+    // frames of 0 or 1 bytes are treated by decoder as lost, encoder emits them in DTX mode
+    info.is_dtx = true;
+    for (int i = 0; i < frame_count; ++i) {
+        if (sizes[i] > 1) {
+            info.is_dtx = false;
+            break;
+        }
+    }
+
+    info.voice_activity = !info.is_dtx;
+    info.has_fec = false;
+
+    if (info.mode == opus_mode::celt || info.is_dtx)
+        return true;
+
+    // first byte of SILK frame holds VAD flag of every 20 ms subframe followed by LBRR flag
+    const int frame_samples = opus_packet_get_samples_per_frame(packet, 48000);
+    const int silk_frames = frame_samples > kSilkFrameSamples ? frame_samples / kSilkFrameSamples : 1;
+    const unsigned vad_mask = ((1u << silk_frames) - 1u) << (8 - silk_frames);
+
+    info.voice_activity = false;
+    for (int i = 0; i < frame_count; ++i) {
+        if (sizes[i] > 0 && (frames[i][0] & vad_mask) != 0) {
+            info.voice_activity = true;
+            break;
+        }
+    }
+
+    // decoder uses FEC data only from the first frame
+    if (sizes[0] > 0) {
+        info.has_fec = ((frames[0][0] >> (7 - silk_frames)) & 1) != 0;
+        if (info.channels == 2)
+            info.has_fec = info.has_fec || ((frames[0][0] >> (6 - 2 * silk_frames)) & 1) != 0;
+    }
+
+    return true;
+}
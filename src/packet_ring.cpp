@@ -0,0 +1,66 @@
+#include "packet_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+kvoice::packet_ring::packet_ring(std::pmr::memory_resource* memory)
+    : slots(kSlotCount, memory) {
+}
+
+void kvoice::packet_ring::commit(std::size_t size, timestamp_t capture_time) noexcept {
+    const auto index = written.load(std::memory_order_relaxed);
+    auto&      current = get_slot(index);
+
+    // readers of the overwritten packet see odd stamp and skip it
+    current.stamp.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(current.data.data(), pending.data(), size);
+    current.size = size;
+    current.capture_time = capture_time;
+    current.stamp.store(2 * index + 2, std::memory_order_release);
+    written.store(index + 1, std::memory_order_release);
+}
+
+bool kvoice::packet_ring::read(std::uint64_t index, void* buffer, std::size_t& size,
+                               timestamp_t& capture_time) const noexcept {
+    const auto& current = slots[index % kSlotCount];
+
+    const auto stamp = current.stamp.load(std::memory_order_acquire);
+    if (stamp != 2 * index + 2) return false;
+
+    // plain copy races with the writer on purpose(seqlock), fields are trivially copyable and the result is used
+    // only if the stamp is the same after the copy. Size may be torn, so it is clamped before memcpy
+    size = std::min(current.size, kMaxCapturedPacketSize);
+    capture_time = current.capture_time;
+    std::memcpy(buffer, current.data.data(), size);
+
+    // copy is valid only if the writer didn't start overwriting the slot meanwhile
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return current.stamp.load(std::memory_order_relaxed) == stamp;
+}
+
+kvoice::packet_subscription_impl::packet_subscription_impl(const packet_ring* ring)
+    : ring(ring),
+      next(ring->get_written()) {
+}
+
+std::size_t kvoice::packet_subscription_impl::read(void* buffer, timestamp_t& capture_time) {
+    for (;;) {
+        const auto written = ring->get_written();
+        if (next == written) return 0;
+
+        // packets older than the ring were overwritten
+        if (written - next > packet_ring::kSlotCount) {
+            overflows.fetch_add(written - next - packet_ring::kSlotCount, std::memory_order_relaxed);
+            next = written - packet_ring::kSlotCount;
+        }
+
+        std::size_t size;
+        if (ring->read(next++, buffer, size, capture_time))
+            return size;
+
+        // writer lapped this subscriber during the copy
+        overflows.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "packet_subscription.hpp"
+#include "memory.hpp"
+
+namespace kvoice {
+/**
+ * @brief single writer broadcast ring of encoded packets, that is read by any count of subscribers
+ * @details writer doesn't know subscribers and never waits for them. Every slot is stamped with the number of
+ * the packet it holds, odd stamp marks the slot being written, so a reader detects overwritten packets without
+ * locks and skips them. Slot is copied by readers while the writer may overwrite it, the copy is used only if the
+ * stamp didn't change meanwhile(seqlock), so a torn copy is always discarded
+ */
+class packet_ring {
+public:
+    // about a second and a quarter of 10 ms frames
+    static constexpr std::size_t kSlotCount = 128;
+
+    /**
+     * @brief Constructor
+     * @param memory resource of slots
+     */
+    explicit packet_ring(std::pmr::memory_resource* memory);
+
+    packet_ring(const packet_ring&) = delete;
+    packet_ring& operator=(const packet_ring&) = delete;
+
+    /**
+     * @brief returns buffer of the next packet, should be used only by the writer
+     * @details packet is written to the writer buffer, so the slot it replaces stays readable until @p commit.
+     * Abandoned packet doesn't need any cleanup
+     * @return buffer of @p kMaxCapturedPacketSize bytes, valid until the next @p begin_write
+     */
+    std::uint8_t* begin_write() noexcept { return pending.data(); }
+    /**
+     * @brief publishes packet written to the buffer of @p begin_write
+     * @param size size of packet
+     * @param capture_time capture timestamp of packet
+     */
+    void commit(std::size_t size, timestamp_t capture_time) noexcept;
+
+    /**
+     * @brief returns count of published packets, the next packet of new subscriber
+     */
+    [[nodiscard]] std::uint64_t get_written() const noexcept { return written.load(std::memory_order_acquire); }
+
+    /**
+     * @brief copies packet @p index to @p buffer, can be called from any thread
+     * @param index number of packet
+     * @param[out] buffer buffer of @p kMaxCapturedPacketSize bytes
+     * @param[out] size size of packet
+     * @param[out] capture_time capture timestamp of packet
+     * @return false if the packet was overwritten before or during the copy
+     */
+    bool read(std::uint64_t index, void* buffer, std::size_t& size, timestamp_t& capture_time) const noexcept;
+
+private:
+    struct slot {
+        // 2 * index + 2 when packet is published, odd while it is written
+        std::atomic<std::uint64_t> stamp{ 0 };
+        std::size_t                size{ 0 };
+        timestamp_t                capture_time{ 0 };
+
+        std::array<std::uint8_t, kMaxCapturedPacketSize> data{};
+    };
+
+    [[nodiscard]] slot& get_slot(std::uint64_t index) noexcept { return slots[index % kSlotCount]; }
+
+    std::pmr::vector<slot>     slots;
+    std::atomic<std::uint64_t> written{ 0 };
+    // packet being written, it is copied to the slot by commit
+    std::array<std::uint8_t, kMaxCapturedPacketSize> pending{};
+};
+
+class packet_subscription_impl final : public packet_subscription, public resource_allocated {
+public:
+    /**
+     * @brief Constructor, subscriber receives packets published after its creation
+     * @param ring ring of input
+     */
+    explicit packet_subscription_impl(const packet_ring* ring);
+
+    std::size_t   read(void* buffer, timestamp_t& capture_time) override;
+    std::uint64_t get_overflows() const override { return overflows.load(std::memory_order_relaxed); }
+
+private:
+    const packet_ring*         ring{ nullptr };
+    std::uint64_t              next{ 0 };
+    std::atomic<std::uint64_t> overflows{ 0 };
+};
+}
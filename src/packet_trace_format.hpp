@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "kv_clock.hpp"
+
+/**
+ * @brief layout of packet trace file, all integers are little-endian
+ * @details file header is followed by records, every record is a fixed header and payload of given size
+ */
+namespace kvoice::trace_format {
+constexpr std::array<std::uint8_t, 8> kMagic{ 'K', 'V', 'T', 'R', 'A', 'C', 'E', 0 };
+constexpr std::uint32_t               kVersion = 1;
+
+// magic, version, decode sampling rate, mixing rate, flags
+constexpr std::size_t kFileHeaderSize = 24;
+// type, payload size, time, capture time
+constexpr std::size_t kRecordHeaderSize = 24;
+
+constexpr std::uint32_t kFlagCallbackMode = 1u << 0;
+constexpr std::uint32_t kFlagInt16 = 1u << 1;
+
+// capture time of packets pushed without it
+constexpr timestamp_t kNoCaptureTime = std::numeric_limits<timestamp_t>::min();
+}
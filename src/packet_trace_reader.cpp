@@ -0,0 +1,143 @@
+#include "packet_trace_reader.hpp"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <Windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include "byte_order.hpp"
+#include "packet_trace_format.hpp"
+#include "voice_exception.hpp"
+
+#ifdef _WIN32
+kvoice::mapped_file::mapped_file(const std::filesystem::path& path) {
+    file_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE)
+        throw voice_exception::create_formatted("Couldn't open trace file {}", path.u8string());
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size)) {
+        CloseHandle(file_handle);
+        throw voice_exception::create_formatted("Couldn't get size of trace file {}", path.u8string());
+    }
+    view_size = static_cast<std::size_t>(file_size.QuadPart);
+    // empty file can't be mapped, it is rejected as truncated
+    if (!view_size) return;
+
+    mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle)
+        view = static_cast<const std::uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+
+    if (!view) {
+        if (mapping_handle) CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+        throw voice_exception::create_formatted("Couldn't map trace file {}", path.u8string());
+    }
+}
+
+kvoice::mapped_file::~mapped_file() {
+    if (view) UnmapViewOfFile(view);
+    if (mapping_handle) CloseHandle(mapping_handle);
+    CloseHandle(file_handle);
+}
+#else
+kvoice::mapped_file::mapped_file(const std::filesystem::path& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw voice_exception::create_formatted("Couldn't open trace file {}", path.u8string());
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw voice_exception::create_formatted("Couldn't get size of trace file {}", path.u8string());
+    }
+    view_size = static_cast<std::size_t>(st.st_size);
+    // empty file can't be mapped, it is rejected as truncated
+    if (!view_size) {
+        close(fd);
+        return;
+    }
+
+    void* mapping = mmap(nullptr, view_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // mapping keeps its own reference to the file
+    close(fd);
+    if (mapping == MAP_FAILED)
+        throw voice_exception::create_formatted("Couldn't map trace file {}", path.u8string());
+
+    // trace is read once from start to end
+    madvise(mapping, view_size, MADV_SEQUENTIAL);
+    view = static_cast<const std::uint8_t*>(mapping);
+}
+
+kvoice::mapped_file::~mapped_file() {
+    if (view) munmap(const_cast<std::uint8_t*>(view), view_size);
+}
+#endif
+
+kvoice::packet_trace_reader::packet_trace_reader(const std::filesystem::path& path)
+    : file(path) {
+    parse();
+}
+
+void kvoice::packet_trace_reader::parse() {
+    const auto* data = file.data();
+    const auto  size = file.size();
+
+    if (size < trace_format::kFileHeaderSize || !std::equal(trace_format::kMagic.begin(), trace_format::kMagic.end(),
+                                                            data))
+        throw voice_exception("File isn't a packet trace");
+
+    const auto version = get_le<std::uint32_t>(data + 8);
+    if (version != trace_format::kVersion)
+        throw voice_exception::create_formatted("Unsupported packet trace version {}", version);
+
+    const auto flags = get_le<std::uint32_t>(data + 20);
+    info.decode_sample_rate = get_le<std::uint32_t>(data + 12);
+    info.mixing_rate = get_le<std::uint32_t>(data + 16);
+    info.mode = flags & trace_format::kFlagCallbackMode ? playback_mode::callback : playback_mode::queued;
+    info.format = flags & trace_format::kFlagInt16 ? sample_format::int16 : sample_format::float32;
+
+    // records are counted first, so events are allocated once
+    std::size_t count = 0;
+    std::size_t offset = trace_format::kFileHeaderSize;
+    while (size - offset >= trace_format::kRecordHeaderSize) {
+        const auto payload_size = get_le<std::uint32_t>(data + offset + 4);
+        // record cut by unfinished recording is ignored
+        if (size - offset - trace_format::kRecordHeaderSize < payload_size) break;
+        offset += trace_format::kRecordHeaderSize + payload_size;
+        ++count;
+    }
+    events.reserve(count);
+
+    offset = trace_format::kFileHeaderSize;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto* record = data + offset;
+        const auto  type = get_le<std::uint32_t>(record);
+
+        trace_event event;
+        event.type = static_cast<trace_event_type>(type);
+        event.size = get_le<std::uint32_t>(record + 4);
+        event.time = get_le<std::int64_t>(record + 8);
+        event.capture_time = get_le<std::int64_t>(record + 16);
+        event.has_capture_time = event.capture_time != trace_format::kNoCaptureTime;
+        event.data = record + trace_format::kRecordHeaderSize;
+        offset += trace_format::kRecordHeaderSize + event.size;
+
+        // records of newer types are skipped
+        if (event.type != trace_event_type::packet && event.type != trace_event_type::update) continue;
+        if (!event.has_capture_time) event.capture_time = 0;
+        events.push_back(event);
+    }
+
+    // packets and updates are queued separately, so they are merged by time
+    std::stable_sort(events.begin(), events.end(), [](const trace_event& lhs, const trace_event& rhs) {
+        return lhs.time < rhs.time;
+    });
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "packet_trace.hpp"
+
+namespace kvoice {
+/**
+ * @brief read-only memory mapping of a whole file
+ */
+class mapped_file {
+public:
+    /**
+     * @brief Constructor, maps the file
+     * @param path file path
+     */
+    explicit mapped_file(const std::filesystem::path& path);
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    [[nodiscard]] const std::uint8_t* data() const noexcept { return view; }
+    [[nodiscard]] std::size_t         size() const noexcept { return view_size; }
+
+private:
+    const std::uint8_t* view{ nullptr };
+    std::size_t         view_size{ 0 };
+#ifdef _WIN32
+    void* file_handle{ nullptr };
+    void* mapping_handle{ nullptr };
+#endif
+};
+
+class packet_trace_reader final : public packet_trace {
+public:
+    /**
+     * @brief Constructor, maps the file and indexes its records
+     * @param path trace file path
+     */
+    explicit packet_trace_reader(const std::filesystem::path& path);
+
+    [[nodiscard]] const trace_info&               get_info() const noexcept override { return info; }
+    [[nodiscard]] const std::vector<trace_event>& get_events() const noexcept override { return events; }
+
+private:
+    void parse();
+
+    mapped_file              file;
+    trace_info               info{};
+    std::vector<trace_event> events{};
+};
+}
@@ -0,0 +1,78 @@
+#include "packet_trace_writer.hpp"
+
+#include <array>
+
+#include "byte_order.hpp"
+#include "packet_trace_format.hpp"
+#include "voice_exception.hpp"
+
+kvoice::packet_trace_writer::packet_trace_writer(const std::filesystem::path& path, const trace_info& info,
+                                                 std::size_t write_buffer_size)
+    : file(path, std::ios::binary | std::ios::trunc),
+      write_buffer_size(write_buffer_size) {
+    if (!file) throw voice_exception::create_formatted("Couldn't open trace file {}", path.u8string());
+
+    write_buffer.reserve(write_buffer_size);
+
+    std::uint32_t flags = 0;
+    if (info.mode == playback_mode::callback) flags |= trace_format::kFlagCallbackMode;
+    if (info.format == sample_format::int16) flags |= trace_format::kFlagInt16;
+
+    std::array<std::uint8_t, trace_format::kFileHeaderSize> header{};
+    std::copy(trace_format::kMagic.begin(), trace_format::kMagic.end(), header.begin());
+    put_le<std::uint32_t>(header.data() + 8, trace_format::kVersion);
+    put_le<std::uint32_t>(header.data() + 12, info.decode_sample_rate);
+    put_le<std::uint32_t>(header.data() + 16, info.mixing_rate);
+    put_le<std::uint32_t>(header.data() + 20, flags);
+
+    write_buffer.insert(write_buffer.end(), header.begin(), header.end());
+}
+
+kvoice::packet_trace_writer::~packet_trace_writer() {
+    try {
+        finish();
+    } catch (...) {
+    }
+}
+
+void kvoice::packet_trace_writer::write_packet(const recorded_packet& packet) {
+    write_record(trace_event_type::packet, packet.arrival_time,
+                 packet.capture_time.value_or(trace_format::kNoCaptureTime), packet.data, packet.size);
+}
+
+void kvoice::packet_trace_writer::write_update(timestamp_t time) {
+    write_record(trace_event_type::update, time, trace_format::kNoCaptureTime, nullptr, 0);
+}
+
+void kvoice::packet_trace_writer::finish() {
+    if (finished) return;
+    finished = true;
+
+    flush_buffer();
+    file.flush();
+}
+
+void kvoice::packet_trace_writer::write_record(trace_event_type type, timestamp_t time, timestamp_t capture_time,
+                                               const std::uint8_t* data, std::size_t size) {
+    if (finished) return;
+
+    std::array<std::uint8_t, trace_format::kRecordHeaderSize> header;
+    put_le<std::uint32_t>(header.data(), static_cast<std::uint32_t>(type));
+    put_le<std::uint32_t>(header.data() + 4, static_cast<std::uint32_t>(size));
+    put_le<std::int64_t>(header.data() + 8, time);
+    put_le<std::int64_t>(header.data() + 16, capture_time);
+
+    write_buffer.insert(write_buffer.end(), header.begin(), header.end());
+    if (size) write_buffer.insert(write_buffer.end(), data, data + size);
+
+    if (write_buffer.size() >= write_buffer_size)
+        flush_buffer();
+}
+
+void kvoice::packet_trace_writer::flush_buffer() {
+    if (write_buffer.empty()) return;
+
+    file.write(reinterpret_cast<const char*>(write_buffer.data()), static_cast<std::streamsize>(write_buffer.size()));
+    written_bytes += write_buffer.size();
+    write_buffer.clear();
+}
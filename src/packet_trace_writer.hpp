@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "packet_trace.hpp"
+#include "record_sink.hpp"
+
+namespace kvoice {
+/**
+ * @brief writes packets and updates of a stream to packet trace file
+ * @details records are collected in memory and written to the file in large sequential blocks
+ */
+class packet_trace_writer final : public record_sink {
+public:
+    /**
+     * @brief Constructor, writes file header
+     * @param path output file path
+     * @param info configuration of traced stream
+     * @param write_buffer_size size of data collected before writing to the file
+     */
+    packet_trace_writer(const std::filesystem::path& path, const trace_info& info, std::size_t write_buffer_size);
+    ~packet_trace_writer() override;
+
+    packet_trace_writer(const packet_trace_writer&) = delete;
+    packet_trace_writer& operator=(const packet_trace_writer&) = delete;
+
+    void write_packet(const recorded_packet& packet) override;
+    void write_update(timestamp_t time) override;
+    void finish() override;
+
+    [[nodiscard]] std::uint64_t get_written_bytes() const noexcept override { return written_bytes; }
+
+private:
+    void write_record(trace_event_type type, timestamp_t time, timestamp_t capture_time, const std::uint8_t* data,
+                      std::size_t size);
+    void flush_buffer();
+
+    std::ofstream             file;
+    std::uint64_t             written_bytes{ 0 };
+    std::vector<std::uint8_t> write_buffer{};
+    std::size_t               write_buffer_size{ 0 };
+    bool                      finished{ false };
+};
+}
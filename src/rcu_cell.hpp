@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace kvoice {
+/**
+ * @brief owning pointer that is read by one realtime thread without locks and replaced by other threads
+ * @details reader marks its critical section with an epoch counter, writer swaps the pointer and waits until
+ * the reader leaves the section that could see the old value, then deletes it on the writer thread.
+ * Writers should be serialized by the caller.
+ * @tparam T type of stored value
+ */
+template <typename T>
+class rcu_cell {
+public:
+    rcu_cell() = default;
+
+    explicit rcu_cell(std::unique_ptr<T> value)
+        : current(value.release()) {
+    }
+
+    rcu_cell(const rcu_cell&) = delete;
+    rcu_cell& operator=(const rcu_cell&) = delete;
+
+    ~rcu_cell() {
+        delete current.load();
+    }
+
+    /**
+     * @brief RAII read section, value is kept alive until the section ends
+     */
+    class read_guard {
+    public:
+        explicit read_guard(rcu_cell& cell) noexcept
+            : cell(cell) {
+            cell.epoch.fetch_add(1);
+            value = cell.current.load();
+        }
+
+        ~read_guard() {
+            cell.epoch.fetch_add(1);
+        }
+
+        read_guard(const read_guard&) = delete;
+        read_guard& operator=(const read_guard&) = delete;
+
+        T* get() const noexcept { return value; }
+        T& operator*() const noexcept { return *value; }
+        T* operator->() const noexcept { return value; }
+        explicit operator bool() const noexcept { return value != nullptr; }
+
+    private:
+        rcu_cell& cell;
+        T*        value{ nullptr };
+    };
+
+    /**
+     * @brief enters read section, should be used only by the reader thread
+     */
+    read_guard read() noexcept { return read_guard{ *this }; }
+
+    /**
+     * @brief returns current value, should be used only by writers
+     */
+    const T* peek() const noexcept { return current.load(); }
+
+    /**
+     * @brief replaces the value and deletes the old one when the reader doesn't use it anymore
+     * @param value new value
+     */
+    void replace(std::unique_ptr<T> value) {
+        T* old = current.exchange(value.release());
+
+        // odd epoch means that the reader may have loaded the old value
+        if (const auto reader_epoch = epoch.load(); reader_epoch & 1) {
+            while (epoch.load() == reader_epoch)
+                std::this_thread::yield();
+        }
+
+        delete old;
+    }
+
+private:
+    std::atomic<T*>            current{ nullptr };
+    std::atomic<std::uint64_t> epoch{ 0 };
+};
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "kv_clock.hpp"
+
+namespace kvoice {
+/**
+ * @brief packet taken from record queue
+ */
+struct recorded_packet {
+    const std::uint8_t*        data{ nullptr };
+    std::size_t                size{ 0 };
+    /**
+     * @brief duration in samples at 48 kHz
+     */
+    std::uint32_t              samples{ 0 };
+    /**
+     * @brief duration of packets dropped before this one in samples at 48 kHz
+     */
+    std::uint32_t              gap_samples{ 0 };
+    timestamp_t                arrival_time{ 0 };
+    std::optional<timestamp_t> capture_time{};
+};
+
+/**
+ * @brief output of record track, called only by recorder I/O thread
+ */
+class record_sink {
+public:
+    virtual ~record_sink() = default;
+
+    virtual void write_packet(const recorded_packet& packet) = 0;
+    /**
+     * @brief writes time of stream update
+     * @param time update time
+     */
+    virtual void write_update(timestamp_t time) = 0;
+    /**
+     * @brief completes the file, nothing is written after it
+     */
+    virtual void finish() = 0;
+
+    [[nodiscard]] virtual std::uint64_t get_written_bytes() const noexcept = 0;
+};
+}
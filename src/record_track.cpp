@@ -0,0 +1,97 @@
+#include "record_track.hpp"
+
+#include <array>
+#include <cstring>
+
+#include "clock_source.hpp"
+#include "kvoice.hpp"
+
+namespace {
+// recorded granule positions are always counted at 48 kHz
+constexpr std::int32_t kGranuleRate = 48000;
+}
+
+kvoice::record_track::record_track(const void* source, record_kind kind, std::unique_ptr<record_sink> sink)
+    : source(source),
+      kind(kind),
+      queue(std::make_unique<jnk0le::Ringbuffer<std::uint8_t, kQueueSize, true>>()),
+      sink(std::move(sink)) {
+    if (kind == record_kind::trace)
+        updates = std::make_unique<jnk0le::Ringbuffer<timestamp_t, kUpdatesQueueSize, true>>();
+}
+
+void kvoice::record_track::push(const void* data, std::size_t count,
+                                std::optional<timestamp_t> capture_time) noexcept {
+    if (is_closed()) return;
+
+    const auto arrival_time = get_clock_time();
+
+    // trace keeps invalid packets too, replayed stream should reject them the same way
+    opus_packet_info info;
+    if (!inspect_opus_packet(data, count, kGranuleRate, info)) {
+        if (kind == record_kind::audio) return;
+        info.sample_count = 0;
+    }
+
+    const auto samples = static_cast<std::uint32_t>(info.sample_count);
+
+    // header and packet are queued by one write, so consumer never sees a partial packet
+    std::array<std::uint8_t, sizeof(packet_header) + kMaxPacketSize> buffer;
+    const auto size = sizeof(packet_header) + count;
+
+    if (count > kMaxPacketSize || queue->writeAvailable() < size) {
+        dropped_packets.fetch_add(1, std::memory_order_relaxed);
+        pending_gap += samples;
+        return;
+    }
+
+    const packet_header header{ static_cast<std::uint32_t>(count), samples, pending_gap,
+                                capture_time.has_value(), arrival_time, capture_time.value_or(0) };
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    std::memcpy(buffer.data() + sizeof(header), data, count);
+    queue->writeBuff(buffer.data(), size);
+    pending_gap = 0;
+}
+
+void kvoice::record_track::push_update(timestamp_t time) noexcept {
+    if (is_closed() || !updates) return;
+
+    // lost update only makes replay update the stream less often
+    updates->insert(time);
+}
+
+void kvoice::record_track::drain() {
+    std::array<std::uint8_t, kMaxPacketSize> data;
+
+    while (queue->readAvailable() >= sizeof(packet_header)) {
+        packet_header header;
+        queue->readBuff(reinterpret_cast<std::uint8_t*>(&header), sizeof(header));
+        queue->readBuff(data.data(), header.size);
+
+        recorded_packet packet;
+        packet.data = data.data();
+        packet.size = header.size;
+        packet.samples = header.samples;
+        packet.gap_samples = header.gap_samples;
+        packet.arrival_time = header.arrival_time;
+        if (header.has_capture_time)
+            packet.capture_time = header.capture_time;
+
+        sink->write_packet(packet);
+        recorded_packets.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (updates) {
+        timestamp_t time;
+        while (updates->remove(time))
+            sink->write_update(time);
+    }
+
+    written_bytes.store(sink->get_written_bytes(), std::memory_order_relaxed);
+}
+
+void kvoice::record_track::finish() {
+    drain();
+    sink->finish();
+    written_bytes.store(sink->get_written_bytes(), std::memory_order_relaxed);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "kv_clock.hpp"
+#include "ringbuffer.hpp"
+#include "record_sink.hpp"
+
+namespace kvoice {
+/**
+ * @brief what is recorded by the track
+ */
+enum class record_kind {
+    /**
+     * @brief packets are stored to Ogg Opus file
+     */
+    audio,
+    /**
+     * @brief packets with arrival and capture times and stream updates are stored to packet trace
+     */
+    trace
+};
+
+/**
+ * @brief recorded source: packets are pushed by the source thread and written by recorder I/O thread
+ * @details packets are passed through single producer single consumer byte ring, full ring drops packets,
+ * so the source thread never waits. Duration of dropped packets is carried by the next queued packet.
+ */
+class record_track {
+    // max size of recorded packet, bigger packets are dropped
+    static constexpr std::size_t kMaxPacketSize = 4000;
+    // size of packet queue in bytes, several seconds of voice
+    static constexpr std::size_t kQueueSize = 65536;
+    // count of queued update times, several seconds of updates
+    static constexpr std::size_t kUpdatesQueueSize = 4096;
+
+    /**
+     * @brief header in front of every queued packet
+     */
+    struct packet_header {
+        std::uint32_t size;
+        std::uint32_t samples;
+        std::uint32_t gap_samples;
+        std::uint32_t has_capture_time;
+        timestamp_t   arrival_time;
+        timestamp_t   capture_time;
+    };
+public:
+    /**
+     * @brief Constructor
+     * @param source recorded source, used only as a key
+     * @param kind what is recorded
+     * @param sink output of recorded packets
+     */
+    record_track(const void* source, record_kind kind, std::unique_ptr<record_sink> sink);
+
+    /**
+     * @brief queues packet, called by the source thread
+     * @param data packet data
+     * @param count size of @p data
+     * @param capture_time sender timestamp of the packet, if known
+     */
+    void push(const void* data, std::size_t count, std::optional<timestamp_t> capture_time = std::nullopt) noexcept;
+
+    /**
+     * @brief queues time of stream update, called by the thread that updates the stream
+     * @param time update time
+     */
+    void push_update(timestamp_t time) noexcept;
+
+    /**
+     * @brief writes queued packets to the file, called by I/O thread
+     */
+    void drain();
+
+    /**
+     * @brief stops accepting packets, queued ones are still written by the next @p drain
+     */
+    void close() noexcept { closed.store(true, std::memory_order_release); }
+
+    /**
+     * @brief writes queued packets and finishes the file, called by I/O thread
+     */
+    void finish();
+
+    [[nodiscard]] bool        is_closed() const noexcept { return closed.load(std::memory_order_acquire); }
+    [[nodiscard]] const void* get_source() const noexcept { return source; }
+    [[nodiscard]] record_kind get_kind() const noexcept { return kind; }
+
+    std::atomic<std::uint64_t> recorded_packets{ 0 };
+    std::atomic<std::uint64_t> dropped_packets{ 0 };
+    std::atomic<std::uint64_t> written_bytes{ 0 };
+
+private:
+    const void*       source{ nullptr };
+    record_kind       kind{ record_kind::audio };
+    std::atomic<bool> closed{ false };
+
+    // producer side, samples of packets dropped since the last queued packet
+    std::uint32_t pending_gap{ 0 };
+
+    std::unique_ptr<jnk0le::Ringbuffer<std::uint8_t, kQueueSize, true>>       queue;
+    // allocated only for traces
+    std::unique_ptr<jnk0le::Ringbuffer<timestamp_t, kUpdatesQueueSize, true>> updates;
+    std::unique_ptr<record_sink>                                              sink;
+};
+}
@@ -0,0 +1,184 @@
+#include "recorder_impl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <type_traits>
+
+#include "ogg_opus_writer.hpp"
+#include "packet_trace_writer.hpp"
+#include "sound_input_impl.hpp"
+#include "stream_impl.hpp"
+#include "thread_utils.hpp"
+#include "voice_source_impl.hpp"
+
+kvoice::recorder_impl::recorder_impl(const recorder_options& options)
+    : options(options),
+      next_serial(std::random_device{}()) {
+    io_alive = true;
+    io_thread = start_thread(options.io_thread, [this]() { process_tracks(); });
+}
+
+kvoice::recorder_impl::~recorder_impl() {
+    {
+        std::lock_guard lck(tracks_mutex);
+        io_alive = false;
+    }
+    io_cv.notify_one();
+    io_thread.join();
+
+    // sources may outlive the recorder, their packets are ignored by closed tracks
+    for (auto& track : tracks) {
+        track->close();
+        track->finish();
+        add_finished_stats(*track);
+    }
+}
+
+void kvoice::recorder_impl::start_recording(sound_input& input, const std::filesystem::path& path) {
+    auto& impl = static_cast<sound_input_impl&>(input);
+    start_track(impl, record_kind::audio, create_audio_sink(path, impl.get_sample_rate()));
+}
+
+void kvoice::recorder_impl::start_recording(stream& s, const std::filesystem::path& path) {
+    auto& impl = static_cast<stream_impl&>(s);
+    start_track(impl, record_kind::audio, create_audio_sink(path, impl.get_decode_rate()));
+}
+
+void kvoice::recorder_impl::start_recording(voice_source& source, const std::filesystem::path& path) {
+    auto& impl = static_cast<voice_source_impl&>(source);
+    start_track(impl, record_kind::audio, create_audio_sink(path, impl.get_decode_rate()));
+}
+
+void kvoice::recorder_impl::stop_recording(sound_input& input) {
+    std::lock_guard lck(tracks_mutex);
+    stop_track(static_cast<sound_input_impl&>(input), record_kind::audio);
+}
+
+void kvoice::recorder_impl::stop_recording(stream& s) {
+    std::lock_guard lck(tracks_mutex);
+    stop_track(static_cast<stream_impl&>(s), record_kind::audio);
+}
+
+void kvoice::recorder_impl::stop_recording(voice_source& source) {
+    std::lock_guard lck(tracks_mutex);
+    stop_track(static_cast<voice_source_impl&>(source), record_kind::audio);
+}
+
+void kvoice::recorder_impl::start_trace(stream& s, const std::filesystem::path& path) {
+    auto& impl = static_cast<stream_impl&>(s);
+
+    trace_info info;
+    info.decode_sample_rate = impl.get_decode_rate();
+    info.mixing_rate = impl.get_sample_rate();
+    info.mode = impl.is_callback_mode() ? playback_mode::callback : playback_mode::queued;
+    info.format = impl.get_format();
+
+    start_track(impl, record_kind::trace, std::make_unique<packet_trace_writer>(path, info, options.write_buffer_size));
+}
+
+void kvoice::recorder_impl::stop_trace(stream& s) {
+    std::lock_guard lck(tracks_mutex);
+    stop_track(static_cast<stream_impl&>(s), record_kind::trace);
+}
+
+kvoice::recorder_stats kvoice::recorder_impl::get_stats() const {
+    std::lock_guard lck(tracks_mutex);
+
+    recorder_stats stats;
+    stats.recorded_packets = finished_packets;
+    stats.dropped_packets = finished_dropped_packets;
+    stats.written_bytes = finished_bytes;
+
+    for (const auto& track : tracks) {
+        if (!track->is_closed())
+            ++stats.active_tracks;
+        stats.recorded_packets += track->recorded_packets.load(std::memory_order_relaxed);
+        stats.dropped_packets += track->dropped_packets.load(std::memory_order_relaxed);
+        stats.written_bytes += track->written_bytes.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+std::unique_ptr<kvoice::record_sink> kvoice::recorder_impl::create_audio_sink(const std::filesystem::path& path,
+                                                                              std::uint32_t input_sample_rate) {
+    // file is opened on the calling thread, so error is reported to the caller
+    return std::make_unique<ogg_opus_writer>(path, next_serial.fetch_add(1, std::memory_order_relaxed),
+                                             input_sample_rate, options.write_buffer_size,
+                                             options.overflow == recorder_overflow::fill_silence);
+}
+
+template <typename SourceT>
+void kvoice::recorder_impl::start_track(SourceT& source, record_kind kind, std::unique_ptr<record_sink> sink) {
+    auto track = std::make_shared<record_track>(&source, kind, std::move(sink));
+
+    std::lock_guard lck(tracks_mutex);
+    stop_track(source, kind);
+    tracks.push_back(track);
+    if constexpr (std::is_same_v<SourceT, stream_impl>) {
+        if (kind == record_kind::trace) {
+            source.set_trace_track(std::move(track));
+            return;
+        }
+    }
+    source.set_record_track(std::move(track));
+}
+
+template <typename SourceT>
+void kvoice::recorder_impl::stop_track(SourceT& source, record_kind kind) {
+    const auto it = std::find_if(tracks.begin(), tracks.end(), [&source, kind](const auto& track) {
+        return track->get_source() == &source && track->get_kind() == kind && !track->is_closed();
+    });
+    if (it == tracks.end()) return;
+
+    if constexpr (std::is_same_v<SourceT, stream_impl>) {
+        if (kind == record_kind::trace)
+            source.set_trace_track(nullptr);
+        else
+            source.set_record_track(nullptr);
+    } else {
+        source.set_record_track(nullptr);
+    }
+    (*it)->close();
+    io_cv.notify_one();
+}
+
+void kvoice::recorder_impl::process_tracks() {
+    std::vector<std::shared_ptr<record_track>> active;
+    std::vector<std::shared_ptr<record_track>> finished;
+
+    std::unique_lock lck(tracks_mutex);
+    while (io_alive) {
+        io_cv.wait_for(lck, std::chrono::milliseconds{ options.write_interval_ms });
+
+        // track, that is referenced only by the recorder, belongs to destroyed source
+        for (auto& track : tracks) {
+            if (track->is_closed() || track.use_count() == 1)
+                finished.push_back(track);
+            else
+                active.push_back(track);
+        }
+
+        // files are written without the lock, so control threads aren't blocked by disk
+        lck.unlock();
+        for (auto& track : active)
+            track->drain();
+        for (auto& track : finished)
+            track->finish();
+        lck.lock();
+
+        for (auto& track : finished) {
+            add_finished_stats(*track);
+            tracks.erase(std::find(tracks.begin(), tracks.end(), track));
+        }
+
+        active.clear();
+        finished.clear();
+    }
+}
+
+void kvoice::recorder_impl::add_finished_stats(const record_track& track) {
+    finished_packets += track.recorded_packets.load(std::memory_order_relaxed);
+    finished_dropped_packets += track.dropped_packets.load(std::memory_order_relaxed);
+    finished_bytes += track.written_bytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "recorder.hpp"
+#include "record_track.hpp"
+
+namespace kvoice {
+class recorder_impl final : public recorder {
+public:
+    /**
+     * @brief Constructor, starts I/O thread
+     * @param options recorder options
+     */
+    explicit recorder_impl(const recorder_options& options);
+    ~recorder_impl() override;
+
+    void start_recording(sound_input& input, const std::filesystem::path& path) override;
+    void start_recording(stream& s, const std::filesystem::path& path) override;
+    void start_recording(voice_source& source, const std::filesystem::path& path) override;
+
+    void stop_recording(sound_input& input) override;
+    void stop_recording(stream& s) override;
+    void stop_recording(voice_source& source) override;
+
+    void start_trace(stream& s, const std::filesystem::path& path) override;
+    void stop_trace(stream& s) override;
+
+    recorder_stats get_stats() const override;
+private:
+    std::unique_ptr<record_sink> create_audio_sink(const std::filesystem::path& path, std::uint32_t input_sample_rate);
+
+    template <typename SourceT>
+    void start_track(SourceT& source, record_kind kind, std::unique_ptr<record_sink> sink);
+    // should be called with locked tracks mutex
+    template <typename SourceT>
+    void stop_track(SourceT& source, record_kind kind);
+
+    void process_tracks();
+    // should be called with locked tracks mutex
+    void add_finished_stats(const record_track& track);
+
+    recorder_options options;
+
+    mutable std::mutex                         tracks_mutex;
+    std::vector<std::shared_ptr<record_track>> tracks{};
+    std::atomic<std::uint32_t>                 next_serial{ 0 };
+    std::uint64_t                              finished_packets{ 0 };
+    std::uint64_t                              finished_dropped_packets{ 0 };
+    std::uint64_t                              finished_bytes{ 0 };
+
+    std::condition_variable io_cv;
+    bool                    io_alive{ false };
+    std::thread             io_thread;
+};
+}
@@ -0,0 +1,112 @@
+#include "resampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "simd.hpp"
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kKaiserBeta = 8.0;
+// passband edge relative to the lower of input and output Nyquist frequencies
+constexpr double kCutoff = 0.92;
+
+// zeroth order modified Bessel function of the first kind
+double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+}
+
+kvoice::resampler::resampler(std::uint32_t input_rate, std::uint32_t output_rate, std::size_t max_input,
+                             std::pmr::memory_resource* memory)
+    : input_rate(input_rate),
+      output_rate(output_rate),
+      step(static_cast<double>(input_rate) / output_rate),
+      filter((kPhases + 1) * kTaps, memory),
+      // one filter length is kept between calls, another one is a margin for the position running ahead of it
+      history(max_input + 2 * kTaps, 0.f, memory) {
+    const double cutoff = kCutoff * std::min(1.0, static_cast<double>(output_rate) / input_rate);
+    const double i0_beta = bessel_i0(kKaiserBeta);
+
+    // row p holds taps for output sample located p / kPhases after the center input sample
+    for (std::size_t p = 0; p <= kPhases; ++p) {
+        for (std::size_t j = 0; j < kTaps; ++j) {
+            const double distance = static_cast<double>(p) / kPhases + static_cast<double>(kHalfTaps - 1) - j;
+            const double x = distance / kHalfTaps;
+
+            double value = 0.0;
+            if (std::abs(x) < 1.0) {
+                const double sinc = distance == 0.0
+                                        ? 1.0
+                                        : std::sin(kPi * cutoff * distance) / (kPi * cutoff * distance);
+                value = cutoff * sinc * bessel_i0(kKaiserBeta * std::sqrt(1.0 - x * x)) / i0_beta;
+            }
+            filter[p * kTaps + j] = static_cast<float>(value);
+        }
+    }
+
+    reset();
+}
+
+std::size_t kvoice::resampler::process(const float* input, std::size_t input_count, float* output,
+                                       std::size_t output_capacity) {
+    const auto accepted = std::min(input_count, history.size() - history_size);
+    std::copy_n(input, accepted, history.begin() + static_cast<std::ptrdiff_t>(history_size));
+    history_size += accepted;
+
+    std::size_t produced = 0;
+    while (produced < output_capacity) {
+        const auto center = static_cast<std::size_t>(position);
+        if (center + kHalfTaps >= history_size) break;
+
+        output[produced++] = interpolate(&history[center + 1 - kHalfTaps], position - center);
+        position += step;
+    }
+
+    // keep only samples that are needed by next output samples
+    const auto consumed = std::min(static_cast<std::size_t>(position) + 1 - kHalfTaps, history_size);
+    std::copy(history.begin() + static_cast<std::ptrdiff_t>(consumed),
+              history.begin() + static_cast<std::ptrdiff_t>(history_size), history.begin());
+    history_size -= consumed;
+    position -= static_cast<double>(consumed);
+
+    return produced;
+}
+
+std::size_t kvoice::resampler::get_max_output(std::size_t input_count) const {
+    // history never holds more than one filter length between calls
+    return static_cast<std::size_t>(std::ceil((input_count + kTaps) / step)) + 1;
+}
+
+std::size_t kvoice::resampler::get_max_input(std::size_t output_capacity) const {
+    const double count = std::floor((static_cast<double>(output_capacity) - 1.0) * step) - kTaps;
+    return count > 0.0 ? static_cast<std::size_t>(count) : 0;
+}
+
+void kvoice::resampler::set_correction(double correction) noexcept {
+    step = static_cast<double>(input_rate) / output_rate * correction;
+}
+
+void kvoice::resampler::reset() {
+    // first output sample is aligned with first input sample
+    std::fill_n(history.begin(), kHalfTaps - 1, 0.f);
+    history_size = kHalfTaps - 1;
+    position = static_cast<double>(kHalfTaps - 1);
+}
+
+float kvoice::resampler::interpolate(const float* window, double phase) const {
+    const double scaled = phase * kPhases;
+    const auto   index = static_cast<std::size_t>(scaled);
+    const auto   fraction = static_cast<float>(scaled - index);
+
+    const float first = simd::dot(window, filter.data() + index * kTaps, kTaps);
+    const float second = simd::dot(window, filter.data() + (index + 1) * kTaps, kTaps);
+    return first + (second - first) * fraction;
+}
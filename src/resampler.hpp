@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace kvoice {
+/**
+ * @brief checks that opus codec supports sampling rate
+ * @param sample_rate sampling rate
+ * @return true if opus can encode and decode at @p sample_rate
+ */
+constexpr bool is_opus_sample_rate(std::uint32_t sample_rate) noexcept {
+    return sample_rate == 8000 || sample_rate == 12000 || sample_rate == 16000 || sample_rate == 24000 ||
+           sample_rate == 48000;
+}
+
+/**
+ * @brief returns the lowest opus sampling rate that keeps full bandwidth of @p sample_rate
+ * @param sample_rate sampling rate
+ * @return opus sampling rate
+ */
+constexpr std::uint32_t get_opus_sample_rate(std::uint32_t sample_rate) noexcept {
+    for (std::uint32_t rate : { 8000u, 12000u, 16000u, 24000u }) {
+        if (sample_rate <= rate) return rate;
+    }
+    return 48000;
+}
+
+/**
+ * @brief streaming polyphase windowed-sinc resampler for mono float audio
+ * @details filter bank holds @p kPhases sub-filters of @p kTaps taps, output is interpolated linearly between
+ * adjacent phases, so the ratio may be arbitrary
+ */
+class resampler {
+    static constexpr std::size_t kPhases = 256;
+    static constexpr std::size_t kTaps = 32;
+    static constexpr std::size_t kHalfTaps = kTaps / 2;
+
+public:
+    /**
+     * @brief Constructor
+     * @param input_rate input sampling rate
+     * @param output_rate output sampling rate
+     * @param max_input max count of input samples passed to one call of @p process
+     * @param memory resource of filter bank and history
+     */
+    resampler(std::uint32_t input_rate, std::uint32_t output_rate, std::size_t max_input,
+              std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+    /**
+     * @brief resamples input, keeps filter history between calls
+     * @details history is allocated by constructor, so the call doesn't allocate. Input that doesn't fit to the
+     * free history is dropped, it never happens while @p input_count is at most @p max_input of constructor and
+     * @p output_capacity is at least @p get_max_output(input_count)
+     * @param input input samples
+     * @param input_count count of input samples
+     * @param output output buffer
+     * @param output_capacity size of @p output, should be at least @p get_max_output(input_count)
+     * @return count of samples written to @p output
+     */
+    std::size_t process(const float* input, std::size_t input_count, float* output, std::size_t output_capacity);
+
+    /**
+     * @brief returns max count of output samples produced from @p input_count input samples in one call
+     * @param input_count count of input samples
+     * @return max count of output samples
+     */
+    [[nodiscard]] std::size_t get_max_output(std::size_t input_count) const;
+
+    /**
+     * @brief returns max count of input samples that may be passed to one call producing up to @p output_capacity
+     * @param output_capacity size of output buffer
+     * @return max count of input samples
+     */
+    [[nodiscard]] std::size_t get_max_input(std::size_t output_capacity) const;
+
+    /**
+     * @brief adjusts conversion ratio, used to follow clock drift between input and output
+     * @param correction multiplier of input samples consumed per output sample, 1 keeps the nominal ratio
+     */
+    void set_correction(double correction) noexcept;
+
+    /**
+     * @brief drops filter history
+     */
+    void reset();
+
+    [[nodiscard]] std::uint32_t get_input_rate() const { return input_rate; }
+    [[nodiscard]] std::uint32_t get_output_rate() const { return output_rate; }
+    /**
+     * @brief returns count of input samples consumed per output sample, including correction
+     */
+    [[nodiscard]] double get_step() const noexcept { return step; }
+
+private:
+    float interpolate(const float* window, double phase) const;
+
+    std::uint32_t input_rate{ 0 };
+    std::uint32_t output_rate{ 0 };
+
+    // input samples per output sample
+    double step{ 1.0 };
+    // position of next output sample in history
+    double position{ 0.0 };
+
+    std::pmr::vector<float> filter;
+    // fixed size storage, only first history_size samples are valid
+    std::pmr::vector<float> history;
+    std::size_t             history_size{ 0 };
+};
+
+/**
+ * @brief resampler, that pulls its input from a source and always fills requested output while the source has input
+ * @details resampler holds back a filter length of input, so a small request alone would produce nothing. Input is
+ * taken for the whole request and output produced beyond it is kept for the next call
+ */
+class buffered_resampler {
+public:
+    /**
+     * @brief Constructor
+     * @param input_rate input sampling rate
+     * @param output_rate output sampling rate
+     * @param max_input max count of input samples taken from the source at once
+     * @param memory resource of resampler and buffers
+     */
+    buffered_resampler(std::uint32_t input_rate, std::uint32_t output_rate, std::size_t max_input,
+                       std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : converter(input_rate, output_rate, max_input, memory),
+          input(max_input, 0.f, memory),
+          pending(converter.get_max_output(max_input), 0.f, memory) {}
+
+    /**
+     * @brief produces up to @p capacity samples
+     * @param output output buffer
+     * @param capacity size of @p output
+     * @param source callable std::size_t(float* buffer, std::size_t capacity), returns count of written input samples
+     * @return count of samples written to @p output, less than @p capacity only if the source ran out of input
+     */
+    template <typename Source>
+    std::size_t pull(float* output, std::size_t capacity, Source&& source) {
+        std::size_t produced = take_pending(output, capacity);
+        while (produced < capacity) {
+            // input for the rest of request, remainder of rounding is kept as pending output
+            const auto wanted = static_cast<std::size_t>(std::ceil((capacity - produced) * converter.get_step()));
+            const auto readed = source(input.data(), std::min(wanted, input.size()));
+            if (readed == 0) break;
+
+            pending_count = converter.process(input.data(), readed, pending.data(), pending.size());
+            pending_offset = 0;
+            produced += take_pending(output + produced, capacity - produced);
+        }
+        return produced;
+    }
+
+    /**
+     * @brief adjusts conversion ratio, see @p resampler::set_correction
+     */
+    void set_correction(double correction) noexcept { converter.set_correction(correction); }
+
+    /**
+     * @brief returns count of produced samples, that weren't pulled yet
+     */
+    [[nodiscard]] std::size_t get_buffered() const noexcept { return pending_count - pending_offset; }
+
+private:
+    std::size_t take_pending(float* output, std::size_t capacity) noexcept {
+        const auto count = std::min(capacity, pending_count - pending_offset);
+        std::copy_n(pending.data() + pending_offset, count, output);
+        pending_offset += count;
+        return count;
+    }
+
+    resampler               converter;
+    std::pmr::vector<float> input;
+    std::pmr::vector<float> pending;
+    std::size_t             pending_count{ 0 };
+    std::size_t             pending_offset{ 0 };
+};
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+
+#include "memory.hpp"
+#include "ringbuffer.hpp"
+#include "sample_format.hpp"
+#include "simd.hpp"
+
+namespace kvoice {
+/**
+ * @brief single producer single consumer ring of PCM samples with selectable storage format
+ * @details samples are written and read as floats and converted to storage format on the fly, 16-bit storage
+ * takes a half of float ring memory. Only the ring of selected format is allocated.
+ * @tparam Size capacity in samples
+ */
+template <std::size_t Size>
+class sample_ring {
+    static constexpr std::size_t kConvertChunkSize = 512;
+
+    template <typename T>
+    using ring_t = jnk0le::Ringbuffer<T, Size, true>;
+
+public:
+    /**
+     * @brief Constructor
+     * @param format storage format
+     * @param memory resource, that provides ring memory
+     */
+    explicit sample_ring(sample_format format, std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+        if (format == sample_format::int16)
+            pcm16 = make_resource_ptr<ring_t<std::int16_t>>(memory);
+        else
+            pcm32 = make_resource_ptr<ring_t<float>>(memory);
+    }
+
+    [[nodiscard]] sample_format get_format() const noexcept {
+        return pcm16 ? sample_format::int16 : sample_format::float32;
+    }
+
+    [[nodiscard]] std::size_t readAvailable() const {
+        return pcm16 ? pcm16->readAvailable() : pcm32->readAvailable();
+    }
+
+    [[nodiscard]] std::size_t writeAvailable() const {
+        return pcm16 ? pcm16->writeAvailable() : pcm32->writeAvailable();
+    }
+
+    [[nodiscard]] bool isEmpty() const {
+        return readAvailable() == 0;
+    }
+
+    std::size_t remove(std::size_t count) {
+        return pcm16 ? pcm16->remove(count) : pcm32->remove(count);
+    }
+
+    std::size_t writeBuff(const float* samples, std::size_t count) {
+        if (pcm32) return pcm32->writeBuff(samples, count);
+
+        // producer is the only one who decreases free space, so every chunk fits
+        count = std::min(count, writeAvailable());
+
+        std::array<std::int16_t, kConvertChunkSize> chunk;
+        for (std::size_t written = 0; written < count;) {
+            const auto size = std::min(count - written, chunk.size());
+            simd::convert(chunk.data(), samples + written, size);
+            written += pcm16->writeBuff(chunk.data(), size);
+        }
+        return count;
+    }
+
+    std::size_t writeBuff(const std::int16_t* samples, std::size_t count) {
+        if (pcm16) return pcm16->writeBuff(samples, count);
+
+        count = std::min(count, writeAvailable());
+
+        std::array<float, kConvertChunkSize> chunk;
+        for (std::size_t written = 0; written < count;) {
+            const auto size = std::min(count - written, chunk.size());
+            simd::convert(chunk.data(), samples + written, size);
+            written += pcm32->writeBuff(chunk.data(), size);
+        }
+        return count;
+    }
+
+    std::size_t readBuff(float* samples, std::size_t count) {
+        if (pcm32) return pcm32->readBuff(samples, count);
+
+        // consumer is the only one who decreases available samples
+        count = std::min(count, readAvailable());
+
+        std::array<std::int16_t, kConvertChunkSize> chunk;
+        for (std::size_t readed = 0; readed < count;) {
+            const auto size = pcm16->readBuff(chunk.data(), std::min(count - readed, chunk.size()));
+            simd::convert(samples + readed, chunk.data(), size);
+            readed += size;
+        }
+        return count;
+    }
+
+private:
+    resource_ptr<ring_t<float>>        pcm32{};
+    resource_ptr<ring_t<std::int16_t>> pcm16{};
+};
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#   define KVOICE_SIMD_SSE
+#   include <xmmintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define KVOICE_SIMD_SSE2
+#   include <emmintrin.h>
+#endif
+
+namespace kvoice::simd {
+#ifdef KVOICE_SIMD_SSE
+/**
+ * @brief sums four lanes of sse register
+ */
+inline float horizontal_sum(__m128 v) {
+    __m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    sums = _mm_add_ss(sums, shuffled);
+    return _mm_cvtss_f32(sums);
+}
+#endif
+
+/**
+ * @brief calculates dot product of two arrays
+ * @param a first array
+ * @param b second array
+ * @param count count of elements in both arrays
+ * @return sum of products
+ */
+inline float dot(const float* a, const float* b, std::size_t count) {
+    float result = 0.f;
+#ifdef KVOICE_SIMD_SSE
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; count >= 8; count -= 8, a += 8, b += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + 4), _mm_loadu_ps(b + 4)));
+    }
+    result = horizontal_sum(_mm_add_ps(acc0, acc1));
+#endif
+    for (std::size_t i = 0; i < count; ++i)
+        result += a[i] * b[i];
+    return result;
+}
+
+/**
+ * @brief multiplies every element of array by gain in place
+ * @param data array
+ * @param count count of elements in @p data
+ * @param gain multiplier
+ */
+inline void scale(float* data, std::size_t count, float gain) {
+    std::size_t i = 0;
+#ifdef KVOICE_SIMD_SSE
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), g));
+#endif
+    for (; i < count; ++i)
+        data[i] *= gain;
+}
+
+/**
+ * @brief multiplies every element of source array by gain and stores it to destination array
+ * @param dst destination array
+ * @param src source array
+ * @param count count of elements in both arrays
+ * @param gain multiplier
+ */
+inline void scale(float* dst, const float* src, std::size_t count, float gain) {
+    std::size_t i = 0;
+#ifdef KVOICE_SIMD_SSE
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+#endif
+    for (; i < count; ++i)
+        dst[i] = src[i] * gain;
+}
+
+/**
+ * @brief multiplies two arrays element by element
+ * @param dst destination array
+ * @param a first array
+ * @param b second array
+ * @param count count of elements in all arrays
+ */
+inline void multiply(float* dst, const float* a, const float* b, std::size_t count) {
+    std::size_t i = 0;
+#ifdef KVOICE_SIMD_SSE
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+#endif
+    for (; i < count; ++i)
+        dst[i] = a[i] * b[i];
+}
+
+/**
+ * @brief multiplies two arrays element by element and adds third one
+ * @param dst destination array, may be the same as @p c
+ * @param a first array
+ * @param b second array
+ * @param c added array
+ * @param count count of elements in all arrays
+ */
+inline void multiply_add(float* dst, const float* a, const float* b, const float* c, std::size_t count) {
+    std::size_t i = 0;
+#ifdef KVOICE_SIMD_SSE
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)),
+                                          _mm_loadu_ps(c + i)));
+#endif
+    for (; i < count; ++i)
+        dst[i] = a[i] * b[i] + c[i];
+}
+
+/**
+ * @brief adds source array multiplied by gain to destination array
+ * @param dst destination array
+ * @param src source array
+ * @param count count of elements in both arrays
+ * @param gain multiplier of @p src
+ */
+inline void accumulate(float* dst, const float* src, std::size_t count, float gain) {
+    std::size_t i = 0;
+#ifdef KVOICE_SIMD_SSE
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+        _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(_mm_loadu_ps(src + i + 4), g)));
+    }
+#endif
+    for (; i < count; ++i)
+        dst[i] += src[i] * gain;
+}
+
+/**
+ * @brief returns max absolute value of array
+ * @param data array
+ * @param count count of elements in @p data
+ * @return peak value
+ */
+inline float peak(const float* data, std::size_t count) {
+    float       result = 0.f;
+    std::size_t i = 0;
+#ifdef KVOICE_SIMD_SSE
+    const __m128 sign_mask = _mm_set1_ps(-0.f);
+    __m128       max = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+        max = _mm_max_ps(max, _mm_andnot_ps(sign_mask, _mm_loadu_ps(data + i)));
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, max);
+    result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+    for (; i < count; ++i)
+        result = std::max(result, std::abs(data[i]));
+    return result;
+}
+
+/**
+ * @brief accumulates sum of squares and max absolute value of array in one pass
+ * @param data array
+ * @param count count of elements in @p data
+ * @param[in,out] sum_squares sum, that squares are added to
+ * @param[in,out] peak max value, that is raised by absolute values
+ */
+inline void measure(const float* data, std::size_t count, float& sum_squares, float& peak) {
+    std::size_t i = 0;
+#ifdef KVOICE_SIMD_SSE
+    const __m128 sign_mask = _mm_set1_ps(-0.f);
+    __m128       acc = _mm_setzero_ps();
+    __m128       max = _mm_set1_ps(peak);
+    for (; i + 4 <= count; i += 4) {
+        const __m128 v = _mm_loadu_ps(data + i);
+        acc = _mm_add_ps(acc, _mm_mul_ps(v, v));
+        max = _mm_max_ps(max, _mm_andnot_ps(sign_mask, v));
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, max);
+    peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    sum_squares += horizontal_sum(acc);
+#endif
+    for (; i < count; ++i) {
+        sum_squares += data[i] * data[i];
+        peak = std::max(peak, std::abs(data[i]));
+    }
+}
+
+/**
+ * @brief accumulates sum of squares and max absolute value of 16-bit samples in one pass
+ * @details values are normalized to range [-1, 1]
+ * @param data array
+ * @param count count of elements in @p data
+ * @param[in,out] sum_squares sum, that squares are added to
+ * @param[in,out] peak max value, that is raised by absolute values
+ */
+inline void measure(const std::int16_t* data, std::size_t count, float& sum_squares, float& peak) {
+    // integer accumulation is exact for any frame size
+    std::int64_t sum = 0;
+    std::int32_t max = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::int32_t v = data[i];
+        sum += v * v;
+        max = std::max(max, v < 0 ? -v : v);
+    }
+
+    constexpr float kScale = 1.f / 32768.f;
+    sum_squares += static_cast<float>(sum) * kScale * kScale;
+    peak = std::max(peak, static_cast<float>(max) * kScale);
+}
+
+/**
+ * @brief multiplies array by gain that changes linearly along the array
+ * @param data array
+ * @param count count of elements in @p data
+ * @param from gain of the first element
+ * @param to gain after the last element
+ */
+inline void ramp(float* data, std::size_t count, float from, float to) {
+    if (from == to) {
+        scale(data, count, from);
+        return;
+    }
+
+    const float step = (to - from) / static_cast<float>(count);
+    std::size_t i = 0;
+#ifdef KVOICE_SIMD_SSE
+    __m128       gain = _mm_setr_ps(from, from + step, from + 2.f * step, from + 3.f * step);
+    const __m128 increment = _mm_set1_ps(4.f * step);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), gain));
+        gain = _mm_add_ps(gain, increment);
+    }
+#endif
+    for (; i < count; ++i)
+        data[i] *= from + step * static_cast<float>(i);
+}
+
+/**
+ * @brief converts float samples to 16-bit integer samples with rounding and saturation
+ * @param dst destination array
+ * @param src source array with samples in range [-1, 1]
+ * @param count count of elements in both arrays
+ */
+inline void convert(std::int16_t* dst, const float* src, std::size_t count) {
+    std::size_t i = 0;
+#ifdef KVOICE_SIMD_SSE2
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+    const __m128 max = _mm_set1_ps(32767.f);
+    for (; i + 8 <= count; i += 8) {
+        const __m128 lo = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), min), max);
+        const __m128 hi = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), min), max);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi)));
+    }
+#endif
+    for (; i < count; ++i)
+        dst[i] = static_cast<std::int16_t>(std::lrint(std::clamp(src[i] * 32768.f, -32768.f, 32767.f)));
+}
+
+/**
+ * @brief converts 16-bit integer samples to float samples
+ * @param dst destination array
+ * @param src source array
+ * @param count count of elements in both arrays
+ * @param gain multiplier applied to samples in range [-1, 1]
+ */
+inline void convert(float* dst, const std::int16_t* src, std::size_t count, float gain = 1.f) {
+    const float scale = gain / 32768.f;
+    std::size_t i = 0;
+#ifdef KVOICE_SIMD_SSE2
+    const __m128 g = _mm_set1_ps(scale);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // sign extension of 16-bit lanes by arithmetic shift of duplicated halves
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), g));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), g));
+    }
+#endif
+    for (; i < count; ++i)
+        dst[i] = static_cast<float>(src[i]) * scale;
+}
+}
@@ -0,0 +1,129 @@
+#include <AL/al.h>
+#include "sound_clip_impl.hpp"
+
+#include <algorithm>
+
+#include <opus.h>
+
+#include "resampler.hpp"
+#include "simd.hpp"
+#include "voice_exception.hpp"
+
+namespace {
+// resampler holds back half of its filter, silence pushes the end of the clip out
+constexpr std::size_t kResamplerTail = 32;
+// opus packet is at most 120 ms
+constexpr std::size_t kMaxPacketSamples = 5760;
+
+std::pmr::vector<std::int16_t> to_mixing_rate(std::pmr::vector<float>& samples, std::uint32_t sample_rate,
+                                              std::uint32_t mixing_rate, std::pmr::memory_resource* memory) {
+    std::pmr::vector<std::int16_t> result{ memory };
+
+    if (sample_rate == mixing_rate) {
+        result.resize(samples.size());
+        kvoice::simd::convert(result.data(), samples.data(), samples.size());
+        return result;
+    }
+
+    samples.resize(samples.size() + kResamplerTail, 0.f);
+    // clip is converted by one call while it is loaded
+    kvoice::resampler clip_resampler{ sample_rate, mixing_rate, samples.size(), memory };
+
+    std::pmr::vector<float> resampled(clip_resampler.get_max_output(samples.size()), 0.f, memory);
+    resampled.resize(clip_resampler.process(samples.data(), samples.size(), resampled.data(), resampled.size()));
+
+    result.resize(resampled.size());
+    kvoice::simd::convert(result.data(), resampled.data(), resampled.size());
+    return result;
+}
+}
+
+kvoice::sound_clip_impl::sound_clip_impl(sound_output_impl* output, std::pmr::vector<std::int16_t> samples,
+                                         std::uint32_t sample_rate)
+    : samples(std::move(samples)),
+      sample_rate(sample_rate),
+      release_connection(output->release_context_signal.scoped_connect([this]() { release(); })),
+      restore_connection(output->restore_context_signal.scoped_connect([this]() { upload(); })) {
+    if (!upload())
+        throw voice_exception("Failed to create clip buffer");
+}
+
+kvoice::sound_clip_impl::~sound_clip_impl() {
+    release();
+}
+
+std::uint32_t kvoice::sound_clip_impl::get_duration_ms() const {
+    return static_cast<std::uint32_t>(samples.size() * 1000 / sample_rate);
+}
+
+bool kvoice::sound_clip_impl::upload() {
+    alGenBuffers(1, &buffer);
+    if (alGetError() != AL_NO_ERROR) {
+        buffer = 0;
+        return false;
+    }
+
+    alBufferData(buffer, AL_FORMAT_MONO16, samples.data(),
+                 static_cast<ALsizei>(samples.size() * sizeof(std::int16_t)), static_cast<ALsizei>(sample_rate));
+    if (alGetError() != AL_NO_ERROR) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+void kvoice::sound_clip_impl::release() noexcept {
+    if (!buffer) return;
+
+    alDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
+
+std::pmr::vector<std::int16_t> kvoice::convert_clip(const void* samples, std::size_t count, sample_format format,
+                                                    std::uint32_t sample_rate, std::uint32_t mixing_rate,
+                                                    std::pmr::memory_resource* memory) {
+    if (!sample_rate) throw voice_exception("Clip sampling rate can't be 0");
+
+    std::pmr::vector<float> input(count, 0.f, memory);
+    if (format == sample_format::int16)
+        simd::convert(input.data(), static_cast<const std::int16_t*>(samples), count);
+    else
+        std::copy_n(static_cast<const float*>(samples), count, input.begin());
+
+    return to_mixing_rate(input, sample_rate, mixing_rate, memory);
+}
+
+std::pmr::vector<std::int16_t> kvoice::decode_opus_clip(const void* const* packets, const std::size_t* sizes,
+                                                        std::size_t count, std::uint32_t decode_rate,
+                                                        std::uint32_t mixing_rate,
+                                                        std::pmr::memory_resource* memory) {
+    // decoder is needed only while the clip is loaded
+    auto* decoder = static_cast<OpusDecoder*>(memory->allocate(opus_decoder_get_size(1),
+                                                               alignof(std::max_align_t)));
+    const auto free_decoder = [memory, decoder]() {
+        memory->deallocate(decoder, opus_decoder_get_size(1), alignof(std::max_align_t));
+    };
+
+    if (const int opus_err = opus_decoder_init(decoder, static_cast<opus_int32>(decode_rate), 1);
+        opus_err != OPUS_OK) {
+        free_decoder();
+        throw voice_exception::create_formatted("Failed to opus decoder (errc = {})", opus_err);
+    }
+
+    std::pmr::vector<float> decoded{ memory };
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto offset = decoded.size();
+        decoded.resize(offset + kMaxPacketSamples);
+        const int samples = opus_decode_float(decoder, static_cast<const unsigned char*>(packets[i]),
+                                              static_cast<opus_int32>(sizes[i]), decoded.data() + offset,
+                                              static_cast<int>(kMaxPacketSamples), 0);
+        if (samples < 0) {
+            free_decoder();
+            throw voice_exception::create_formatted("Failed to decode packet {} of clip (errc = {})", i, samples);
+        }
+        decoded.resize(offset + static_cast<std::size_t>(samples));
+    }
+    free_decoder();
+
+    return to_mixing_rate(decoded, decode_rate, mixing_rate, memory);
+}
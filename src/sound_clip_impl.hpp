@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "sound_clip.hpp"
+#include "sample_format.hpp"
+#include "sound_output_impl.hpp"
+
+namespace kvoice {
+class sound_clip_impl final : public sound_clip {
+    static void _foo() {
+    }
+
+    using sconnection_t = decltype(sound_output_impl::release_context_signal.scoped_connect(&_foo));
+
+public:
+    /**
+     * @brief Constructor, uploads samples to OpenAL buffer
+     * @param output output, that owns the context of the buffer
+     * @param samples mono samples at output mixing rate
+     * @param sample_rate output mixing rate
+     * @throws voice_exception if buffer couldn't be created
+     */
+    sound_clip_impl(sound_output_impl* output, std::pmr::vector<std::int16_t> samples, std::uint32_t sample_rate);
+    ~sound_clip_impl() override;
+
+    sound_clip_impl(const sound_clip_impl&) = delete;
+    sound_clip_impl& operator=(const sound_clip_impl&) = delete;
+
+    std::size_t   get_sample_count() const override { return samples.size(); }
+    std::uint32_t get_duration_ms() const override;
+
+    /**
+     * @brief returns OpenAL buffer(0 if the context was recreated and upload failed)
+     */
+    [[nodiscard]] std::uint32_t get_buffer() const noexcept { return buffer; }
+
+private:
+    bool upload();
+    void release() noexcept;
+
+    // samples are kept to upload them again when the context is recreated on another device
+    std::pmr::vector<std::int16_t> samples;
+    std::uint32_t                  sample_rate{ 0 };
+    std::uint32_t                  buffer{ 0 };
+
+    sconnection_t release_connection;
+    sconnection_t restore_connection;
+};
+
+/**
+ * @brief converts PCM clip to 16-bit samples at output mixing rate
+ * @param samples mono samples
+ * @param count count of samples
+ * @param format format of @p samples
+ * @param sample_rate sampling rate of @p samples
+ * @param mixing_rate output mixing rate
+ * @param memory resource of result
+ * @return converted samples
+ */
+std::pmr::vector<std::int16_t> convert_clip(const void* samples, std::size_t count, sample_format format,
+                                            std::uint32_t sample_rate, std::uint32_t mixing_rate,
+                                            std::pmr::memory_resource* memory);
+
+/**
+ * @brief decodes opus packets of a clip to 16-bit samples at output mixing rate
+ * @param packets opus packets
+ * @param sizes sizes of @p packets
+ * @param count count of packets
+ * @param decode_rate opus decoder sampling rate
+ * @param mixing_rate output mixing rate
+ * @param memory resource of result and decoder state
+ * @return decoded samples
+ * @throws voice_exception if packet couldn't be decoded
+ */
+std::pmr::vector<std::int16_t> decode_opus_clip(const void* const* packets, const std::size_t* sizes,
+                                                std::size_t count, std::uint32_t decode_rate,
+                                                std::uint32_t mixing_rate, std::pmr::memory_resource* memory);
+}
@@ -7,38 +7,72 @@
 
 #include <algorithm>
 #include <array>
+#include <vector>
 
+#include "clock_source.hpp"
+#include "latency_params.hpp"
+#include "record_track.hpp"
+#include "simd.hpp"
+#include "thread_utils.hpp"
 #include "voice_exception.hpp"
 
 kvoice::sound_input_impl::sound_input_impl(std::string_view device_name, std::int32_t        sample_rate,
-                                           std::int32_t     frames_per_buffer, std::uint32_t bitrate)
-    : sample_rate_(sample_rate),
+                                           std::int32_t     frames_per_buffer, std::uint32_t bitrate,
+                                           const sound_input_options& options)
+    : memory(options.memory_resource),
+      bitrate_(bitrate),
+      sample_rate_(sample_rate),
       frames_per_buffer_(frames_per_buffer),
-      input_device(alcCaptureOpenDevice(device_name.data(), sample_rate, AL_FORMAT_MONO_FLOAT32, frames_per_buffer)) {
+      capture_format_(options.capture_format),
+      al_capture_format_(options.capture_format == sample_format::int16 ? AL_FORMAT_MONO16 : AL_FORMAT_MONO_FLOAT32),
+      capture_thread_options_(options.capture_thread),
+      device_thread_options_(options.device_thread),
+      requested_latency(options.latency),
+      encoder_latency(options.latency),
+      input_device(alcCaptureOpenDevice(device_name.data(), sample_rate, al_capture_format_, frames_per_buffer)) {
 
     if (!input_device) throw voice_exception::create_formatted("Couldn't open capture device {}", device_name);
 
     sleep_time = std::chrono::milliseconds{ frames_per_buffer * 500 / sample_rate };
 
-    int opus_err;
-    encoder = opus_encoder_create(sample_rate, 1, OPUS_APPLICATION_VOIP, &opus_err);
+    // capture runs at device rate, encoder at the nearest opus rate
+    encoder_rate_ = static_cast<std::int32_t>(get_opus_sample_rate(sample_rate));
+    frame_size_ = encoder_rate_ / kOpusFramesPerSecond;
+    if (encoder_rate_ != sample_rate)
+        capture_resampler.emplace(sample_rate, encoder_rate_, frames_per_buffer_, &memory);
 
-    if (opus_err != OPUS_OK || !encoder)
-        throw voice_exception::create_formatted("Couldn't create opus encoder (errc = {})", opus_err);
+    // encoder state is placed in memory of the input resource
+    encoder = static_cast<OpusEncoder*>(memory.allocate(opus_encoder_get_size(1), alignof(std::max_align_t)));
 
-    if ((opus_err = opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate))) != OPUS_OK)
-        throw voice_exception::create_formatted("Couldn't set encoder bitrate (errc = {})", opus_err);
+    if (const int opus_err = init_encoder(encoder_latency); opus_err != OPUS_OK) {
+        memory.deallocate(encoder, opus_encoder_get_size(1), alignof(std::max_align_t));
+        alcCaptureCloseDevice(input_device);
+        throw voice_exception::create_formatted("Couldn't create opus encoder (errc = {})", opus_err);
+    }
 
     input_alive = true;
-    input_thread = std::thread(&sound_input_impl::process_input, this);
+    input_thread = start_thread(capture_thread_options_, [this]() { process_input(); });
 }
 
 kvoice::sound_input_impl::~sound_input_impl() {
+    {
+        std::lock_guard lck(request_mutex);
+        request_alive = false;
+    }
+    request_cv.notify_one();
+    if (request_thread.joinable())
+        request_thread.join();
+
     input_alive = false;
     input_thread.join();
 
+    if (auto* device = next_device.exchange(nullptr)) {
+        alcCaptureCloseDevice(device->device);
+        delete device;
+    }
+
     alcCaptureCloseDevice(input_device);
-    opus_encoder_destroy(encoder);
+    memory.deallocate(encoder, opus_encoder_get_size(1), alignof(std::max_align_t));
 }
 
 bool kvoice::sound_input_impl::enable_input() {
@@ -70,38 +104,218 @@ void kvoice::sound_input_impl::set_mic_gain(float gain) {
     input_gain.store(gain);
 }
 
+void kvoice::sound_input_impl::set_latency_profile(latency_profile profile) {
+    requested_latency.store(profile, std::memory_order_relaxed);
+}
+
 void kvoice::sound_input_impl::change_device(std::string_view device_name) {
-    std::lock_guard lck(device_mutex);
+    std::string name{ device_name };
 
-    alcCaptureCloseDevice(input_device);
+    ALCdevice* device = alcCaptureOpenDevice(name.c_str(), sample_rate_, al_capture_format_, frames_per_buffer_);
 
-    input_device = alcCaptureOpenDevice(device_name.data(), sample_rate_, AL_FORMAT_MONO_FLOAT32, frames_per_buffer_);
+    if (!device) throw voice_exception::create_formatted("Couldn't open capture device {}", device_name);
 
-    if (!input_device) throw voice_exception::create_formatted("Couldn't open capture device {}", device_name);
+    queue_device(new pending_device{ device, std::move(name), nullptr });
+}
+
+void kvoice::sound_input_impl::change_device_async(std::string_view                    device_name,
+                                                   std::function<on_device_changed_t> cb) {
+    {
+        std::lock_guard lck(request_mutex);
+        // only the latest request matters, previous one is replaced if it wasn't processed yet
+        next_request = device_request{ std::string{ device_name }, std::move(cb) };
+
+        if (!request_alive) {
+            request_alive = true;
+            request_thread = start_thread(device_thread_options_, [this]() { process_device_requests(); });
+        }
+    }
+    request_cv.notify_one();
+}
+
+void kvoice::sound_input_impl::process_device_requests() {
+    std::unique_lock lck(request_mutex);
+
+    while (true) {
+        request_cv.wait(lck, [this]() { return !request_alive || next_request.has_value(); });
+        if (!request_alive) return;
+
+        device_request request = std::move(*next_request);
+        next_request.reset();
+
+        lck.unlock();
+
+        ALCdevice* device = alcCaptureOpenDevice(request.name.c_str(), sample_rate_, al_capture_format_,
+                                                 frames_per_buffer_);
+        if (device) {
+            queue_device(new pending_device{ device, std::move(request.name), std::move(request.cb) });
+        } else if (request.cb) {
+            request.cb(false, request.name);
+        }
+
+        lck.lock();
+    }
+}
+
+void kvoice::sound_input_impl::queue_device(pending_device* device) {
+    // device that wasn't swapped in yet is replaced by the newer one
+    if (auto* replaced = next_device.exchange(device)) {
+        alcCaptureCloseDevice(replaced->device);
+        if (replaced->cb)
+            replaced->cb(false, replaced->name);
+        delete replaced;
+    }
+}
+
+void kvoice::sound_input_impl::swap_device(pending_device* device) {
+    ALCdevice* old_device;
+    {
+        std::lock_guard lck(device_mutex);
+        old_device = input_device;
+
+        if (old_device && input_active)
+            alcCaptureStop(old_device);
+
+        input_device = device->device;
+
+        if (input_active)
+            alcCaptureStart(input_device);
+    }
+
+    if (old_device)
+        alcCaptureCloseDevice(old_device);
+
+    if (device->cb)
+        device->cb(true, device->name);
+    delete device;
+}
+
+void kvoice::sound_input_impl::add_processor(std::shared_ptr<audio_processor> processor) {
+    insert_processor(static_cast<std::size_t>(-1), std::move(processor));
+}
+
+void kvoice::sound_input_impl::insert_processor(std::size_t index, std::shared_ptr<audio_processor> processor) {
+    if (!processor) return;
+
+    // processor is prepared before capture thread can see it
+    processor->prepare(static_cast<std::uint32_t>(encoder_rate_), static_cast<std::size_t>(frame_size_));
+
+    std::lock_guard lck(processors_mutex);
+    auto chain = processors.peek() ? std::make_unique<processor_chain>(*processors.peek())
+                                   : std::make_unique<processor_chain>();
+
+    chain->insert(chain->begin() + static_cast<std::ptrdiff_t>(std::min(index, chain->size())), std::move(processor));
+    processors.replace(std::move(chain));
+}
+
+bool kvoice::sound_input_impl::remove_processor(const std::shared_ptr<audio_processor>& processor) {
+    std::lock_guard lck(processors_mutex);
+    if (!processors.peek()) return false;
+
+    auto chain = std::make_unique<processor_chain>(*processors.peek());
+    const auto it = std::find(chain->begin(), chain->end(), processor);
+    if (it == chain->end()) return false;
+
+    chain->erase(it);
+    processors.replace(std::move(chain));
+    return true;
 }
 
 void kvoice::sound_input_impl::set_input_callback(std::function<on_voice_input_t> cb) {
-    on_voice_input = std::move(cb);
+    std::lock_guard lck(callbacks_mutex);
+    on_voice_input.replace(cb ? std::make_unique<std::function<on_voice_input_t>>(std::move(cb)) : nullptr);
+}
+
+void kvoice::sound_input_impl::set_input_callback(std::function<on_voice_input_timed_t> cb) {
+    std::lock_guard lck(callbacks_mutex);
+    on_voice_input_timed.replace(cb ? std::make_unique<std::function<on_voice_input_timed_t>>(std::move(cb))
+                                    : nullptr);
 }
 
 void kvoice::sound_input_impl::set_raw_input_callback(std::function<on_voice_raw_input> cb) {
-    on_raw_voice_input = std::move(cb);
+    std::lock_guard lck(callbacks_mutex);
+    on_raw_voice_input.replace(cb ? std::make_unique<std::function<on_voice_raw_input>>(std::move(cb)) : nullptr);
+}
+
+std::unique_ptr<kvoice::packet_subscription> kvoice::sound_input_impl::subscribe_packets() {
+    return std::unique_ptr<packet_subscription>{ new (&memory) packet_subscription_impl(&packets) };
+}
+
+void kvoice::sound_input_impl::set_record_track(std::shared_ptr<record_track> track) {
+    std::lock_guard lck(record_mutex);
+    recording.replace(track ? std::make_unique<std::shared_ptr<record_track>>(std::move(track)) : nullptr);
+}
+
+kvoice::memory_stats kvoice::sound_input_impl::get_memory_stats() const {
+    return memory.get_stats();
+}
+
+void kvoice::sound_input_impl::encode_frame(float* frame, timestamp_t capture_time) {
+    if (auto profile = requested_latency.load(std::memory_order_relaxed); profile != encoder_latency) {
+        // application can't be changed after the first frame, only then encoder is initialized again
+        const bool reinit = get_capture_latency(profile).application !=
+                            get_capture_latency(encoder_latency).application;
+        if ((reinit ? init_encoder(profile) : configure_encoder(profile)) == OPUS_OK) {
+            encoder_latency = profile;
+        } else {
+            // failed profile isn't retried until it is requested again, capture goes on with the old one
+            if (reinit) init_encoder(encoder_latency);
+            else configure_encoder(encoder_latency);
+            requested_latency.compare_exchange_strong(profile, encoder_latency, std::memory_order_relaxed);
+        }
+    }
+
+    if (const auto chain = processors.read()) {
+        for (const auto& processor : *chain)
+            processor->process(frame, static_cast<std::size_t>(frame_size_));
+    }
+
+    // packet is published by the broadcast ring, buffer of the ring stays valid for the other consumers
+    auto*     packet = packets.begin_write();
+    const int len = opus_encode_float(encoder, frame, frame_size_, packet,
+                                      static_cast<opus_int32>(kMaxCapturedPacketSize));
+    // frame that couldn't be encoded is skipped, receivers conceal it like a lost packet
+    if (len < 0) return;
+    packets.commit(static_cast<std::size_t>(len), capture_time);
+
+    if (const auto track = recording.read(); track && *track)
+        (*track)->push(packet, static_cast<std::size_t>(len));
+
+    if (const auto cb = on_voice_input.read(); cb && *cb)
+        (*cb)(packet, len);
+    if (const auto cb = on_voice_input_timed.read(); cb && *cb)
+        (*cb)(packet, len, capture_time);
 }
 
 void kvoice::sound_input_impl::process_input() {
     using namespace std::chrono_literals;
 
-    std::array<std::uint8_t, kPacketMaxSize> packet{};
-    std::vector<float>                       capture_buffer(frames_per_buffer_);
-    std::vector<float>                       temporary_buffer;
-    temporary_buffer.reserve(kOpusFrameSize);
+    std::pmr::vector<float>        capture_buffer(frames_per_buffer_, &memory);
+    std::pmr::vector<std::int16_t> pcm_capture_buffer(&memory);
+    std::pmr::vector<float>        resampled_buffer(&memory);
+    std::pmr::vector<float>        frame_buffer(&memory);
+    const auto                     frame_size = static_cast<std::size_t>(frame_size_);
+    frame_buffer.reserve(frame_size);
+
+    if (capture_resampler)
+        resampled_buffer.resize(capture_resampler->get_max_output(frames_per_buffer_));
+
+    const bool pcm16 = capture_format_ == sample_format::int16;
+    if (pcm16)
+        pcm_capture_buffer.resize(frames_per_buffer_);
 
     std::int32_t captured_frames;
     bool         buffer_captured;
+    timestamp_t  capture_time{ 0 };
+    timestamp_t  frame_capture_time{ 0 };
 
     while (input_alive) {
         buffer_captured = false;
 
+        // swap device between iterations, so partially filled frame goes to the encoder with new data
+        if (auto* device = next_device.exchange(nullptr))
+            swap_device(device);
+
         {
             std::lock_guard lck(device_mutex);
             if (!input_device) {
@@ -110,68 +324,85 @@ void kvoice::sound_input_impl::process_input() {
             }
             alcGetIntegerv(input_device, ALC_CAPTURE_SAMPLES, 1, &captured_frames);
             if (captured_frames >= frames_per_buffer_) {
+                // the oldest sample in the device buffer was captured captured_frames samples ago
+                capture_time = get_clock_time() - samples_to_timestamp(captured_frames, sample_rate_);
                 capture_buffer.resize(frames_per_buffer_);
-                alcCaptureSamples(input_device, capture_buffer.data(), frames_per_buffer_);
+                if (pcm16)
+                    alcCaptureSamples(input_device, pcm_capture_buffer.data(), frames_per_buffer_);
+                else
+                    alcCaptureSamples(input_device, capture_buffer.data(), frames_per_buffer_);
                 buffer_captured = true;
             }
         }
 
         if (buffer_captured) {
-            float mic_level = *std::max_element(capture_buffer.begin(), capture_buffer.end());
+            // processing and encoding work with float samples
+            if (pcm16)
+                simd::convert(capture_buffer.data(), pcm_capture_buffer.data(), capture_buffer.size());
 
-            if (on_raw_voice_input)
-                on_raw_voice_input(capture_buffer.data(), capture_buffer.size(), mic_level);
+            float mic_level = *std::max_element(capture_buffer.begin(), capture_buffer.end());
 
-            std::transform(capture_buffer.begin(), capture_buffer.end(), capture_buffer.begin(),
-                           [gain = input_gain.load()](const float v) { return v * gain; });
+            if (const auto cb = on_raw_voice_input.read(); cb && *cb) {
+                (*cb)(pcm16 ? static_cast<const void*>(pcm_capture_buffer.data()) : capture_buffer.data(),
+                      capture_buffer.size(), mic_level);
+            }
 
-            std::ptrdiff_t needed_data = kOpusFrameSize - static_cast<std::ptrdiff_t>(temporary_buffer.size());
+            simd::scale(capture_buffer.data(), capture_buffer.size(), input_gain.load());
 
-            // move all data to temp buffer by default
-            auto end_it = capture_buffer.end();
+            float*      data = capture_buffer.data();
+            std::size_t count = capture_buffer.size();
 
-            if (needed_data < static_cast<std::ptrdiff_t>(capture_buffer.size())) {
-                // move only needed amount of data if needed data size < captured data size
-                end_it = std::next(capture_buffer.begin(), needed_data);
+            // encoder works at opus sampling rate, that may differ from capture device rate
+            if (capture_resampler) {
+                count = capture_resampler->process(data, count, resampled_buffer.data(), resampled_buffer.size());
+                data = resampled_buffer.data();
             }
 
-            // move
-            temporary_buffer.insert(temporary_buffer.cend(), std::make_move_iterator(capture_buffer.begin()),
-                                    std::make_move_iterator(end_it));
-            capture_buffer.erase(capture_buffer.begin(), end_it);
-
-            // if there enough data then pass it to the encoder
-            if (temporary_buffer.size() == kOpusFrameSize) {
-                // encode data and pass it to callback, then clear temporary data buffer
-                int len = opus_encode_float(encoder, temporary_buffer.data(), kOpusFrameSize, packet.data(),
-                                            kPacketMaxSize);
-                if (len < 0 || len > kPacketMaxSize) return;
-                if (on_voice_input)
-                    on_voice_input(packet.data(), len);
-                temporary_buffer.clear();
+            std::size_t offset = 0;
+            while (offset < count) {
+                if (frame_buffer.empty()) {
+                    frame_capture_time = capture_time + samples_to_timestamp(
+                                             static_cast<std::int64_t>(offset), encoder_rate_);
+
+                    // encode whole frames directly from captured data
+                    if (count - offset >= frame_size) {
+                        encode_frame(data + offset, frame_capture_time);
+                        offset += frame_size;
+                        continue;
+                    }
+                }
+
+                // collect partial frame, it is completed by the next captured buffer
+                const auto chunk = std::min<std::size_t>(frame_size - frame_buffer.size(), count - offset);
+                frame_buffer.insert(frame_buffer.end(), data + offset, data + offset + chunk);
+                offset += chunk;
+
+                if (frame_buffer.size() == frame_size) {
+                    encode_frame(frame_buffer.data(), frame_capture_time);
+                    frame_buffer.clear();
+                }
             }
-            auto           remaining_data = capture_buffer.size();
-            std::ptrdiff_t idx = 0;
-            // process the remaining data if any and if its size more or equals to opus frame size
-            while (remaining_data >= kOpusFrameSize) {
-                int len = opus_encode_float(encoder, &capture_buffer[idx], kOpusFrameSize, packet.data(),
-                                            kPacketMaxSize);
-                if (len < 0 || len > kPacketMaxSize) return;
-                if (on_voice_input)
-                    on_voice_input(packet.data(), len);
-                idx += kOpusFrameSize;
-                remaining_data -= kOpusFrameSize;
-            }
-            // add remaining data to the temporary buffer if any
-            if (remaining_data > 0) {
-                temporary_buffer.insert(temporary_buffer.cend(),
-                                        std::make_move_iterator(std::next(capture_buffer.begin(), idx)),
-                                        std::make_move_iterator(capture_buffer.end()));
-                capture_buffer.clear();
-            }
-
         }
 
         std::this_thread::sleep_for(sleep_time);
     }
 }
+
+int kvoice::sound_input_impl::init_encoder(latency_profile profile) {
+    const auto params = get_capture_latency(profile);
+
+    if (const int opus_err = opus_encoder_init(encoder, encoder_rate_, 1, params.application); opus_err != OPUS_OK)
+        return opus_err;
+    if (const int opus_err = opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_)); opus_err != OPUS_OK)
+        return opus_err;
+    return configure_encoder(profile);
+}
+
+int kvoice::sound_input_impl::configure_encoder(latency_profile profile) {
+    const auto params = get_capture_latency(profile);
+
+    int opus_err;
+    if ((opus_err = opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(params.inband_fec))) != OPUS_OK)
+        return opus_err;
+    return opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(params.packet_loss_perc));
+}
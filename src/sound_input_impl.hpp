@@ -3,44 +3,138 @@
 #include <cstdint>
 #include <mutex>
 #include <atomic>
+#include <thread>
+#include <array>
+#include <condition_variable>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "sound_input.hpp"
+#include "device_options.hpp"
+#include "memory.hpp"
+#include "resampler.hpp"
+#include "rcu_cell.hpp"
+#include "packet_ring.hpp"
 
 struct OpusEncoder;
 struct ALCdevice;
 
 namespace kvoice {
-constexpr auto kOpusFrameSize = 480;
-constexpr auto kPacketMaxSize = 32768;
+class record_track;
 
-class sound_input_impl final : public sound_input {
+// encoded frame is 10 ms at every opus rate
+constexpr auto kOpusFramesPerSecond = 100;
+
+class sound_input_impl final : public sound_input, public resource_allocated {
+    using processor_chain = std::vector<std::shared_ptr<audio_processor>>;
+
+    /**
+     * @brief device requested by user, that should be opened in background
+     */
+    struct device_request {
+        std::string                        name;
+        std::function<on_device_changed_t> cb;
+    };
+
+    /**
+     * @brief opened device, that waits for capture thread to swap it in
+     */
+    struct pending_device {
+        ALCdevice*                         device{ nullptr };
+        std::string                        name;
+        std::function<on_device_changed_t> cb;
+    };
 public:
     sound_input_impl(std::string_view device_name, std::int32_t sample_rate, std::int32_t frames_per_buffer,
-                     std::uint32_t    bitrate);
+                     std::uint32_t    bitrate, const sound_input_options& options);
     ~sound_input_impl() override;
     bool enable_input() override;
     bool disable_input() override;
     void set_mic_gain(float gain) override;
+    void set_latency_profile(latency_profile profile) override;
     void change_device(std::string_view device_name) override;
+    void change_device_async(std::string_view device_name, std::function<on_device_changed_t> cb) override;
+    void add_processor(std::shared_ptr<audio_processor> processor) override;
+    void insert_processor(std::size_t index, std::shared_ptr<audio_processor> processor) override;
+    bool remove_processor(const std::shared_ptr<audio_processor>& processor) override;
     void set_input_callback(std::function<on_voice_input_t> cb) override;
+    void set_input_callback(std::function<on_voice_input_timed_t> cb) override;
     void set_raw_input_callback(std::function<on_voice_raw_input> cb) override;
+
+    std::unique_ptr<packet_subscription> subscribe_packets() override;
+
+    [[nodiscard]] memory_stats get_memory_stats() const override;
+
+    /**
+     * @brief sets recorder track, that receives encoded packets(nullptr to stop recording)
+     * @param track recorder track
+     */
+    void set_record_track(std::shared_ptr<record_track> track);
+
+    [[nodiscard]] std::uint32_t get_sample_rate() const noexcept { return static_cast<std::uint32_t>(sample_rate_); }
 private:
     void process_input();
+    void process_device_requests();
+    void queue_device(pending_device* device);
+    void swap_device(pending_device* device);
+    void encode_frame(float* frame, timestamp_t capture_time);
+    // returns opus error code
+    int  init_encoder(latency_profile profile);
+    // applies settings of profile, that don't need new encoder state, returns opus error code
+    int  configure_encoder(latency_profile profile);
+
+    // declared first, so it outlives everything allocated from it
+    counting_resource memory;
 
     std::atomic<float>        input_gain{ 1.f };
+    std::uint32_t             bitrate_{ 0 };
     std::int32_t              sample_rate_{ 48000 };
+    std::int32_t              encoder_rate_{ 48000 };
+    std::int32_t              frame_size_{ 480 };
     std::int32_t              frames_per_buffer_{ 420 };
+    sample_format             capture_format_{ sample_format::float32 };
+    std::int32_t              al_capture_format_{ 0 };
+    thread_options            capture_thread_options_{};
+    thread_options            device_thread_options_{};
     std::chrono::milliseconds sleep_time{ 1000 };
 
-    OpusEncoder* encoder{ nullptr };
+    OpusEncoder*             encoder{ nullptr };
+    std::optional<resampler> capture_resampler{};
+
+    // profile is requested by control threads and applied to encoder by capture thread
+    std::atomic<latency_profile> requested_latency{ latency_profile::balanced };
+    latency_profile              encoder_latency{ latency_profile::balanced };
 
     ALCdevice* input_device{ nullptr };
 
     std::mutex  device_mutex;
     std::thread input_thread;
 
-    std::function<on_voice_input_t>   on_voice_input{};
-    std::function<on_voice_raw_input> on_raw_voice_input{};
+    std::atomic<pending_device*> next_device{ nullptr };
+
+    std::mutex                    request_mutex;
+    std::condition_variable       request_cv;
+    std::optional<device_request> next_request{};
+    std::thread                   request_thread;
+    bool                          request_alive{ false };
+
+    // callbacks are replaced by control threads and read by capture thread without locks
+    std::mutex                                      callbacks_mutex;
+    rcu_cell<std::function<on_voice_input_t>>       on_voice_input;
+    rcu_cell<std::function<on_voice_input_timed_t>> on_voice_input_timed;
+    rcu_cell<std::function<on_voice_raw_input>>     on_raw_voice_input;
+
+    // processors are replaced by control threads and read by capture thread without locks
+    std::mutex                processors_mutex;
+    rcu_cell<processor_chain> processors;
+
+    // recorder track is replaced by recorder and read by capture thread without locks
+    std::mutex                              record_mutex;
+    rcu_cell<std::shared_ptr<record_track>> recording;
+
+    // encoded packets are written by capture thread and read by subscribers
+    packet_ring packets{ &memory };
 
     bool input_active{ false };
     bool input_alive{ false };
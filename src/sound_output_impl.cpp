@@ -3,53 +3,66 @@
 #include <AL/alext.h>
 #include "sound_output_impl.hpp"
 
+#include <algorithm>
+#include <cmath>
+
+#include "resampler.hpp"
+#include "sound_clip_impl.hpp"
 #include "stream_impl.hpp"
+#include "voice_source_impl.hpp"
 #include "voice_exception.hpp"
 
-kvoice::sound_output_impl::sound_output_impl(std::string_view device_name, std::uint32_t sample_rate, std::uint32_t src_count) : sampling_rate(sample_rate) {
-    using namespace std::string_literals;
-
-    device = alcOpenDevice(device_name.data());  // NOLINT(cppcoreguidelines-prefer-member-initializer)
-
-    if (!device) throw voice_exception::create_formatted("Couldn't open device {}", device_name);
-
-    ctx = alcCreateContext(device, nullptr);
-
-    if (!ctx || !alcMakeContextCurrent(ctx)) {
-        if (ctx) {
-            alcDestroyContext(ctx);
-        }
-        alcCloseDevice(device);
-        throw voice_exception("Couldn't set context");
-    }
-    ALCint max_mono_sources;
-
-    alcGetIntegerv(device, ALC_MONO_SOURCES, 1, &max_mono_sources);
-
-    if (static_cast<ALCint>(src_count) > max_mono_sources) src_count = max_mono_sources;
+namespace {
+std::uint64_t get_cell_key(std::int64_t x, std::int64_t y, std::int64_t z) {
+    constexpr std::uint64_t kMask = (1ull << 21) - 1;
+    return (static_cast<std::uint64_t>(x) & kMask) | (static_cast<std::uint64_t>(y) & kMask) << 21 |
+           (static_cast<std::uint64_t>(z) & kMask) << 42;
+}
 
-    sources = new std::uint32_t[src_count];
+bool is_same_stream_config(const kvoice::stream_options& lhs, const kvoice::stream_options& rhs) {
+    return lhs.decode_sample_rate == rhs.decode_sample_rate && lhs.mode == rhs.mode && lhs.format == rhs.format;
+}
 
-    alGenSources(static_cast<ALCint>(src_count), sources);
+std::uint64_t get_cell_key(const kvoice::vector& pos, float cell_size) {
+    return get_cell_key(static_cast<std::int64_t>(std::floor(pos.x / cell_size)),
+                        static_cast<std::int64_t>(std::floor(pos.y / cell_size)),
+                        static_cast<std::int64_t>(std::floor(pos.z / cell_size)));
+}
+}
 
-    if (alGetError()) {
-        throw voice_exception::create_formatted("Couldn't create {} sources", src_count);
+kvoice::sound_output_impl::sound_output_impl(std::string_view device_name, std::uint32_t sample_rate, std::uint32_t src_count,
+                                             std::pmr::memory_resource* memory, bool loopback)
+    : memory(memory),
+      sampling_rate(sample_rate),
+      loopback(loopback) {
+    if (loopback) {
+        if (!alcIsExtensionPresent(nullptr, "ALC_SOFT_loopback"))
+            throw voice_exception("Loopback output isn't supported");
+        if (!sample_rate)
+            throw voice_exception("Loopback output requires sampling rate");
+
+        const auto open_loopback = reinterpret_cast<LPALCLOOPBACKOPENDEVICESOFT>(
+            alcGetProcAddress(nullptr, "alcLoopbackOpenDeviceSOFT"));
+
+        device = open_loopback(nullptr);
+        if (!device) throw voice_exception("Couldn't open loopback device");
+    } else {
+        device = alcOpenDevice(device_name.data());
+
+        if (!device) throw voice_exception::create_formatted("Couldn't open device {}", device_name);
     }
-    this->src_count = src_count;
 
-    for (auto i = 0u; i < src_count; ++i) {
-        free_sources.push(sources[i]);
-    }
+    requested_src_count = src_count;
+    create_context();
 }
 
 kvoice::sound_output_impl::~sound_output_impl() {
+    // pooled streams own OpenAL buffers, so they are destroyed while the context is alive
+    stream_pool.clear();
+    destroy_context();
 
-    alDeleteSources(static_cast<ALCint>(src_count), sources);
-    delete[] sources;
-
-    alcMakeContextCurrent(nullptr);
-    alcDestroyContext(ctx);
-    alcCloseDevice(device);
+    if (device)
+        alcCloseDevice(device);
 }
 
 void kvoice::sound_output_impl::set_my_position(vector pos) noexcept {
@@ -69,6 +82,8 @@ void kvoice::sound_output_impl::set_my_orientation_front(vector front) noexcept
 }
 
 void kvoice::sound_output_impl::update_me() {
+    invalidate_culling();
+
     float orientation[]{
             listener_front.x, listener_front.y, -listener_front.z,
             listener_up.x, listener_up.y, -listener_up.z
@@ -84,67 +99,470 @@ void kvoice::sound_output_impl::set_gain(float gain) noexcept {
 }
 
 void kvoice::sound_output_impl::change_device(std::string_view device_name) {
+    if (loopback) throw voice_exception("Loopback output can't change device");
+
+    // the context keeps all sources, buffers and queued audio while the device is moved to new output
+    if (extensions.alcReopenDeviceSOFT) {
+        const auto attributes = get_context_attributes();
+        if (!extensions.alcReopenDeviceSOFT(device, device_name.data(), attributes.data()))
+            throw voice_exception::create_formatted("Couldn't open device {}", device_name);
+        update_mixing_rate();
+        return;
+    }
+
+    // keep the current device if the new one couldn't be opened
+    ALCdevice* new_device = alcOpenDevice(device_name.data());
+
+    if (!new_device) throw voice_exception::create_formatted("Couldn't open device {}", device_name);
+
+    // streams keep ring buffers and spatial state, only OpenAL objects are recreated
     drop_source_signal.emit();
+    // clip buffers can't be deleted while sources play them
+    stop_clips();
+    release_context_signal.emit();
+
+    destroy_context();
+    ALCdevice* old_device = device;
+    device = new_device;
+
+    try {
+        create_context();
+    } catch (voice_exception&) {
+        // new device is closed by create_context, streams get their buffers back on the old one
+        device = old_device;
+        create_context();
+        update_me();
+        restore_context_signal.emit();
+        throw;
+    }
 
-    while (!free_sources.empty()) {
-        free_sources.pop();
+    if (old_device)
+        alcCloseDevice(old_device);
+    update_me();
+
+    restore_context_signal.emit();
+}
+
+std::uint32_t kvoice::sound_output_impl::get_source() {
+    if (free_sources.empty())
+        reclaim_clip_sources();
+    if (free_sources.empty()) throw voice_exception("There isn't free sources");
+
+    auto result = free_sources.front();
+    free_sources.pop();
+    return result;
+}
+
+void kvoice::sound_output_impl::free_source(std::uint32_t source) noexcept {
+    free_sources.push(source);
+}
+
+void kvoice::sound_output_impl::set_stream_transforms(stream* const* streams, const vector* positions,
+                                                      const vector* velocities, const vector* directions,
+                                                      std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        auto* impl = static_cast<stream_impl*>(streams[i]);
+
+        const bool was_dirty = impl->has_staged_transform();
+        impl->stage_transform(positions ? &positions[i] : nullptr, velocities ? &velocities[i] : nullptr,
+                              directions ? &directions[i] : nullptr);
+
+        if (!was_dirty && impl->has_staged_transform())
+            dirty_streams.push_back(impl);
     }
+}
 
-    alDeleteSources(static_cast<std::int32_t>(src_count), sources);
-    delete[] sources;
+void kvoice::sound_output_impl::commit_transforms() {
+    if (dirty_streams.empty()) return;
 
-    alcMakeContextCurrent(nullptr);
-    alcDestroyContext(ctx);
-    alcCloseDevice(device);
+    // mixer applies all source changes at once
+    if (extensions.alDeferUpdatesSOFT)
+        extensions.alDeferUpdatesSOFT();
+
+    for (auto* stream : dirty_streams)
+        stream->commit_transform();
+    dirty_streams.clear();
+
+    if (extensions.alProcessUpdatesSOFT)
+        extensions.alProcessUpdatesSOFT();
+}
+
+void kvoice::sound_output_impl::set_culling(bool enabled, float min_gain) {
+    culling_enabled = enabled;
+    culling_min_gain = min_gain;
+    invalidate_culling();
+}
+
+void kvoice::sound_output_impl::register_stream(stream_impl* stream) {
+    const auto cell = get_cell_key(stream->get_position(), kCullingCellSize);
+    stream_cells.emplace(stream, cell);
+    stream_grid[cell].push_back(stream);
+    invalidate_culling(true);
+}
+
+void kvoice::sound_output_impl::unregister_stream(stream_impl* stream) noexcept {
+    dirty_streams.erase(std::remove(dirty_streams.begin(), dirty_streams.end(), stream), dirty_streams.end());
+
+    if (const auto it = stream_cells.find(stream); it != stream_cells.end()) {
+        remove_from_cell(stream, it->second);
+        stream_cells.erase(it);
+    }
+    audible_streams.erase(stream);
+    invalidate_culling(true);
+}
+
+void kvoice::sound_output_impl::update_stream_cell(stream_impl* stream) {
+    invalidate_culling();
 
-    device = alcOpenDevice(device_name.data());  // NOLINT(cppcoreguidelines-prefer-member-initializer)
+    const auto it = stream_cells.find(stream);
+    if (it == stream_cells.end()) return;
 
-    if (!device) throw voice_exception::create_formatted("Couldn't open device {}", device_name);
+    const auto cell = get_cell_key(stream->get_position(), kCullingCellSize);
+    if (cell == it->second) return;
 
-    ctx = alcCreateContext(device, nullptr);
+    remove_from_cell(stream, it->second);
+    stream_grid[cell].push_back(stream);
+    it->second = cell;
+}
+
+void kvoice::sound_output_impl::remove_from_cell(const stream_impl* stream, std::uint64_t cell) noexcept {
+    const auto it = stream_grid.find(cell);
+    if (it == stream_grid.end()) return;
+
+    auto& streams = it->second;
+    if (const auto pos = std::find(streams.begin(), streams.end(), stream); pos != streams.end()) {
+        *pos = streams.back();
+        streams.pop_back();
+    }
+    if (streams.empty())
+        stream_grid.erase(it);
+}
+
+void kvoice::sound_output_impl::invalidate_culling(bool distance_changed) noexcept {
+    if (distance_changed)
+        audible_distance_dirty.store(true, std::memory_order_relaxed);
+    culling_dirty.store(true, std::memory_order_release);
+}
+
+bool kvoice::sound_output_impl::is_culled(const stream_impl* stream) {
+    if (!culling_enabled || !stream->is_spatial_stream()) return false;
+
+    if (culling_dirty.exchange(false, std::memory_order_acquire))
+        update_culling();
+
+    return audible_streams.find(stream) == audible_streams.end();
+}
 
-    if (!ctx || !alcMakeContextCurrent(ctx)) {
+void kvoice::sound_output_impl::update_culling() {
+    audible_streams.clear();
+
+    // application may change distance model of the context at any time
+    if (const ALint model = alGetInteger(AL_DISTANCE_MODEL); model != distance_model) {
+        distance_model = model;
+        audible_distance_dirty.store(true, std::memory_order_relaxed);
+    }
+
+    if (audible_distance_dirty.exchange(false, std::memory_order_relaxed)) {
+        max_audible_distance = 0.f;
+        for (const auto& [stream, cell] : stream_cells)
+            max_audible_distance = std::max(max_audible_distance, stream->get_silent_distance(distance_model));
+    }
+
+    const auto visit = [this](const std::pmr::vector<stream_impl*>& streams) {
+        for (const auto* stream : streams) {
+            if (stream->is_audible_from(listener_pos, culling_min_gain, distance_model))
+                audible_streams.insert(stream);
+        }
+    };
+
+    // only cells that may contain audible streams are visited, unless there are fewer occupied cells,
+    // streams are never silent in inverse and exponent models, so all cells are visited
+    const auto reach = static_cast<double>(std::ceil(max_audible_distance / kCullingCellSize));
+    if (std::pow(2.0 * reach + 1.0, 3.0) >= static_cast<double>(stream_grid.size())) {
+        for (const auto& [cell, streams] : stream_grid)
+            visit(streams);
+        return;
+    }
+
+    const auto cell_reach = static_cast<std::int64_t>(reach);
+    const auto center_x = static_cast<std::int64_t>(std::floor(listener_pos.x / kCullingCellSize));
+    const auto center_y = static_cast<std::int64_t>(std::floor(listener_pos.y / kCullingCellSize));
+    const auto center_z = static_cast<std::int64_t>(std::floor(listener_pos.z / kCullingCellSize));
+
+    for (auto x = center_x - cell_reach; x <= center_x + cell_reach; ++x) {
+        for (auto y = center_y - cell_reach; y <= center_y + cell_reach; ++y) {
+            for (auto z = center_z - cell_reach; z <= center_z + cell_reach; ++z) {
+                if (const auto it = stream_grid.find(get_cell_key(x, y, z)); it != stream_grid.end())
+                    visit(it->second);
+            }
+        }
+    }
+}
+
+void kvoice::sound_output_impl::set_buffering_time(std::uint32_t time_ms) {
+    buffering_time.store(time_ms, std::memory_order_relaxed);
+}
+
+void kvoice::sound_output_impl::set_latency_profile(latency_profile profile) {
+    latency.store(profile, std::memory_order_relaxed);
+}
+
+bool kvoice::sound_output_impl::render(float* samples, std::uint32_t frames) {
+    if (!loopback) return false;
+
+    extensions.alcRenderSamplesSOFT(device, samples, static_cast<ALCsizei>(frames));
+    return true;
+}
+
+std::array<ALCint, 7> kvoice::sound_output_impl::get_context_attributes() const {
+    // loopback device renders to user buffers, so their format is a part of context attributes
+    if (loopback) {
+        return { ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT, ALC_FORMAT_TYPE_SOFT, ALC_FLOAT_SOFT,
+                 ALC_FREQUENCY, static_cast<ALCint>(sampling_rate), 0 };
+    }
+    if (sampling_rate)
+        return { ALC_FREQUENCY, static_cast<ALCint>(sampling_rate), 0 };
+    return { 0 };
+}
+
+void kvoice::sound_output_impl::update_mixing_rate() {
+    ALCint frequency{ 0 };
+    alcGetIntegerv(device, ALC_FREQUENCY, 1, &frequency);
+
+    // device may ignore requested rate, streams produce audio at the rate that is really mixed
+    mixing_rate = frequency > 0 ? static_cast<std::uint32_t>(frequency) : sampling_rate;
+}
+
+void kvoice::sound_output_impl::create_context() {
+    const auto attributes = get_context_attributes();
+    ctx = alcCreateContext(device, attributes.data());
+
+    // failed device is closed, so the caller can fall back to another one
+    const auto fail = [this](const voice_exception& e) {
         if (ctx) {
+            alcMakeContextCurrent(nullptr);
             alcDestroyContext(ctx);
+            ctx = nullptr;
         }
         alcCloseDevice(device);
-        throw voice_exception("Couldn't set context");
-    }
-    ALCint max_mono_sources;
+        device = nullptr;
+        throw e;
+    };
+
+    if (!ctx || !alcMakeContextCurrent(ctx))
+        fail(voice_exception("Couldn't set context"));
 
+    ALCint max_mono_sources;
     alcGetIntegerv(device, ALC_MONO_SOURCES, 1, &max_mono_sources);
+    update_mixing_rate();
 
+    src_count = requested_src_count;
     if (static_cast<ALCint>(src_count) > max_mono_sources) src_count = max_mono_sources;
 
-    sources = new std::uint32_t[src_count];
+    sources.assign(src_count, 0);
 
-    alGenSources(static_cast<ALCint>(src_count), sources);
+    alGenSources(static_cast<ALCint>(src_count), sources.data());
 
     if (alGetError()) {
-        throw voice_exception::create_formatted("Couldn't create {} sources", src_count);
+        sources.clear();
+        fail(voice_exception::create_formatted("Couldn't create {} sources", src_count));
     }
 
     for (auto i = 0u; i < src_count; ++i) {
         free_sources.push(sources[i]);
     }
+
+    load_extensions();
 }
 
-std::uint32_t kvoice::sound_output_impl::get_source() {
-    if (free_sources.empty()) throw voice_exception("There isn't free sources");
+void kvoice::sound_output_impl::destroy_context() {
+    stop_clips();
 
-    auto result = free_sources.front();
-    free_sources.pop();
-    return result;
+    while (!free_sources.empty()) {
+        free_sources.pop();
+    }
+
+    if (!ctx) return;
+
+    alDeleteSources(static_cast<ALCint>(src_count), sources.data());
+    sources.clear();
+
+    alcMakeContextCurrent(nullptr);
+    alcDestroyContext(ctx);
+    ctx = nullptr;
 }
 
-void kvoice::sound_output_impl::free_source(std::uint32_t source) noexcept {
-    free_sources.push(source);
+void kvoice::sound_output_impl::load_extensions() {
+    extensions = al_extensions{};
+
+    if (loopback) {
+        extensions.alcRenderSamplesSOFT = reinterpret_cast<LPALCRENDERSAMPLESSOFT>(
+            alcGetProcAddress(device, "alcRenderSamplesSOFT"));
+    }
+
+    if (alcIsExtensionPresent(device, "ALC_SOFT_reopen_device")) {
+        extensions.alcReopenDeviceSOFT = reinterpret_cast<LPALCREOPENDEVICESOFT>(
+            alcGetProcAddress(device, "alcReopenDeviceSOFT"));
+    }
+
+    if (alIsExtensionPresent("AL_SOFT_source_latency")) {
+        extensions.alGetSourcei64vSOFT = reinterpret_cast<LPALGETSOURCEI64VSOFT>(
+            alGetProcAddress("alGetSourcei64vSOFT"));
+    }
+
+    if (alIsExtensionPresent("AL_SOFT_deferred_updates")) {
+        extensions.alDeferUpdatesSOFT = reinterpret_cast<LPALDEFERUPDATESSOFT>(
+            alGetProcAddress("alDeferUpdatesSOFT"));
+        extensions.alProcessUpdatesSOFT = reinterpret_cast<LPALPROCESSUPDATESSOFT>(
+            alGetProcAddress("alProcessUpdatesSOFT"));
+    }
+
+    if (alIsExtensionPresent("AL_SOFT_callback_buffer")) {
+        extensions.alBufferCallbackSOFT = reinterpret_cast<LPALBUFFERCALLBACKSOFT>(
+            alGetProcAddress("alBufferCallbackSOFT"));
+    }
 }
 
-void kvoice::sound_output_impl::set_buffering_time(std::uint32_t time_ms) {
-    buffering_time = time_ms;
+std::uint32_t kvoice::sound_output_impl::get_decode_rate(std::uint32_t decode_sample_rate) const {
+    if (!decode_sample_rate)
+        return is_opus_sample_rate(mixing_rate) ? mixing_rate : get_opus_sample_rate(mixing_rate);
+
+    if (!is_opus_sample_rate(decode_sample_rate))
+        throw voice_exception::create_formatted("Unsupported decode sampling rate {}", decode_sample_rate);
+    return decode_sample_rate;
 }
 
 std::unique_ptr<kvoice::stream> kvoice::sound_output_impl::create_stream() {
-    return std::make_unique<stream_impl>(this, sampling_rate);
+    return create_stream(stream_options{});
+}
+
+std::unique_ptr<kvoice::stream> kvoice::sound_output_impl::create_stream(const stream_options& options) {
+    if (!stream_pool.empty() && is_same_stream_config(options, pooled_stream_options)) {
+        std::unique_ptr<stream> result = std::move(stream_pool.back());
+        stream_pool.pop_back();
+        return result;
+    }
+
+    return make_stream(options);
+}
+
+void kvoice::sound_output_impl::fill_stream_pool(std::uint32_t count, const stream_options& options) {
+    // pool holds streams of one configuration
+    if (!is_same_stream_config(options, pooled_stream_options))
+        stream_pool.clear();
+
+    pooled_stream_options = options;
+    stream_pool.reserve(stream_pool.size() + count);
+    for (std::uint32_t i = 0; i < count; ++i)
+        stream_pool.push_back(make_stream(options));
+}
+
+std::unique_ptr<kvoice::stream_impl> kvoice::sound_output_impl::make_stream(const stream_options& options) {
+    const bool use_callback = options.mode == playback_mode::callback && extensions.alBufferCallbackSOFT;
+    return std::unique_ptr<stream_impl>{ new (&memory) stream_impl(
+        this, static_cast<std::int32_t>(get_decode_rate(options.decode_sample_rate)),
+        static_cast<std::int32_t>(mixing_rate), use_callback, options.format) };
+}
+
+std::unique_ptr<kvoice::voice_source> kvoice::sound_output_impl::create_voice_source() {
+    return create_voice_source(0);
+}
+
+std::unique_ptr<kvoice::voice_source> kvoice::sound_output_impl::create_voice_source(std::uint32_t decode_sample_rate) {
+    return std::unique_ptr<voice_source>{ new (&memory) voice_source_impl(
+        static_cast<std::int32_t>(get_decode_rate(decode_sample_rate)), static_cast<std::int32_t>(mixing_rate),
+        &memory) };
+}
+
+std::shared_ptr<kvoice::sound_clip> kvoice::sound_output_impl::load_clip(const void* samples, std::size_t count,
+                                                                         sample_format format,
+                                                                         std::uint32_t sample_rate) {
+    return std::allocate_shared<sound_clip_impl>(std::pmr::polymorphic_allocator<sound_clip_impl>{ &memory }, this,
+                                                 convert_clip(samples, count, format, sample_rate, mixing_rate,
+                                                              &memory),
+                                                 mixing_rate);
+}
+
+std::shared_ptr<kvoice::sound_clip> kvoice::sound_output_impl::load_opus_clip(const void* const* packets,
+                                                                              const std::size_t* sizes,
+                                                                              std::size_t count) {
+    return std::allocate_shared<sound_clip_impl>(std::pmr::polymorphic_allocator<sound_clip_impl>{ &memory }, this,
+                                                 decode_opus_clip(packets, sizes, count, get_decode_rate(0),
+                                                                  mixing_rate, &memory),
+                                                 mixing_rate);
+}
+
+bool kvoice::sound_output_impl::play_clip(const std::shared_ptr<sound_clip>& clip, const clip_play_options& options) {
+    auto impl = std::static_pointer_cast<sound_clip_impl>(clip);
+    if (!impl || !impl->get_buffer()) return false;
+
+    reclaim_clip_sources();
+    if (free_sources.empty()) return false;
+
+    const auto source = free_sources.front();
+    free_sources.pop();
+
+    alSourceRewind(source);
+    alSourcei(source, AL_LOOPING, AL_FALSE);
+    alSourcei(source, AL_BUFFER, static_cast<ALint>(impl->get_buffer()));
+    // streams apply output gain to samples, clip samples are shared, so it is applied by the source
+    alSourcef(source, AL_GAIN, options.gain * output_gain);
+    alSourcef(source, AL_PITCH, options.pitch);
+
+    const vector zeros{ 0.f, 0.f, 0.f };
+    alSourcefv(source, AL_DIRECTION, &zeros.x);
+
+    if (options.spatial) {
+        alSourcefv(source, AL_POSITION, &options.position.x);
+        alSourcefv(source, AL_VELOCITY, &options.velocity.x);
+        alSourcef(source, AL_MAX_DISTANCE, options.max_distance);
+        alSourcef(source, AL_REFERENCE_DISTANCE, options.min_distance);
+        alSourcef(source, AL_ROLLOFF_FACTOR, options.rolloff_factor);
+        alSourcei(source, AL_SOURCE_RELATIVE, AL_FALSE);
+    } else {
+        alSourcefv(source, AL_POSITION, &zeros.x);
+        alSourcefv(source, AL_VELOCITY, &zeros.x);
+        alSourcef(source, AL_ROLLOFF_FACTOR, 0.f);
+        alSourcei(source, AL_SOURCE_RELATIVE, AL_TRUE);
+    }
+    alSourcePlay(source);
+
+    if (alGetError() != AL_NO_ERROR) {
+        release_clip_source(source);
+        return false;
+    }
+
+    playing_clips.push_back({ source, std::move(impl) });
+    return true;
+}
+
+void kvoice::sound_output_impl::stop_clips() {
+    for (const auto& playing : playing_clips)
+        release_clip_source(playing.source);
+    playing_clips.clear();
+}
+
+void kvoice::sound_output_impl::reclaim_clip_sources() {
+    for (std::size_t i = 0; i < playing_clips.size();) {
+        ALint state{ AL_STOPPED };
+        alGetSourcei(playing_clips[i].source, AL_SOURCE_STATE, &state);
+        if (state == AL_PLAYING) {
+            ++i;
+            continue;
+        }
+
+        release_clip_source(playing_clips[i].source);
+        playing_clips[i] = std::move(playing_clips.back());
+        playing_clips.pop_back();
+    }
+}
+
+void kvoice::sound_output_impl::release_clip_source(std::uint32_t source) noexcept {
+    alSourceStop(source);
+    alSourcei(source, AL_BUFFER, AL_NONE);
+
+    // streams don't set gain and pitch of their sources
+    alSourcef(source, AL_GAIN, 1.f);
+    alSourcef(source, AL_PITCH, 1.f);
+    free_source(source);
 }
@@ -1,22 +1,50 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <memory_resource>
 #include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <AL/alext.h>
 
 #include "sound_output.hpp"
+#include "latency_params.hpp"
+#include "memory.hpp"
 #include "ktsignal/ktsignal.hpp"
 
-struct ALCdevice;
-struct ALCcontext;
-
 namespace kvoice {
-class sound_output_impl : public sound_output {
+/**
+ * @brief OpenAL extension entry points, loaded for the current context
+ */
+struct al_extensions {
+    LPALGETSOURCEI64VSOFT  alGetSourcei64vSOFT{ nullptr };
+    LPALCREOPENDEVICESOFT  alcReopenDeviceSOFT{ nullptr };
+    LPALDEFERUPDATESSOFT   alDeferUpdatesSOFT{ nullptr };
+    LPALPROCESSUPDATESSOFT alProcessUpdatesSOFT{ nullptr };
+    LPALBUFFERCALLBACKSOFT alBufferCallbackSOFT{ nullptr };
+    LPALCRENDERSAMPLESSOFT alcRenderSamplesSOFT{ nullptr };
+};
+
+class stream_impl;
+class sound_clip_impl;
+
+class sound_output_impl : public sound_output, public resource_allocated {
+    // edge of spatial index cell in world units
+    static constexpr float kCullingCellSize = 32.f;
+
 public:
     /**
      * @brief Constructor
      * @param device_name Output device name in UTF-8(empty for default)
      * @param sample_rate Output device sampling rate
      * @param src_count Number of max sources
+     * @param memory Resource of all allocations made by the output and its streams
+     * @param loopback Open loopback device, that is mixed by @p render
      */
-    sound_output_impl(std::string_view device_name, std::uint32_t sample_rate, std::uint32_t src_count);
+    sound_output_impl(std::string_view device_name, std::uint32_t sample_rate, std::uint32_t src_count,
+                      std::pmr::memory_resource* memory, bool loopback = false);
     ~sound_output_impl() override;
 
     /**
@@ -56,7 +84,9 @@ public:
     void set_gain(float gain) noexcept override;
 
     /**
-     * @brief changes output device
+     * @brief changes output device, queued audio of every stream is preserved
+     * @details moves the context with ALC_SOFT_reopen_device if available, otherwise recreates the context
+     * and asks streams to recreate their OpenAL objects
      * @param device_name name of new output device
      */
     void change_device(std::string_view device_name) override;
@@ -64,15 +94,124 @@ public:
     std::uint32_t get_source();
     void          free_source(std::uint32_t source) noexcept;
 
+    void set_stream_transforms(stream* const* streams, const vector* positions, const vector* velocities,
+                               const vector* directions, std::size_t count) override;
+    void commit_transforms() override;
+
+    void set_culling(bool enabled, float min_gain) override;
+
+    /**
+     * @brief adds stream to spatial index, called by created stream
+     * @param stream stream
+     */
+    void register_stream(stream_impl* stream);
+    /**
+     * @brief removes stream from spatial index and staged transforms, called by destroyed stream
+     * @param stream stream
+     */
+    void unregister_stream(stream_impl* stream) noexcept;
+    /**
+     * @brief moves stream to the cell of its current position
+     * @param stream stream
+     */
+    void update_stream_cell(stream_impl* stream);
+    /**
+     * @brief requests culling recalculation, can be called from any thread
+     * @param distance_changed true if max distance of some stream was changed
+     */
+    void invalidate_culling(bool distance_changed = false) noexcept;
+    /**
+     * @brief checks if stream is culled, recalculates culling if it was invalidated
+     * @param stream stream
+     * @return true if stream shouldn't play
+     */
+    bool is_culled(const stream_impl* stream);
+
     void set_buffering_time(std::uint32_t time_ms) override;
+    void set_latency_profile(latency_profile profile) override;
+
+    bool render(float* samples, std::uint32_t frames) override;
 
     [[nodiscard]] float get_gain() const { return output_gain; }
 
-    [[nodiscard]] std::uint32_t get_buffering_time() const { return buffering_time; }
-    std::unique_ptr<stream>     create_stream() override;
+    memory_stats get_memory_stats() const override { return memory.get_stats(); }
+
+    /**
+     * @brief returns counting resource, that should be used for all allocations of the output and its streams
+     */
+    [[nodiscard]] std::pmr::memory_resource* get_memory_resource() noexcept { return &memory; }
+
+    [[nodiscard]] std::uint32_t get_buffering_time() const { return buffering_time.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief returns buffering of current latency profile, can be called from any thread
+     */
+    [[nodiscard]] playback_latency get_playback_latency() const noexcept {
+        return kvoice::get_playback_latency(latency.load(std::memory_order_relaxed));
+    }
+
+    [[nodiscard]] const al_extensions& get_extensions() const { return extensions; }
+
+    /**
+     * @brief returns sampling rate the device really mixes at
+     * @details streams write audio at this rate, so OpenAL doesn't resample it again
+     */
+    [[nodiscard]] std::uint32_t get_mixing_rate() const { return mixing_rate; }
+
+    /**
+     * @brief creates streams, that are returned by @p create_stream with the same options
+     * @param count count of streams
+     * @param options options of pooled streams
+     */
+    void fill_stream_pool(std::uint32_t count, const stream_options& options);
+
+    std::shared_ptr<sound_clip> load_clip(const void* samples, std::size_t count, sample_format format,
+                                          std::uint32_t sample_rate) override;
+    std::shared_ptr<sound_clip> load_opus_clip(const void* const* packets, const std::size_t* sizes,
+                                               std::size_t count) override;
+    bool play_clip(const std::shared_ptr<sound_clip>& clip, const clip_play_options& options) override;
+    void stop_clips() override;
+
+    std::unique_ptr<stream>       create_stream() override;
+    std::unique_ptr<stream>       create_stream(const stream_options& options) override;
+    std::unique_ptr<voice_source> create_voice_source() override;
+    std::unique_ptr<voice_source> create_voice_source(std::uint32_t decode_sample_rate) override;
 
     ktsignal::ktsignal<void()> drop_source_signal;
+    /**
+     * @brief emitted before the context is destroyed, streams should delete their OpenAL objects
+     */
+    ktsignal::ktsignal<void()> release_context_signal;
+    /**
+     * @brief emitted after the context is recreated, streams should recreate their OpenAL objects
+     */
+    ktsignal::ktsignal<void()> restore_context_signal;
 private:
+    void create_context();
+    void destroy_context();
+    /**
+     * @brief returns attributes of the context, that are used to create it and to reopen the device
+     */
+    [[nodiscard]] std::array<ALCint, 7> get_context_attributes() const;
+    void update_mixing_rate();
+    void load_extensions();
+
+    [[nodiscard]] std::uint32_t get_decode_rate(std::uint32_t decode_sample_rate) const;
+
+    [[nodiscard]] std::unique_ptr<stream_impl> make_stream(const stream_options& options);
+
+    /**
+     * @brief returns sources of finished clips to the pool
+     */
+    void reclaim_clip_sources();
+    void release_clip_source(std::uint32_t source) noexcept;
+
+    void update_culling();
+    void remove_from_cell(const stream_impl* stream, std::uint64_t cell) noexcept;
+
+    // declared first, so it outlives all containers
+    counting_resource memory;
+
     vector listener_pos{ 0.f, 0.f, 0.f };
     vector listener_vel{ 0.f, 0.f, 0.f };
     vector listener_front{ 0.f, 0.f, 0.f };
@@ -80,14 +219,50 @@ private:
 
     float output_gain{ 1.f };
 
-    std::uint32_t* sources{ nullptr };
-    std::uint32_t  src_count{ 0 };
-    std::uint32_t  buffering_time{ 0 };
-    std::uint32_t  sampling_rate{ 0 };
+    std::pmr::vector<std::uint32_t> sources{ &memory };
+    std::uint32_t                   src_count{ 0 };
+    std::uint32_t                   requested_src_count{ 0 };
+    std::uint32_t                   sampling_rate{ 0 };
+    std::uint32_t                   mixing_rate{ 0 };
+
+    // read by mixer thread of callback streams
+    std::atomic<std::uint32_t>   buffering_time{ 0 };
+    std::atomic<latency_profile> latency{ latency_profile::balanced };
+
+    pmr_queue<std::uint32_t>       free_sources{ std::pmr::deque<std::uint32_t>{ &memory } };
+    std::pmr::vector<stream_impl*> dirty_streams{ &memory };
+
+    /**
+     * @brief source, that plays a clip, the clip is kept alive until the source is reclaimed
+     */
+    struct playing_clip {
+        std::uint32_t                    source{ 0 };
+        std::shared_ptr<sound_clip_impl> clip;
+    };
+
+    std::pmr::vector<playing_clip> playing_clips{ &memory };
+
+    // uniform grid of spatial streams
+    std::pmr::unordered_map<std::uint64_t, std::pmr::vector<stream_impl*>> stream_grid{ &memory };
+    std::pmr::unordered_map<const stream_impl*, std::uint64_t>             stream_cells{ &memory };
+    std::pmr::unordered_set<const stream_impl*>                            audible_streams{ &memory };
+
+    bool              culling_enabled{ false };
+    float             culling_min_gain{ 0.f };
+    // max distance that doesn't silence any stream, infinity if some stream is never silent
+    float             max_audible_distance{ 0.f };
+    ALint             distance_model{ AL_INVERSE_DISTANCE_CLAMPED };
+    std::atomic<bool> culling_dirty{ true };
+    std::atomic<bool> audible_distance_dirty{ true };
+
+    al_extensions extensions{};
 
-    std::queue<std::uint32_t> free_sources{};
+    // streams are created before the user asks for them, pool is only taken from
+    stream_options                                 pooled_stream_options{};
+    std::pmr::vector<std::unique_ptr<stream_impl>> stream_pool{ &memory };
 
     ALCdevice*  device{ nullptr };
     ALCcontext* ctx{ nullptr };
+    bool        loopback{ false };
 };
 } // namespace kvoice
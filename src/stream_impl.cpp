@@ -1,15 +1,73 @@
 #include "stream_impl.hpp"
 
+#include "kvoice.hpp"
+#include "clock_source.hpp"
+#include "record_track.hpp"
+#include "simd.hpp"
 #include "voice_exception.hpp"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
 #include <AL/alc.h>
 #include <AL/al.h>
 #include <AL/alext.h>
 #include <opus.h>
 
-kvoice::stream_impl::stream_impl(sound_output_impl* output, std::int32_t sample_rate)
-    : sample_rate(sample_rate),
+namespace {
+/**
+ * @brief estimates gain of a source in the same way as OpenAL distance models
+ */
+float get_distance_gain(std::int32_t model, float distance, float reference, float max_distance,
+                        float rolloff) noexcept {
+    switch (model) {
+        case AL_INVERSE_DISTANCE_CLAMPED:
+        case AL_LINEAR_DISTANCE_CLAMPED:
+        case AL_EXPONENT_DISTANCE_CLAMPED:
+            distance = std::clamp(distance, reference, std::max(reference, max_distance));
+            break;
+        default:
+            break;
+    }
+
+    switch (model) {
+        case AL_INVERSE_DISTANCE:
+        case AL_INVERSE_DISTANCE_CLAMPED: {
+            if (reference <= 0.f) return 1.f;
+            const float denominator = reference + rolloff * (distance - reference);
+            return denominator > 0.f ? reference / denominator : 1.f;
+        }
+        case AL_LINEAR_DISTANCE:
+        case AL_LINEAR_DISTANCE_CLAMPED:
+            if (max_distance <= reference) return 1.f;
+            return std::max(0.f, 1.f - rolloff * (std::min(distance, max_distance) - reference) /
+                                       (max_distance - reference));
+        case AL_EXPONENT_DISTANCE:
+        case AL_EXPONENT_DISTANCE_CLAMPED:
+            if (reference <= 0.f || distance <= 0.f) return 1.f;
+            return std::pow(distance / reference, -rolloff);
+        default:
+            return 1.f;
+    }
+}
+}
+
+kvoice::stream_impl::stream_impl(sound_output_impl* output, std::int32_t decode_rate, std::int32_t sample_rate,
+                                 bool use_callback, sample_format format)
+    : memory(output->get_memory_resource()),
+      free_buffers(std::pmr::deque<std::uint32_t>{ memory }),
+      queued_buffers(std::pmr::deque<queued_buffer>{ memory }),
+      decode_rate(decode_rate),
+      sample_rate(sample_rate),
+      resample_buffer(memory),
+      stretcher(static_cast<std::uint32_t>(sample_rate), memory),
+      input_clock(sample_rate, true),
+      output_clock(sample_rate, false),
+      level(sample_rate),
       output_impl(output),
-      signal_connection(output->drop_source_signal.scoped_connect([this]() { if (has_source) drop_source(); })) {
+      signal_connection(output->drop_source_signal.scoped_connect([this]() { if (has_source) drop_source(); })),
+      release_connection(output->release_context_signal.scoped_connect([this]() { release_buffers(); })),
+      restore_connection(output->restore_context_signal.scoped_connect([this]() { restore_buffers(); })),
+      ring_buffer(format, memory) {
     alGenBuffers(kBuffersCount, buffers.data());
 
     for (auto buffer : buffers) {
@@ -21,40 +79,215 @@ kvoice::stream_impl::stream_impl(sound_output_impl* output, std::int32_t sample_
         throw voice_exception::create_formatted(
             "Failed to create al buffers (errc = {})", errc);
 
-    int opus_err;
-    decoder = opus_decoder_create(sample_rate, 1, &opus_err);
+    // decoder state is placed in memory of the output resource
+    decoder = static_cast<OpusDecoder*>(memory->allocate(opus_decoder_get_size(1), alignof(std::max_align_t)));
 
-    if (opus_err != OPUS_OK || !decoder)
+    if (const int opus_err = opus_decoder_init(decoder, decode_rate, 1); opus_err != OPUS_OK) {
+        memory->deallocate(decoder, opus_decoder_get_size(1), alignof(std::max_align_t));
         throw voice_exception::create_formatted(
             "Failed to opus decoder (errc = {})", opus_err);
+    }
+
+    // decoded audio is converted once to the output mixing rate, so OpenAL doesn't resample it
+    if (decode_rate != sample_rate) {
+        decode_resampler.emplace(decode_rate, sample_rate, kOpusBufferSize, memory);
+        resample_buffer.resize(decode_resampler->get_max_output(kOpusBufferSize));
+    }
+
+    // mixer thread can't allocate, so drift resampler is ready before it is enabled
+    callback_mode = use_callback;
+    if (callback_mode)
+        drift_resampler.emplace(sample_rate, sample_rate, kUploadBufferSize, memory);
+
+    output_impl->register_stream(this);
 }
 
 kvoice::stream_impl::~stream_impl() {
-    if (has_source)
-        output_impl->free_source(source);
+    output_impl->unregister_stream(this);
+    drop_source();
     alDeleteBuffers(kBuffersCount, buffers.data());
+    memory->deallocate(decoder, opus_decoder_get_size(1), alignof(std::max_align_t));
 }
 
 bool kvoice::stream_impl::push_opus_buffer(const void* data, std::size_t count) {
+    record_packet(data, count, std::nullopt);
+    return decode_to_ring(data, count) >= 0;
+}
+
+bool kvoice::stream_impl::push_opus_buffer(const void* data, std::size_t count, timestamp_t capture_time) {
+    record_packet(data, count, capture_time);
+
+    const auto first_sample = samples_pushed;
+
+    const int written = decode_to_ring(data, count);
+    if (written < 0) return false;
+
+    if (written > 0)
+        timestamp_marks.insert(timestamp_mark{ first_sample, static_cast<std::uint64_t>(written), capture_time });
+    return true;
+}
+
+void kvoice::stream_impl::record_packet(const void* data, std::size_t count,
+                                        std::optional<timestamp_t> capture_time) {
+    // received packets are recorded even if the stream doesn't play them
+    if (const auto track = recording.read(); track && *track)
+        (*track)->push(data, count);
+    if (const auto track = trace_packets.read(); track && *track)
+        (*track)->push(data, count, capture_time);
+}
+
+int kvoice::stream_impl::decode_to_ring(const void* data, std::size_t count) {
+    opus_packet_info info;
+    if (!inspect_opus_packet(data, count, decode_rate, info)) return -1;
+
+    const auto output_count = decode_resampler
+                                  ? decode_resampler->get_max_output(info.sample_count)
+                                  : static_cast<std::size_t>(info.sample_count);
+    mark_packet(output_count);
+
+    // sender is silent, there is nothing to buffer
+    last_packet_dtx.store(info.is_dtx, std::memory_order_relaxed);
+
+    if (info.is_dtx) {
+        dtx_packets.fetch_add(1, std::memory_order_relaxed);
+        input_clock.reset();
+        level.add_silence(output_count);
+        return 0;
+    }
+
+    // inaudible stream doesn't decode, decoder restarts when the stream becomes audible
+    if (culled.load(std::memory_order_relaxed)) {
+        decoder_stale = true;
+        input_clock.reset();
+        level.add_silence(output_count);
+        return 0;
+    }
+
+    if (decoder_stale) {
+        opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+        if (decode_resampler)
+            decode_resampler->reset();
+        decoder_stale = false;
+    }
+
+    // drop the whole packet instead of writing only its beginning
+    if (info.sample_count > kOpusBufferSize || ring_buffer.writeAvailable() < output_count) {
+        dropped_packets.fetch_add(1, std::memory_order_relaxed);
+        input_clock.reset();
+        return 0;
+    }
+
+    // 16-bit ring is filled directly by integer decoder when audio doesn't need resampling
+    if (ring_buffer.get_format() == sample_format::int16 && !decode_resampler) {
+        std::array<std::int16_t, kOpusBufferSize> pcm{};
+
+        const int frame_size = opus_decode(decoder, reinterpret_cast<const unsigned char*>(data),
+                                           static_cast<int>(count), pcm.data(), kOpusBufferSize, 0);
+        if (frame_size < 0) return -1;
+
+        return write_to_ring(pcm.data(), frame_size);
+    }
+
     std::array<float, kOpusBufferSize> out{};
 
     const int frame_size = opus_decode_float(decoder, reinterpret_cast<const unsigned char*>(data),
                                              static_cast<int>(count), out.data(),
                                              kOpusBufferSize, 0);
-    if (frame_size < 0) return false;
+    if (frame_size < 0) return -1;
+
+    if (!decode_resampler)
+        return write_to_ring(out.data(), frame_size);
+
+    const auto resampled = decode_resampler->process(out.data(), frame_size, resample_buffer.data(),
+                                                     resample_buffer.size());
+    return write_to_ring(resample_buffer.data(), resampled);
+}
 
-    float final_gain = extra_gain * output_impl->get_gain();
-    if (final_gain != 1.f) {
-        std::transform(out.begin(), out.begin() + frame_size, out.begin(),
-                       [final_gain](float v) { return v * final_gain; });
+template <typename T>
+int kvoice::stream_impl::write_to_ring(const T* samples, std::size_t count) {
+    const float final_gain = extra_gain * output_gain.load(std::memory_order_relaxed) * output_impl->get_gain();
+
+    // level is measured on the source chunk, that is already in cache for the gain pass
+    float sum_squares = 0.f;
+    float peak = 0.f;
+
+    std::size_t written = 0;
+    if (final_gain == 1.f) {
+        simd::measure(samples, count, sum_squares, peak);
+        written = ring_buffer.writeBuff(samples, count);
+    } else {
+        std::array<float, kOpusBufferSize> scaled;
+        while (written < count) {
+            const auto chunk = std::min(count - written, scaled.size());
+            simd::measure(samples + written, chunk, sum_squares, peak);
+            if constexpr (std::is_same_v<T, float>)
+                simd::scale(scaled.data(), samples + written, chunk, final_gain);
+            else
+                simd::convert(scaled.data(), samples + written, chunk, final_gain);
+
+            const auto chunk_written = ring_buffer.writeBuff(scaled.data(), chunk);
+            written += chunk_written;
+            if (chunk_written < chunk) break;
+        }
     }
 
-    ring_buffer.writeBuff(out.data(), frame_size);
-    return true;
+    level.add(sum_squares, peak, count);
+    samples_pushed += written;
+
+    // sender clock is observed only on continuous audio
+    if (written == count)
+        input_clock.add(get_clock_time(), samples_pushed);
+    else
+        input_clock.reset();
+
+    return static_cast<int>(written);
+}
+
+void kvoice::stream_impl::push_pcm_frame(const pcm_frame& frame) {
+    mark_packet(static_cast<std::size_t>(frame.count));
+
+    // silence of the sender is handled like DTX packet of own decoder
+    last_packet_dtx.store(frame.is_dtx, std::memory_order_relaxed);
+
+    if (frame.is_dtx) {
+        dtx_packets.fetch_add(1, std::memory_order_relaxed);
+        input_clock.reset();
+        level.add_silence(static_cast<std::size_t>(frame.count));
+        return;
+    }
+
+    if (culled.load(std::memory_order_relaxed)) {
+        input_clock.reset();
+        level.add_silence(static_cast<std::size_t>(frame.count));
+        return;
+    }
+
+    const auto first_sample = samples_pushed;
+
+    const int written = write_to_ring(frame.samples.data(), static_cast<std::size_t>(frame.count));
+
+    if (written > 0 && frame.has_capture_time)
+        timestamp_marks.insert(timestamp_mark{ first_sample, static_cast<std::uint64_t>(written),
+                                               frame.capture_time });
+}
+
+void kvoice::stream_impl::attach_source(voice_source_impl* source) {
+    source_connection.reset();
+    attached_source = source;
+    source_connection.emplace(source->frame_signal.scoped_connect(
+        [this](const std::shared_ptr<const pcm_frame>& frame) { push_pcm_frame(*frame); }));
+}
+
+void kvoice::stream_impl::detach_source(voice_source_impl* source) {
+    if (attached_source != source) return;
+
+    source_connection.reset();
+    attached_source = nullptr;
 }
 
 void kvoice::stream_impl::set_position(vector pos) {
     position = pos;
+    output_impl->update_stream_cell(this);
 
     if (has_source && is_spatial)
         alSourcefv(source, AL_POSITION, &position.x);
@@ -74,8 +307,39 @@ void kvoice::stream_impl::set_direction(vector dir) {
         alSourcefv(source, AL_DIRECTION, &direction.x);
 }
 
+void kvoice::stream_impl::stage_transform(const vector* pos, const vector* vel, const vector* dir) {
+    const auto stage = [this](vector& target, const vector* value, std::uint8_t flag) {
+        if (!value || (target.x == value->x && target.y == value->y && target.z == value->z)) return;
+
+        target = *value;
+        staged_transform |= flag;
+    };
+
+    stage(position, pos, kPositionDirty);
+    stage(velocity, vel, kVelocityDirty);
+    stage(direction, dir, kDirectionDirty);
+
+    if (staged_transform & kPositionDirty)
+        output_impl->update_stream_cell(this);
+}
+
+void kvoice::stream_impl::commit_transform() {
+    // source without spatial state or without source at all gets values in setup_spatial
+    if (has_source && is_spatial) {
+        if (staged_transform & kPositionDirty)
+            alSourcefv(source, AL_POSITION, &position.x);
+        if (staged_transform & kVelocityDirty)
+            alSourcefv(source, AL_VELOCITY, &velocity.x);
+        if (staged_transform & kDirectionDirty)
+            alSourcefv(source, AL_DIRECTION, &direction.x);
+    }
+
+    staged_transform = 0;
+}
+
 void kvoice::stream_impl::set_min_distance(float distance) {
     min_distance = distance;
+    output_impl->invalidate_culling();
 
     if (has_source && is_spatial)
         alSourcef(source, AL_REFERENCE_DISTANCE, min_distance);
@@ -83,6 +347,7 @@ void kvoice::stream_impl::set_min_distance(float distance) {
 
 void kvoice::stream_impl::set_max_distance(float distance) {
     max_distance = distance;
+    output_impl->invalidate_culling(true);
 
     if (has_source && is_spatial)
         alSourcef(source, AL_MAX_DISTANCE, max_distance);
@@ -90,20 +355,43 @@ void kvoice::stream_impl::set_max_distance(float distance) {
 
 void kvoice::stream_impl::set_rolloff_factor(float rolloff) {
     rollof_factor = rolloff;
+    output_impl->invalidate_culling();
     if (has_source && is_spatial)
         alSourcef(source, AL_ROLLOFF_FACTOR, rollof_factor);
 }
 
 void kvoice::stream_impl::set_spatial_state(bool spatial_state) {
     if (this->is_spatial == spatial_state) return;
-    if (!has_source) return;
 
+    // the state is applied when the stream gets a source
     this->is_spatial = spatial_state;
-    setup_spatial();
+    output_impl->invalidate_culling();
+
+    if (has_source)
+        setup_spatial();
 }
 
 void kvoice::stream_impl::set_gain(float gain) {
-    output_gain = gain;
+    output_gain.store(gain, std::memory_order_relaxed);
+    output_impl->invalidate_culling();
+}
+
+bool kvoice::stream_impl::is_audible_from(const vector& listener, float min_gain,
+                                          std::int32_t distance_model) const noexcept {
+    const float dx = position.x - listener.x;
+    const float dy = position.y - listener.y;
+    const float dz = position.z - listener.z;
+    const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+    const float gain = extra_gain * output_gain.load(std::memory_order_relaxed) *
+                       get_distance_gain(distance_model, distance, min_distance, max_distance, rollof_factor);
+    return gain > 0.f && gain >= min_gain;
+}
+
+float kvoice::stream_impl::get_silent_distance(std::int32_t distance_model) const noexcept {
+    // only linear models reach zero gain, and only if rolloff is strong enough
+    const bool linear = distance_model == AL_LINEAR_DISTANCE || distance_model == AL_LINEAR_DISTANCE_CLAMPED;
+    return linear && rollof_factor >= 1.f ? max_distance : std::numeric_limits<float>::infinity();
 }
 
 bool kvoice::stream_impl::is_playing() {
@@ -111,8 +399,22 @@ bool kvoice::stream_impl::is_playing() {
 }
 
 bool kvoice::stream_impl::update() {
+    if (const auto track = trace_updates.read(); track && *track)
+        (*track)->push_update(get_clock_time());
+
+    if (output_impl->is_culled(this)) {
+        skip_culled();
+        return true;
+    }
+    culled.store(false, std::memory_order_relaxed);
+    last_update_time = get_clock_time();
+
+    // silent sender has nothing to play, so the stream isn't starved anymore
+    if (is_sender_silent())
+        end_underrun();
+
     if (!has_source) {
-        if (ring_buffer.isEmpty())
+        if (ring_buffer.isEmpty() && !stretcher.get_buffered())
             return true;
 
         try {
@@ -122,12 +424,14 @@ bool kvoice::stream_impl::update() {
         }
 
         has_source = true;
-        last_source_request_time = std::chrono::steady_clock::now();
+        last_source_request_time = get_clock_time();
 
         source_used_once = false;
 
         try {
             update_source(source);
+            if (callback_mode)
+                attach_callback_buffer();
         } catch (voice_exception&) {
             drop_source();
             return false;
@@ -135,12 +439,18 @@ bool kvoice::stream_impl::update() {
         playing = false;
     }
 
+    if (callback_mode)
+        return update_callback_source();
+
     std::int32_t state, processed;
 
     alGetSourcei(source, AL_SOURCE_STATE, &state);
     if (alGetError() != AL_NO_ERROR)
         return false;
 
+    // source stops by itself only when all queued buffers were played
+    if (playing && state != AL_PLAYING && !is_sender_silent())
+        begin_underrun();
     playing = state == AL_PLAYING;
 
     alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
@@ -149,62 +459,66 @@ bool kvoice::stream_impl::update() {
         return false;
     }
 
-    if (ring_buffer.isEmpty() && !playing && source_used_once) {
-        while (processed > 0) {
-            ALuint bufid;
-            alSourceUnqueueBuffers(source, 1, &bufid);
-            free_buffers.push(bufid);
-            processed--;
-        }
+    if (ring_buffer.isEmpty() && !stretcher.get_buffered() && !playing && source_used_once) {
+        unqueue_processed(processed);
 
         drop_source();
         return true;
     }
 
-    if (ring_buffer.readAvailable() >= kRingBufferSize / 2)
-        alSourcef(source, AL_PITCH, 1.05f);
-    else
-        alSourcef(source, AL_PITCH, 1.f);
+    unqueue_processed(processed);
+    update_speed();
+    update_drift();
 
-    if (alGetError() != AL_NO_ERROR) {
-        drop_source();
-        return false;
-    }
+    const auto latency = output_impl->get_playback_latency();
+    const auto target_level = get_target_level();
+    const auto chunk_size = std::clamp<std::size_t>(to_samples(latency.chunk_time), 1, kUploadBufferSize);
 
-    while (processed > 0) {
-        ALuint bufid;
-        alSourceUnqueueBuffers(source, 1, &bufid);
-        free_buffers.push(bufid);
-        processed--;
-    }
+    // source queue is kept short, so the rest of backlog stays in the ring buffer where tempo can be changed
+    while (!free_buffers.empty() && queued_buffers.size() < latency.queue_depth &&
+           (queued_buffers.size() < 2 || queued_samples < target_level)) {
+        std::array<float, kUploadBufferSize> temp_buffer{};
+        const auto input_position = stretcher.get_input_position();
 
-    while (!ring_buffer.isEmpty() && !free_buffers.empty()) {
-        std::array<float, 4096> temp_buffer{};
-        const std::uint32_t     buffer_id = free_buffers.front();
+        // drain the stretcher only when the source is about to run out of data
+        const std::size_t readed = fill_upload_buffer(temp_buffer.data(), chunk_size, queued_buffers.size() < 2);
+        if (readed == 0) break;
+
+        const std::uint32_t buffer_id = free_buffers.front();
         free_buffers.pop();
 
-        if (const std::size_t readed = ring_buffer.readBuff(temp_buffer.data(), temp_buffer.size()); readed > 0) {
+        if (ring_buffer.get_format() == sample_format::int16) {
+            std::array<std::int16_t, kUploadBufferSize> pcm_buffer;
+            simd::convert(pcm_buffer.data(), temp_buffer.data(), readed);
+            alBufferData(buffer_id, AL_FORMAT_MONO16, pcm_buffer.data(),
+                         static_cast<int>(readed * sizeof(std::int16_t)), sample_rate);
+        } else {
             alBufferData(buffer_id, AL_FORMAT_MONO_FLOAT32, temp_buffer.data(),
                          static_cast<int>(readed * sizeof(float)), sample_rate);
-            if (alGetError() != AL_NO_ERROR) {
-                drop_source();
-                return false;
-            }
+        }
+        if (alGetError() != AL_NO_ERROR) {
+            free_buffers.push(buffer_id);
+            drop_source();
+            return false;
+        }
 
-            alSourceQueueBuffers(source, 1, &buffer_id);
-            if (alGetError() != AL_NO_ERROR) {
-                drop_source();
-                return false;
-            }
-        } else
-            break;
+        alSourceQueueBuffers(source, 1, &buffer_id);
+        if (alGetError() != AL_NO_ERROR) {
+            free_buffers.push(buffer_id);
+            drop_source();
+            return false;
+        }
+
+        const auto input_samples = std::llround(stretcher.get_input_position()) - std::llround(input_position);
+        queued_buffers.push(queued_buffer{ static_cast<std::uint32_t>(readed),
+                                           static_cast<std::uint32_t>(std::max<long long>(input_samples, 0)) });
+        queued_samples += readed;
     }
 
     if (!playing) {
-        auto ctime = std::chrono::steady_clock::now();
-        auto time_from_first_buffer = std::chrono::duration_cast<std::chrono::milliseconds>(
-            ctime - last_source_request_time).count();
-        if (time_from_first_buffer > output_impl->get_buffering_time()) {
+        if (skip_buffering || is_start_level_reached()) {
+            skip_buffering = false;
+            end_underrun();
             alSourcePlay(source);
             source_used_once = true;
             if (alGetError() != AL_NO_ERROR) {
@@ -213,9 +527,107 @@ bool kvoice::stream_impl::update() {
             }
         }
     }
+
+    if (playing)
+        measure_latency();
     return true;
 }
 
+kvoice::stream_stats kvoice::stream_impl::get_stats() const {
+    stream_stats stats;
+    stats.mouth_to_ear_latency = mouth_to_ear_latency.load(std::memory_order_relaxed);
+    stats.output_latency = output_latency.load(std::memory_order_relaxed);
+    stats.buffered_samples = ring_buffer.readAvailable();
+    stats.playback_speed = playback_speed.load(std::memory_order_relaxed);
+    stats.clock_drift_ppm = clock_drift_ppm.load(std::memory_order_relaxed);
+    stats.dtx_packets = dtx_packets.load(std::memory_order_relaxed);
+    stats.dropped_packets = dropped_packets.load(std::memory_order_relaxed);
+    stats.underruns = underruns.load(std::memory_order_relaxed);
+    stats.underrun_time = underrun_time.load(std::memory_order_relaxed);
+    // stopped playback is counted up to now
+    if (const auto start = underrun_start.load(std::memory_order_relaxed); start != kNoUnderrun)
+        stats.underrun_time += std::max<timestamp_t>(get_clock_time() - start, 0);
+    return stats;
+}
+
+std::size_t kvoice::stream_impl::to_samples(timestamp_t time) const noexcept {
+    return static_cast<std::size_t>(static_cast<std::int64_t>(sample_rate) * time / 1000000);
+}
+
+std::size_t kvoice::stream_impl::get_target_level() const noexcept {
+    return to_samples(get_target_delay());
+}
+
+kvoice::timestamp_t kvoice::stream_impl::get_target_delay() const noexcept {
+    const auto buffering_time = static_cast<timestamp_t>(output_impl->get_buffering_time()) * 1000;
+    return std::max(output_impl->get_playback_latency().target_level, buffering_time);
+}
+
+void kvoice::stream_impl::mark_packet(std::size_t count) noexcept {
+    const auto now = get_clock_time();
+    const auto silence = get_sender_silence(now);
+    last_packet_end.store(now + static_cast<timestamp_t>(count) * 1000000 / sample_rate, std::memory_order_relaxed);
+
+    // level isn't updated while nothing comes, so the meter catches up with the silence readers already saw
+    if (silence > 0)
+        level.add_silence(to_samples(silence));
+}
+
+kvoice::timestamp_t kvoice::stream_impl::get_sender_silence(timestamp_t now) const noexcept {
+    const auto end = last_packet_end.load(std::memory_order_relaxed);
+    if (end == kNoPacket) return 0;
+    return std::max<timestamp_t>(now - end - get_target_delay(), 0);
+}
+
+bool kvoice::stream_impl::is_sender_silent() const noexcept {
+    // sender without DTX just stops sending, starved buffer is underrun only while packets are still arriving
+    return last_packet_dtx.load(std::memory_order_relaxed) || get_sender_silence(get_clock_time()) > 0;
+}
+
+bool kvoice::stream_impl::is_start_level_reached() const noexcept {
+    const auto buffering_time = static_cast<timestamp_t>(output_impl->get_buffering_time()) * 1000;
+    const auto start_level = std::max(output_impl->get_playback_latency().start_level, buffering_time);
+    const auto buffered = ring_buffer.readAvailable() + stretcher.get_buffered() + queued_samples;
+
+    // talk spurt shorter than the start level is played when the sender goes silent by DTX or stops sending,
+    // or after the wait limit
+    return buffered >= to_samples(start_level) || is_sender_silent() ||
+           get_clock_time() - last_source_request_time > start_level * kMaxStartWaitFactor;
+}
+
+void kvoice::stream_impl::begin_underrun() noexcept {
+    underruns.fetch_add(1, std::memory_order_relaxed);
+    timestamp_t expected = kNoUnderrun;
+    underrun_start.compare_exchange_strong(expected, get_clock_time(), std::memory_order_relaxed);
+}
+
+void kvoice::stream_impl::end_underrun() noexcept {
+    const auto start = underrun_start.exchange(kNoUnderrun, std::memory_order_relaxed);
+    if (start != kNoUnderrun)
+        underrun_time.fetch_add(std::max<timestamp_t>(get_clock_time() - start, 0), std::memory_order_relaxed);
+}
+
+void kvoice::stream_impl::set_record_track(std::shared_ptr<record_track> track) {
+    std::lock_guard lck(record_mutex);
+    recording.replace(track ? std::make_unique<std::shared_ptr<record_track>>(std::move(track)) : nullptr);
+}
+
+void kvoice::stream_impl::set_trace_track(std::shared_ptr<record_track> track) {
+    std::lock_guard lck(record_mutex);
+    trace_updates.replace(track ? std::make_unique<std::shared_ptr<record_track>>(track) : nullptr);
+    trace_packets.replace(track ? std::make_unique<std::shared_ptr<record_track>>(std::move(track)) : nullptr);
+}
+
+kvoice::stream_level kvoice::stream_impl::get_level() const {
+    // without DTX the sender just stops sending, level is decayed by the time nothing comes from any playback path
+    return level.get_level(to_samples(get_sender_silence(get_clock_time())));
+}
+
+void kvoice::stream_impl::set_speaking_detection(float threshold_db, std::uint32_t attack_ms,
+                                                 std::uint32_t release_ms) {
+    level.set_speaking_detection(threshold_db, attack_ms, release_ms);
+}
+
 void kvoice::stream_impl::setup_spatial() const {
     if (!this->is_spatial) {
         vector zeros{ 0.f, 0.f, 0.f };
@@ -252,9 +664,315 @@ void kvoice::stream_impl::update_source(std::uint32_t source_handle) const {
             "failed to update source (last errc = {})", errc);
 }
 
+void kvoice::stream_impl::attach_callback_buffer() {
+    const ALenum format = ring_buffer.get_format() == sample_format::int16 ? AL_FORMAT_MONO16
+                                                                           : AL_FORMAT_MONO_FLOAT32;
+    output_impl->get_extensions().alBufferCallbackSOFT(buffers[0], format, sample_rate,
+                                                       &stream_impl::buffer_callback, this);
+    alSourcei(source, AL_BUFFER, static_cast<ALint>(buffers[0]));
+
+    ALenum errc;
+    if ((errc = alGetError()) != AL_NO_ERROR)
+        throw voice_exception::create_formatted(
+            "failed to attach callback buffer (last errc = {})", errc);
+}
+
+bool kvoice::stream_impl::update_callback_source() {
+    std::int32_t state;
+
+    alGetSourcei(source, AL_SOURCE_STATE, &state);
+    if (alGetError() != AL_NO_ERROR)
+        return false;
+
+    playing = state == AL_PLAYING;
+    if (playing) {
+        update_drift();
+        measure_latency();
+        return true;
+    }
+
+    // the mixer doesn't pull stopped source, it stops when the stream runs out of samples
+    if (ring_buffer.isEmpty() && !stretcher.get_buffered()) {
+        if (source_used_once)
+            drop_source();
+        return true;
+    }
+
+    if (source_used_once || skip_buffering || is_start_level_reached()) {
+        skip_buffering = false;
+        output_clock.reset();
+        end_underrun();
+        alSourcePlay(source);
+        source_used_once = true;
+        if (alGetError() != AL_NO_ERROR) {
+            drop_source();
+            return false;
+        }
+    }
+    return true;
+}
+
+ALsizei kvoice::stream_impl::buffer_callback(void* userptr, void* data, ALsizei size) noexcept {
+    auto* self = static_cast<stream_impl*>(userptr);
+
+    if (self->ring_buffer.get_format() == sample_format::int16) {
+        const auto count = static_cast<std::size_t>(size) / sizeof(std::int16_t);
+        return static_cast<ALsizei>(self->pull_samples(static_cast<std::int16_t*>(data), count) *
+                                    sizeof(std::int16_t));
+    }
+
+    const auto count = static_cast<std::size_t>(size) / sizeof(float);
+    return static_cast<ALsizei>(self->pull_samples(static_cast<float*>(data), count) * sizeof(float));
+}
+
+std::size_t kvoice::stream_impl::pull_samples(float* output, std::size_t count) {
+    output_clock.add(get_clock_time(), output_samples_played);
+    update_speed();
+
+    const auto  input_position = stretcher.get_input_position();
+    std::size_t produced = 0;
+    while (produced < count) {
+        const std::size_t readed = fill_upload_buffer(output + produced, count - produced, true);
+        if (readed == 0) break;
+        produced += readed;
+    }
+
+    // returning less than requested stops the source
+    const auto played_index = samples_played;
+    const auto input_samples = std::llround(stretcher.get_input_position()) - std::llround(input_position);
+    samples_played += static_cast<std::uint64_t>(std::max<long long>(input_samples, 0));
+    output_samples_played += produced;
+
+    if (produced < count && !is_sender_silent())
+        begin_underrun();
+
+    if (produced)
+        update_mouth_to_ear(played_index, output_latency.load(std::memory_order_relaxed));
+    return produced;
+}
+
+std::size_t kvoice::stream_impl::pull_samples(std::int16_t* output, std::size_t count) {
+    std::array<float, kUploadBufferSize> temp_buffer;
+
+    std::size_t produced = 0;
+    while (produced < count) {
+        const auto chunk = std::min(count - produced, temp_buffer.size());
+        const auto readed = pull_samples(temp_buffer.data(), chunk);
+
+        simd::convert(output + produced, temp_buffer.data(), readed);
+        produced += readed;
+        if (readed < chunk) break;
+    }
+    return produced;
+}
+
+void kvoice::stream_impl::release_buffers() {
+    drop_source();
+
+    alDeleteBuffers(kBuffersCount, buffers.data());
+
+    while (!free_buffers.empty()) {
+        free_buffers.pop();
+    }
+    while (!queued_buffers.empty()) {
+        samples_played += queued_buffers.front().input_samples;
+        output_samples_played += queued_buffers.front().output_samples;
+        queued_buffers.pop();
+    }
+    queued_samples = 0;
+}
+
+void kvoice::stream_impl::restore_buffers() {
+    alGenBuffers(kBuffersCount, buffers.data());
+
+    if (alGetError() != AL_NO_ERROR) {
+        buffers.fill(0);
+        return;
+    }
+
+    for (auto buffer : buffers) {
+        free_buffers.push(buffer);
+    }
+
+    // audio was already buffered before device change, so resume playback on next update
+    skip_buffering = !ring_buffer.isEmpty();
+}
+
+void kvoice::stream_impl::unqueue_processed(std::int32_t processed) {
+    while (processed > 0) {
+        ALuint bufid;
+        alSourceUnqueueBuffers(source, 1, &bufid);
+        free_buffers.push(bufid);
+        if (!queued_buffers.empty()) {
+            samples_played += queued_buffers.front().input_samples;
+            output_samples_played += queued_buffers.front().output_samples;
+            queued_samples -= queued_buffers.front().output_samples;
+            queued_buffers.pop();
+        }
+        processed--;
+    }
+}
+
+void kvoice::stream_impl::measure_latency() {
+    const auto& extensions = output_impl->get_extensions();
+    if (!extensions.alGetSourcei64vSOFT) return;
+
+    ALint64SOFT offset_latency[2]{};
+    extensions.alGetSourcei64vSOFT(source, AL_SAMPLE_OFFSET_LATENCY_SOFT, offset_latency);
+    if (alGetError() != AL_NO_ERROR) return;
+
+    // offset is in 32.32 fixed point and relative to the first queued buffer, latency is in nanoseconds
+    const auto latency = static_cast<timestamp_t>(offset_latency[1] / 1000);
+    output_latency.store(latency, std::memory_order_relaxed);
+
+    // mixer thread measures latency of samples when it pulls them
+    if (callback_mode) return;
+
+    auto offset = static_cast<std::uint64_t>(offset_latency[0] >> 32);
+
+    // buffer may be time-stretched, so offset is converted to ring buffer samples
+    if (!queued_buffers.empty() && queued_buffers.front().output_samples) {
+        const auto& front = queued_buffers.front();
+        offset = std::min<std::uint64_t>(offset, front.output_samples) * front.input_samples / front.output_samples;
+    }
+
+    update_mouth_to_ear(samples_played + offset, latency);
+}
+
+void kvoice::stream_impl::update_mouth_to_ear(std::uint64_t played_index, timestamp_t latency) {
+    // skip marks of packets that were already played
+    timestamp_mark* mark;
+    while ((mark = timestamp_marks.peek()) && mark->sample_index + mark->sample_count <= played_index)
+        timestamp_marks.remove();
+
+    if (mark && mark->sample_index <= played_index) {
+        const auto capture_time = mark->capture_time + samples_to_timestamp(
+                                      static_cast<std::int64_t>(played_index - mark->sample_index), sample_rate);
+        mouth_to_ear_latency.store(get_clock_time() + latency - capture_time, std::memory_order_relaxed);
+    }
+}
+
+void kvoice::stream_impl::skip_culled() {
+    culled.store(true, std::memory_order_relaxed);
+
+    if (has_source) {
+        drop_source();
+        playing = false;
+    }
+
+    // buffered audio is dropped as if it was played, so the stream resumes in sync with the sender
+    const auto now = get_clock_time();
+    const auto elapsed = std::max<timestamp_t>(now - last_update_time, 0);
+    last_update_time = now;
+
+    const auto to_skip = static_cast<std::uint64_t>(elapsed) * static_cast<std::uint64_t>(sample_rate) / 1000000;
+    const auto skipped = ring_buffer.remove(static_cast<std::size_t>(
+        std::min<std::uint64_t>(to_skip, ring_buffer.readAvailable())));
+    samples_played += skipped;
+
+    if (ring_buffer.isEmpty() && stretcher.get_buffered()) {
+        samples_played += stretcher.get_buffered();
+        stretcher.reset();
+    }
+    output_clock.reset();
+}
+
+void kvoice::stream_impl::update_speed() {
+    const auto target_level = static_cast<double>(get_target_level());
+    const auto level = static_cast<double>(ring_buffer.readAvailable() + stretcher.get_buffered() + queued_samples);
+
+    // tempo is proportional to the deviation from the target level, small deviations are ignored
+    const double deviation = (level - target_level) / target_level;
+    double       speed = 1.0;
+    if (std::abs(deviation) > kLevelDeadZone)
+        speed = 1.0 + std::clamp(deviation * kMaxSpeedDeviation, -kMaxSpeedDeviation, kMaxSpeedDeviation);
+
+    stretcher.set_speed(speed);
+    playback_speed.store(static_cast<float>(speed), std::memory_order_relaxed);
+}
+
+void kvoice::stream_impl::update_drift() {
+    // output clock of callback source is observed by the mixer thread
+    if (!callback_mode) {
+        if (!playing) {
+            output_clock.reset();
+            return;
+        }
+
+        ALint offset = 0;
+        alGetSourcei(source, AL_SAMPLE_OFFSET, &offset);
+        if (alGetError() != AL_NO_ERROR) return;
+
+        output_clock.add(get_clock_time(), output_samples_played + static_cast<std::uint64_t>(offset));
+    }
+
+    if (input_clock.get_observed_time() < kMinDriftObservation ||
+        output_clock.get_observed_time() < kMinDriftObservation)
+        return;
+
+    // sender samples per one played sample
+    const double ratio = (1.0 + input_clock.get_deviation()) / (1.0 + output_clock.get_deviation());
+    const double ppm = std::clamp((ratio - 1.0) * 1e6, -kMaxDriftPpm, kMaxDriftPpm);
+    clock_drift_ppm.store(ppm, std::memory_order_relaxed);
+
+    // resampler is kept once enabled, so compensation changes don't produce discontinuities
+    if (drift_correction.load(std::memory_order_relaxed) == 0.0) {
+        if (std::abs(ppm) < kMinCompensatedDriftPpm) return;
+
+        if (!drift_resampler)
+            drift_resampler.emplace(sample_rate, sample_rate, kUploadBufferSize, memory);
+    }
+    drift_correction.store(1.0 + ppm * 1e-6, std::memory_order_relaxed);
+}
+
+std::size_t kvoice::stream_impl::fill_upload_buffer(float* output, std::size_t capacity, bool drain) {
+    const double correction = drift_correction.load(std::memory_order_relaxed);
+    if (correction == 0.0)
+        return stretch_from_ring(output, capacity, drain);
+
+    drift_resampler->set_correction(correction);
+
+    return drift_resampler->pull(output, capacity, [this, drain](float* input, std::size_t count) {
+        return stretch_from_ring(input, count, drain);
+    });
+}
+
+std::size_t kvoice::stream_impl::stretch_from_ring(float* output, std::size_t capacity, bool drain) {
+    std::array<float, kStretchChunkSize> chunk;
+
+    std::size_t produced = stretcher.pull(output, capacity);
+    while (produced < capacity) {
+        const auto readed = ring_buffer.readBuff(chunk.data(), chunk.size());
+        if (readed == 0) {
+            // input has stopped, the rest of stretcher input is played without waiting for next frame
+            if (drain) {
+                stretcher.flush();
+                produced += stretcher.pull(output + produced, capacity - produced);
+            }
+            break;
+        }
+
+        stretcher.push(chunk.data(), readed);
+        produced += stretcher.pull(output + produced, capacity - produced);
+    }
+    return produced;
+}
+
 void kvoice::stream_impl::drop_source() {
     if (has_source) {
+        // mixer doesn't call the callback after the source is stopped
         alSourceStop(source);
+
+        if (callback_mode) {
+            // buffer can't be reattached to another source while it is used by this one
+            alSourcei(source, AL_BUFFER, AL_NONE);
+        } else {
+            // all queued buffers become processed after stop
+            std::int32_t processed = 0;
+            alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+            unqueue_processed(processed);
+        }
+
         output_impl->free_source(source);
 
         has_source = false;
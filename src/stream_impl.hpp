@@ -2,32 +2,101 @@
 
 #include <cstdint>
 #include <array>
+#include <atomic>
 #include <chrono>
-#include <queue>
+#include <limits>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <vector>
 
 #include "ringbuffer.hpp"
+#include "sample_ring.hpp"
+#include "resampler.hpp"
+#include "time_stretcher.hpp"
+#include "clock_tracker.hpp"
+#include "level_meter.hpp"
+#include "memory.hpp"
+#include "rcu_cell.hpp"
 #include "sound_output_impl.hpp"
+#include "voice_source_impl.hpp"
 #include "kv_vector.hpp"
 #include "stream.hpp"
 
 struct OpusDecoder;
 
 namespace kvoice {
-class stream_impl final : public stream {
+class stream_impl final : public stream, public resource_allocated {
     static void _foo() {
     }
 
+    static void _foo_frame(const std::shared_ptr<const pcm_frame>&) {
+    }
+
     using sconnection_t = decltype(sound_output_impl::drop_source_signal.scoped_connect(&_foo));
+    using fconnection_t = decltype(voice_source_impl::frame_signal.scoped_connect(&_foo_frame));
 
     static constexpr auto kBuffersCount = 16;
-    static constexpr auto kMinBuffersCount = 8;
     static constexpr auto kRingBufferSize = 262144;
     static constexpr auto kOpusBufferSize = 8196;
+    static constexpr auto kTimestampMarksCount = 64;
+    static constexpr auto kUploadBufferSize = 4096;
+    static constexpr auto kStretchChunkSize = 1024;
+    // playback starts without reaching the start level after waiting this many times its duration
+    static constexpr auto kMaxStartWaitFactor = 2;
+    // max relative tempo change of time-stretch
+    static constexpr auto kMaxSpeedDeviation = 0.05;
+    // relative deviation from the target level that doesn't change tempo
+    static constexpr auto kLevelDeadZone = 0.25;
+    // clocks are observed for this time before drift is compensated
+    static constexpr timestamp_t kMinDriftObservation = 30000000;
+    // drift below this value doesn't enable compensation
+    static constexpr auto kMinCompensatedDriftPpm = 5.0;
+    static constexpr auto kMaxDriftPpm = 1000.0;
+    // value of underrun start when playback isn't starved
+    static constexpr timestamp_t kNoUnderrun = std::numeric_limits<timestamp_t>::min();
+    // value of last packet end before the first packet
+    static constexpr timestamp_t kNoPacket = std::numeric_limits<timestamp_t>::min();
+
+    /**
+     * @brief maps position of the first sample of pushed packet to its capture timestamp
+     */
+    struct timestamp_mark {
+        std::uint64_t sample_index{ 0 };
+        std::uint64_t sample_count{ 0 };
+        timestamp_t   capture_time{ 0 };
+    };
+
+    enum transform_flags : std::uint8_t {
+        kPositionDirty = 1 << 0,
+        kVelocityDirty = 1 << 1,
+        kDirectionDirty = 1 << 2
+    };
+
+    /**
+     * @brief buffer queued on the source
+     */
+    struct queued_buffer {
+        // samples in the buffer
+        std::uint32_t output_samples{ 0 };
+        // samples of ring buffer that were time-stretched into the buffer
+        std::uint32_t input_samples{ 0 };
+    };
 public:
-    stream_impl(sound_output_impl* output, std::int32_t sample_rate);
+    /**
+     * @brief Constructor
+     * @param output Output that owns the stream
+     * @param decode_rate Opus decoder sampling rate
+     * @param sample_rate Playback sampling rate
+     * @param use_callback True if the mixer pulls audio through callback buffer(AL_SOFT_callback_buffer)
+     * @param format Format of buffered samples
+     */
+    stream_impl(sound_output_impl* output, std::int32_t decode_rate, std::int32_t sample_rate, bool use_callback,
+                sample_format format);
     ~stream_impl() override;
 
     bool push_opus_buffer(const void* data, std::size_t count) override;
+    bool push_opus_buffer(const void* data, std::size_t count, timestamp_t capture_time) override;
 
     void set_position(vector pos) override;
     void set_velocity(vector vel) override;
@@ -42,37 +111,212 @@ public:
 
     bool update() override;
 
+    stream_stats get_stats() const override;
+
+    stream_level get_level() const override;
+    void         set_speaking_detection(float threshold_db, std::uint32_t attack_ms, std::uint32_t release_ms) override;
+
+    /**
+     * @brief subscribes stream to decoded frames of voice source
+     * @param source voice source
+     */
+    void attach_source(voice_source_impl* source);
+    /**
+     * @brief unsubscribes stream from decoded frames if it is attached to @p source
+     * @param source voice source
+     */
+    void detach_source(voice_source_impl* source);
+
+    /**
+     * @brief sets recorder track, that receives pushed packets(nullptr to stop recording)
+     * @param track recorder track
+     */
+    void set_record_track(std::shared_ptr<record_track> track);
+    /**
+     * @brief sets trace track, that receives pushed packets and updates(nullptr to stop tracing)
+     * @param track trace track
+     */
+    void set_trace_track(std::shared_ptr<record_track> track);
+
+    [[nodiscard]] std::uint32_t get_decode_rate() const noexcept { return static_cast<std::uint32_t>(decode_rate); }
+    [[nodiscard]] std::uint32_t get_sample_rate() const noexcept { return static_cast<std::uint32_t>(sample_rate); }
+    [[nodiscard]] bool          is_callback_mode() const noexcept { return callback_mode; }
+    [[nodiscard]] sample_format get_format() const noexcept { return ring_buffer.get_format(); }
+
+    /**
+     * @brief stores new transform values and marks changed ones, they are applied by @p commit_transform
+     * @param pos new position(nullptr to keep)
+     * @param vel new velocity(nullptr to keep)
+     * @param dir new direction(nullptr to keep)
+     */
+    void stage_transform(const vector* pos, const vector* vel, const vector* dir);
+    /**
+     * @brief applies changed transform values to the source
+     */
+    void commit_transform();
+
+    [[nodiscard]] bool has_staged_transform() const noexcept { return staged_transform != 0; }
+
+    [[nodiscard]] const vector& get_position() const noexcept { return position; }
+    [[nodiscard]] float         get_max_distance() const noexcept { return max_distance; }
+    [[nodiscard]] bool          is_spatial_stream() const noexcept { return is_spatial; }
+
+    /**
+     * @brief checks if stream may be heard by the listener
+     * @param listener listener position
+     * @param min_gain min estimated gain of audible stream, 0 to cull only silent streams
+     * @param distance_model OpenAL distance model of the context
+     * @return true if estimated gain isn't zero and isn't lower than @p min_gain
+     */
+    [[nodiscard]] bool is_audible_from(const vector& listener, float min_gain,
+                                       std::int32_t distance_model) const noexcept;
+    /**
+     * @brief returns distance, that silences the stream in @p distance_model(infinity if the model never does)
+     */
+    [[nodiscard]] float get_silent_distance(std::int32_t distance_model) const noexcept;
+
 private:
-    void setup_spatial() const;
-    void update_source(std::uint32_t source) const;
-    void drop_source();
+    static ALsizei buffer_callback(void* userptr, void* data, ALsizei size) noexcept;
+
+    int         decode_to_ring(const void* data, std::size_t count);
+    void        record_packet(const void* data, std::size_t count, std::optional<timestamp_t> capture_time);
+    void        begin_underrun() noexcept;
+    /**
+     * @brief converts duration to count of samples at output rate
+     */
+    [[nodiscard]] std::size_t to_samples(timestamp_t time) const noexcept;
+    /**
+     * @brief returns buffer level kept by time-stretch in samples
+     */
+    [[nodiscard]] std::size_t get_target_level() const noexcept;
+    /**
+     * @brief returns buffer level kept by time-stretch in microseconds
+     */
+    [[nodiscard]] timestamp_t get_target_delay() const noexcept;
+    /**
+     * @brief marks arrival of packet or frame, called from producer side
+     * @param count count of samples in the packet at output rate
+     */
+    void        mark_packet(std::size_t count) noexcept;
+    /**
+     * @brief returns time the sender doesn't send anything, zero while packets are still expected to arrive
+     * @details packet is late by jitter up to the target level, so the sender is silent only after it
+     */
+    [[nodiscard]] timestamp_t get_sender_silence(timestamp_t now) const noexcept;
+    /**
+     * @brief checks if the sender went silent by DTX or stopped sending packets, so stop of playback isn't underrun
+     */
+    [[nodiscard]] bool        is_sender_silent() const noexcept;
+    /**
+     * @brief checks if enough audio is buffered to start playback
+     */
+    [[nodiscard]] bool        is_start_level_reached() const noexcept;
+    void        end_underrun() noexcept;
+    template <typename T>
+    int         write_to_ring(const T* samples, std::size_t count);
+    void        push_pcm_frame(const pcm_frame& frame);
+    void        setup_spatial() const;
+    void        update_source(std::uint32_t source) const;
+    void        attach_callback_buffer();
+    bool        update_callback_source();
+    std::size_t pull_samples(float* output, std::size_t count);
+    std::size_t pull_samples(std::int16_t* output, std::size_t count);
+    void        drop_source();
+    void        release_buffers();
+    void        restore_buffers();
+    void        unqueue_processed(std::int32_t processed);
+    void        measure_latency();
+    void        update_mouth_to_ear(std::uint64_t played_index, timestamp_t latency);
+    void        skip_culled();
+    void        update_speed();
+    void        update_drift();
+    std::size_t fill_upload_buffer(float* output, std::size_t capacity, bool drain);
+    std::size_t stretch_from_ring(float* output, std::size_t capacity, bool drain);
 
     std::array<std::uint32_t, kBuffersCount> buffers{};
-    std::queue<std::uint32_t>                free_buffers{};
+    std::pmr::memory_resource*               memory{ nullptr };
+    pmr_queue<std::uint32_t>                 free_buffers;
+    pmr_queue<queued_buffer>                 queued_buffers;
+    std::size_t                              queued_samples{ 0 };
     std::uint32_t                            source{ 0 };
-    std::chrono::steady_clock::time_point    last_source_request_time{};
+    timestamp_t                              last_source_request_time{ 0 };
+    timestamp_t                              last_update_time{ 0 };
+    std::int32_t                             decode_rate{ 0 };
     std::int32_t                             sample_rate{ 0 };
 
-    vector position{};
-    vector velocity{};
-    vector direction{};
+    vector       position{};
+    vector       velocity{};
+    vector       direction{};
+    std::uint8_t staged_transform{ 0 };
 
-    float output_gain{ 1.f };
+    std::atomic<float> output_gain{ 1.f };
     float min_distance{ 0.f };
     float max_distance{ 100.f };
     float rollof_factor{ 1.f };
     float extra_gain{ 1.f };
 
-    OpusDecoder*       decoder{ nullptr };
+    OpusDecoder*                      decoder{ nullptr };
+    std::optional<resampler>          decode_resampler{};
+    std::pmr::vector<float>           resample_buffer;
+    time_stretcher                    stretcher;
+    std::optional<buffered_resampler> drift_resampler{};
+    // correction of drift resampler, 0 if compensation is disabled
+    std::atomic<double>               drift_correction{ 0.0 };
+    clock_tracker                     input_clock;
+    clock_tracker                     output_clock;
+    // level of decoded audio, measured by the gain pass
+    level_meter                       level;
     sound_output_impl* output_impl{ nullptr };
 
     sconnection_t signal_connection;
+    sconnection_t release_connection;
+    sconnection_t restore_connection;
+
+    voice_source_impl*           attached_source{ nullptr };
+    std::optional<fconnection_t> source_connection{};
 
+    // while the callback source plays, the consumer side of the stream is owned by the mixer thread
+    bool callback_mode{ false };
     bool playing{ false };
     bool has_source{ false };
     bool source_used_once{ false };
     bool is_spatial{ true };
+    bool skip_buffering{ false };
+    // decoder skipped packets while the stream was culled(producer side)
+    bool decoder_stale{ false };
+
+    std::atomic<bool> culled{ false };
+
+    // samples written to the ring buffer(producer side)
+    std::uint64_t samples_pushed{ 0 };
+    // samples that were played or dropped by the source(consumer side)
+    std::uint64_t samples_played{ 0 };
+    // samples of source buffers that were played or dropped
+    std::uint64_t output_samples_played{ 0 };
+
+    std::atomic<timestamp_t> mouth_to_ear_latency{ 0 };
+    std::atomic<timestamp_t> output_latency{ 0 };
+    std::atomic<float>       playback_speed{ 1.f };
+    std::atomic<double>      clock_drift_ppm{ 0.0 };
+
+    std::atomic<std::uint64_t> dtx_packets{ 0 };
+    std::atomic<std::uint64_t> dropped_packets{ 0 };
+    std::atomic<std::uint64_t> underruns{ 0 };
+    std::atomic<timestamp_t>   underrun_time{ 0 };
+    // start of current underrun, set by the thread that detects it
+    std::atomic<timestamp_t>   underrun_start{ kNoUnderrun };
+    // stop of playback after DTX packet or without packets is the end of speech, not underrun
+    std::atomic<bool>          last_packet_dtx{ false };
+    // time when audio of the last packet ends if it's played right after arrival
+    std::atomic<timestamp_t>   last_packet_end{ kNoPacket };
+
+    // recorder tracks are replaced by recorder and read without locks, trace has a cell per reading thread
+    std::mutex                              record_mutex;
+    rcu_cell<std::shared_ptr<record_track>> recording;
+    rcu_cell<std::shared_ptr<record_track>> trace_packets;
+    rcu_cell<std::shared_ptr<record_track>> trace_updates;
 
-    jnk0le::Ringbuffer<float, kRingBufferSize, true> ring_buffer{};
+    jnk0le::Ringbuffer<timestamp_mark, kTimestampMarksCount, true> timestamp_marks{};
+    sample_ring<kRingBufferSize>                                   ring_buffer;
 };
 }
@@ -0,0 +1,86 @@
+#include "thread_utils.hpp"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#   include <sched.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+using set_thread_description_t = HRESULT(WINAPI*)(HANDLE, PCWSTR);
+
+void set_thread_name(const std::string& name) {
+    // SetThreadDescription is available since windows 10 1607
+    const auto set_description = reinterpret_cast<set_thread_description_t>(
+        GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription"));
+    if (!set_description) return;
+
+    const int length = MultiByteToWideChar(CP_UTF8, 0, name.c_str(), -1, nullptr, 0);
+    if (length <= 0) return;
+
+    std::wstring wide_name(static_cast<std::size_t>(length), L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, name.c_str(), -1, wide_name.data(), length);
+    set_description(GetCurrentThread(), wide_name.c_str());
+}
+
+void set_thread_affinity(std::uint64_t mask) {
+    SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(mask));
+}
+
+bool set_thread_scheduling(kvoice::thread_scheduling, int) {
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+}
+#else
+void set_thread_name(const std::string& name) {
+#   ifdef __APPLE__
+    pthread_setname_np(name.c_str());
+#   else
+    // linux limits thread names to 15 characters
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#   endif
+}
+
+void set_thread_affinity([[maybe_unused]] std::uint64_t mask) {
+#   ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+        if (mask & (std::uint64_t{ 1 } << cpu))
+            CPU_SET(cpu, &cpus);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#   endif
+}
+
+bool set_thread_scheduling(kvoice::thread_scheduling scheduling, int priority) {
+    const int policy = scheduling == kvoice::thread_scheduling::fifo ? SCHED_FIFO : SCHED_RR;
+
+    sched_param param{};
+    param.sched_priority = std::clamp(priority, sched_get_priority_min(policy), sched_get_priority_max(policy));
+
+    // fails with EPERM without realtime privileges, thread keeps normal scheduling then
+    return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+}
+#endif
+}
+
+void kvoice::apply_thread_options(const thread_options& options) {
+    if (!options.name.empty())
+        set_thread_name(options.name);
+
+    if (options.affinity_mask)
+        set_thread_affinity(options.affinity_mask);
+
+    bool realtime = false;
+    if (options.scheduling != thread_scheduling::normal)
+        realtime = set_thread_scheduling(options.scheduling, options.priority);
+
+    if (options.on_start)
+        options.on_start(options.name, realtime);
+}
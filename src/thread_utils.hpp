@@ -0,0 +1,28 @@
+#pragma once
+
+#include <thread>
+#include <utility>
+
+#include "device_options.hpp"
+
+namespace kvoice {
+/**
+ * @brief applies name, affinity and scheduling to the calling thread and calls user start callback
+ * @param options thread options
+ */
+void apply_thread_options(const thread_options& options);
+
+/**
+ * @brief starts thread, that applies @p options before running @p body
+ * @param options thread options
+ * @param body thread function
+ * @return started thread
+ */
+template <typename F>
+std::thread start_thread(const thread_options& options, F&& body) {
+    return std::thread([options, body = std::forward<F>(body)]() mutable {
+        apply_thread_options(options);
+        body();
+    });
+}
+}
@@ -0,0 +1,168 @@
+#include "time_stretcher.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "simd.hpp"
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+// candidates are compared with this step first, then the best one is refined
+constexpr std::int64_t kCoarseStep = 4;
+}
+
+kvoice::time_stretcher::time_stretcher(std::uint32_t sample_rate, std::pmr::memory_resource* memory)
+    : hop(std::max<std::size_t>(sample_rate / 100, 16)),
+      frame_size(hop * 2),
+      search_range(sample_rate / 160),
+      window(frame_size, memory),
+      input(memory),
+      overlap(hop, memory),
+      ready(memory) {
+    // periodic hann window, two halves of adjacent frames sum to one
+    for (std::size_t i = 0; i < frame_size; ++i)
+        window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / frame_size));
+
+    ready.reserve(hop);
+}
+
+void kvoice::time_stretcher::push(const float* input_samples, std::size_t count) {
+    input.insert(input.end(), input_samples, input_samples + count);
+}
+
+std::size_t kvoice::time_stretcher::pull(float* output, std::size_t capacity) {
+    std::size_t produced = 0;
+    while (produced < capacity) {
+        if (ready_offset == ready.size() && !next_frame()) break;
+
+        const auto count = std::min(capacity - produced, ready.size() - ready_offset);
+        std::copy_n(ready.data() + ready_offset, count, output + produced);
+
+        ready_offset += count;
+        produced += count;
+        input_position += static_cast<double>(count) * ready_ratio;
+    }
+    return produced;
+}
+
+void kvoice::time_stretcher::reset() {
+    input_base += static_cast<std::int64_t>(input.size());
+    input.clear();
+
+    analysis = static_cast<double>(input_base);
+    input_position = analysis;
+    started = false;
+    draining = false;
+
+    ready.clear();
+    ready_offset = 0;
+}
+
+std::size_t kvoice::time_stretcher::get_buffered() const noexcept {
+    const double input_end = static_cast<double>(input_base + static_cast<std::int64_t>(input.size()));
+    return input_end > input_position ? static_cast<std::size_t>(input_end - input_position) : 0;
+}
+
+bool kvoice::time_stretcher::next_frame() {
+    const auto input_end = input_base + static_cast<std::int64_t>(input.size());
+    const auto at = [this](std::int64_t position) { return input.data() + (position - input_base); };
+
+    ready.clear();
+    ready_offset = 0;
+
+    if (draining) {
+        // continuation of the previous segment without windowing equals the original signal
+        const auto start = started ? segment + static_cast<std::int64_t>(hop) : static_cast<std::int64_t>(analysis);
+        if (start < input_end)
+            ready.assign(at(start), at(input_end));
+
+        ready_ratio = ready.empty() ? 1.0 : (static_cast<double>(input_end) - input_position) / ready.size();
+        draining = false;
+        started = false;
+        analysis = static_cast<double>(input_end);
+        discard_input(input_end);
+        return !ready.empty();
+    }
+
+    if (!started) {
+        const auto start = static_cast<std::int64_t>(analysis);
+        if (input_end < start + static_cast<std::int64_t>(frame_size)) return false;
+
+        // the first half is played as is, as if the previous frame was its natural predecessor
+        ready.assign(at(start), at(start) + hop);
+        simd::multiply(overlap.data(), at(start) + hop, window.data() + hop, hop);
+
+        ready_ratio = 1.0;
+        segment = start;
+        analysis = static_cast<double>(start + static_cast<std::int64_t>(hop));
+        started = true;
+        return true;
+    }
+
+    const auto   natural = segment + static_cast<std::int64_t>(hop);
+    std::int64_t candidate;
+    double       next_analysis;
+
+    if (speed == 1.0) {
+        if (input_end < natural + static_cast<std::int64_t>(frame_size)) return false;
+        candidate = natural;
+        next_analysis = static_cast<double>(natural + static_cast<std::int64_t>(hop));
+    } else {
+        const auto nominal = std::llround(analysis);
+        if (input_end < nominal + static_cast<std::int64_t>(search_range + frame_size)) return false;
+        candidate = find_segment(nominal);
+        next_analysis = analysis + static_cast<double>(hop) * speed;
+    }
+
+    ready.resize(hop);
+    simd::multiply_add(ready.data(), at(candidate), window.data(), overlap.data(), hop);
+    simd::multiply(overlap.data(), at(candidate) + hop, window.data() + hop, hop);
+
+    ready_ratio = (next_analysis - input_position) / hop;
+    segment = candidate;
+    analysis = next_analysis;
+
+    discard_input(std::min(segment + static_cast<std::int64_t>(hop),
+                           static_cast<std::int64_t>(analysis) - static_cast<std::int64_t>(search_range)));
+    return true;
+}
+
+std::int64_t kvoice::time_stretcher::find_segment(std::int64_t nominal) const {
+    const float* target = input.data() + (segment + static_cast<std::int64_t>(hop) - input_base);
+
+    const auto score = [this, target](std::int64_t position) {
+        const float* candidate = input.data() + (position - input_base);
+        const float  energy = simd::dot(candidate, candidate, hop);
+        return simd::dot(candidate, target, hop) / std::sqrt(energy + 1e-9f);
+    };
+
+    const auto lo = std::max(nominal - static_cast<std::int64_t>(search_range), input_base);
+    const auto hi = nominal + static_cast<std::int64_t>(search_range);
+
+    auto  best = lo;
+    float best_score = score(lo);
+    for (auto position = lo + kCoarseStep; position <= hi; position += kCoarseStep) {
+        if (const float value = score(position); value > best_score) {
+            best_score = value;
+            best = position;
+        }
+    }
+
+    const auto coarse = best;
+    for (auto position = std::max(coarse - kCoarseStep + 1, lo); position < std::min(coarse + kCoarseStep, hi + 1);
+         ++position) {
+        if (const float value = score(position); value > best_score) {
+            best_score = value;
+            best = position;
+        }
+    }
+    return best;
+}
+
+void kvoice::time_stretcher::discard_input(std::int64_t position) {
+    if (position <= input_base) return;
+
+    const auto count = std::min(static_cast<std::size_t>(position - input_base), input.size());
+    input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(count));
+    input_base += static_cast<std::int64_t>(count);
+}
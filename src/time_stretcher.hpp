@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace kvoice {
+/**
+ * @brief streaming WSOLA time-scale modification for mono float audio
+ * @details audio is cut into hann windowed frames that are overlap-added with a fixed hop, every next frame is
+ * searched around its nominal position for the best match with the natural continuation of the previous one,
+ * so tempo changes without changing pitch. At speed 1 frames are taken back to back and output equals input.
+ */
+class time_stretcher {
+public:
+    /**
+     * @brief Constructor
+     * @param sample_rate sampling rate of audio
+     * @param memory resource of frame buffers
+     */
+    explicit time_stretcher(std::uint32_t              sample_rate,
+                            std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+    /**
+     * @brief sets playback speed for next frames
+     * @param speed ratio of consumed input to produced output, more than 1 compresses audio
+     */
+    void set_speed(double speed) noexcept { this->speed = speed; }
+
+    [[nodiscard]] double get_speed() const noexcept { return speed; }
+
+    /**
+     * @brief appends input samples
+     * @param input input samples
+     * @param count count of input samples
+     */
+    void push(const float* input, std::size_t count);
+
+    /**
+     * @brief produces output samples from pushed input
+     * @param output output buffer
+     * @param capacity size of @p output
+     * @return count of samples written to @p output
+     */
+    std::size_t pull(float* output, std::size_t capacity);
+
+    /**
+     * @brief makes all pushed input available for @p pull without waiting for the next frame
+     * @details used when input has stopped, next pushed samples start a new frame sequence
+     */
+    void flush() noexcept { draining = true; }
+
+    /**
+     * @brief drops all pushed input and produced output
+     */
+    void reset();
+
+    /**
+     * @brief returns count of pushed input samples that weren't pulled yet
+     */
+    [[nodiscard]] std::size_t get_buffered() const noexcept;
+
+    /**
+     * @brief returns position in input stream that corresponds to the next pulled sample
+     */
+    [[nodiscard]] double get_input_position() const noexcept { return input_position; }
+
+private:
+    bool         next_frame();
+    std::int64_t find_segment(std::int64_t nominal) const;
+    void         discard_input(std::int64_t position);
+
+    std::size_t hop{ 0 };
+    std::size_t frame_size{ 0 };
+    std::size_t search_range{ 0 };
+
+    double speed{ 1.0 };
+    bool   draining{ false };
+    bool   started{ false };
+
+    // absolute index of input.front() in input stream
+    std::int64_t input_base{ 0 };
+    // absolute index of the last taken segment
+    std::int64_t segment{ 0 };
+    // nominal absolute position of the next segment
+    double analysis{ 0.0 };
+    double input_position{ 0.0 };
+
+    std::pmr::vector<float> window;
+    std::pmr::vector<float> input;
+    std::pmr::vector<float> overlap;
+    std::pmr::vector<float> ready;
+    std::size_t             ready_offset{ 0 };
+    double                  ready_ratio{ 1.0 };
+};
+}
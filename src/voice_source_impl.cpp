@@ -0,0 +1,111 @@
+#include "voice_source_impl.hpp"
+
+#include <opus.h>
+
+#include "kvoice.hpp"
+#include "record_track.hpp"
+#include "stream_impl.hpp"
+#include "voice_exception.hpp"
+
+kvoice::voice_source_impl::voice_source_impl(std::int32_t               decode_rate, std::int32_t sample_rate,
+                                             std::pmr::memory_resource* memory)
+    : memory(memory),
+      decode_rate(decode_rate),
+      decode_buffer(kMaxFrameSamples, memory) {
+    decoder = static_cast<OpusDecoder*>(memory->allocate(opus_decoder_get_size(1), alignof(std::max_align_t)));
+
+    if (const int opus_err = opus_decoder_init(decoder, decode_rate, 1); opus_err != OPUS_OK) {
+        memory->deallocate(decoder, opus_decoder_get_size(1), alignof(std::max_align_t));
+        throw voice_exception::create_formatted(
+            "Failed to opus decoder (errc = {})", opus_err);
+    }
+
+    // frame is resampled once for all attached streams
+    if (decode_rate != sample_rate)
+        decode_resampler.emplace(decode_rate, sample_rate, kMaxFrameSamples, memory);
+
+    frame = make_frame();
+}
+
+kvoice::voice_source_impl::~voice_source_impl() {
+    memory->deallocate(decoder, opus_decoder_get_size(1), alignof(std::max_align_t));
+}
+
+bool kvoice::voice_source_impl::push_opus_buffer(const void* data, std::size_t count) {
+    const int frame_size = decode(data, count);
+    if (frame_size < 0) return false;
+    if (frame_size == 0) return true;
+
+    frame->has_capture_time = false;
+    frame_signal.emit(std::shared_ptr<const pcm_frame>{ frame });
+    return true;
+}
+
+bool kvoice::voice_source_impl::push_opus_buffer(const void* data, std::size_t count, timestamp_t capture_time) {
+    const int frame_size = decode(data, count);
+    if (frame_size < 0) return false;
+    if (frame_size == 0) return true;
+
+    frame->capture_time = capture_time;
+    frame->has_capture_time = true;
+    frame_signal.emit(std::shared_ptr<const pcm_frame>{ frame });
+    return true;
+}
+
+void kvoice::voice_source_impl::attach(stream& s) {
+    static_cast<stream_impl&>(s).attach_source(this);
+}
+
+void kvoice::voice_source_impl::detach(stream& s) {
+    static_cast<stream_impl&>(s).detach_source(this);
+}
+
+void kvoice::voice_source_impl::set_record_track(std::shared_ptr<record_track> track) {
+    std::lock_guard lck(record_mutex);
+    recording.replace(track ? std::make_unique<std::shared_ptr<record_track>>(std::move(track)) : nullptr);
+}
+
+int kvoice::voice_source_impl::decode(const void* data, std::size_t count) {
+    if (const auto track = recording.read(); track && *track)
+        (*track)->push(data, count);
+
+    opus_packet_info info;
+    if (!inspect_opus_packet(data, count, decode_rate, info)) return -1;
+
+    // reuse frame storage unless some stream still holds the previous frame
+    if (frame.use_count() != 1)
+        frame = make_frame();
+
+    // sender is silent, there is nothing to decode, but streams still account the silence
+    frame->is_dtx = info.is_dtx;
+    if (info.is_dtx) {
+        frame->count = static_cast<int>(decode_resampler ? decode_resampler->get_max_output(info.sample_count)
+                                                         : static_cast<std::size_t>(info.sample_count));
+        return frame->count;
+    }
+
+    if (!decode_resampler) {
+        const int frame_size = opus_decode_float(decoder, reinterpret_cast<const unsigned char*>(data),
+                                                 static_cast<int>(count), frame->samples.data(),
+                                                 kMaxFrameSamples, 0);
+        if (frame_size < 0) return -1;
+
+        frame->count = frame_size;
+        return frame_size;
+    }
+
+    const int frame_size = opus_decode_float(decoder, reinterpret_cast<const unsigned char*>(data),
+                                             static_cast<int>(count), decode_buffer.data(),
+                                             kMaxFrameSamples, 0);
+    if (frame_size < 0) return -1;
+
+    frame->count = static_cast<int>(decode_resampler->process(decode_buffer.data(), frame_size,
+                                                              frame->samples.data(), frame->samples.size()));
+    return frame->count;
+}
+
+std::shared_ptr<kvoice::pcm_frame> kvoice::voice_source_impl::make_frame() const {
+    auto result = std::allocate_shared<pcm_frame>(std::pmr::polymorphic_allocator<pcm_frame>{ memory }, memory);
+    result->samples.resize(decode_resampler ? decode_resampler->get_max_output(kMaxFrameSamples) : kMaxFrameSamples);
+    return result;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "voice_source.hpp"
+#include "memory.hpp"
+#include "rcu_cell.hpp"
+#include "resampler.hpp"
+#include "ktsignal/ktsignal.hpp"
+
+struct OpusDecoder;
+
+namespace kvoice {
+class record_track;
+
+constexpr auto kMaxFrameSamples = 5760;
+
+/**
+ * @brief decoded frame at output mixing rate, that is shared between streams of one voice source
+ */
+struct pcm_frame {
+    explicit pcm_frame(std::pmr::memory_resource* memory) : samples(memory) {
+    }
+
+    std::pmr::vector<float> samples;
+    int                     count{ 0 };
+    timestamp_t             capture_time{ 0 };
+    bool                    has_capture_time{ false };
+    // sender is silent, frame holds no samples and count is the duration of the silence
+    bool                    is_dtx{ false };
+};
+
+class voice_source_impl final : public voice_source, public resource_allocated {
+public:
+    /**
+     * @brief Constructor
+     * @param decode_rate Opus decoder sampling rate
+     * @param sample_rate Output mixing rate
+     * @param memory resource of the output, that provides decoder state and frames
+     */
+    voice_source_impl(std::int32_t decode_rate, std::int32_t sample_rate, std::pmr::memory_resource* memory);
+    ~voice_source_impl() override;
+
+    bool push_opus_buffer(const void* data, std::size_t count) override;
+    bool push_opus_buffer(const void* data, std::size_t count, timestamp_t capture_time) override;
+
+    void attach(stream& s) override;
+    void detach(stream& s) override;
+
+    /**
+     * @brief sets recorder track, that receives pushed packets(nullptr to stop recording)
+     * @param track recorder track
+     */
+    void set_record_track(std::shared_ptr<record_track> track);
+
+    [[nodiscard]] std::uint32_t get_decode_rate() const noexcept { return static_cast<std::uint32_t>(decode_rate); }
+
+    ktsignal::ktsignal<void(const std::shared_ptr<const pcm_frame>&)> frame_signal;
+private:
+    int decode(const void* data, std::size_t count);
+
+    std::shared_ptr<pcm_frame> make_frame() const;
+
+    std::pmr::memory_resource* memory{ nullptr };
+    std::int32_t               decode_rate{ 0 };
+    OpusDecoder*               decoder{ nullptr };
+    std::optional<resampler>   decode_resampler{};
+    std::pmr::vector<float>    decode_buffer;
+    std::shared_ptr<pcm_frame> frame{};
+
+    // recorder track is replaced by recorder and read by producer without locks
+    std::mutex                              record_mutex;
+    rcu_cell<std::shared_ptr<record_track>> recording;
+};
+}
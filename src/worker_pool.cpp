@@ -0,0 +1,68 @@
+#include "worker_pool.hpp"
+
+#include "thread_utils.hpp"
+
+kvoice::worker_pool::worker_pool(std::uint32_t worker_count, const thread_options& options) {
+    workers.reserve(worker_count);
+    for (std::uint32_t i = 0; i < worker_count; ++i)
+        workers.push_back(start_thread(options, [this]() { work(); }));
+}
+
+kvoice::worker_pool::~worker_pool() {
+    {
+        std::lock_guard lck(mutex);
+        alive = false;
+    }
+    start_cv.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void kvoice::worker_pool::run(std::size_t count, const std::function<void(std::size_t)>& task) {
+    // waking workers costs more than a single task
+    if (workers.empty() || count < 2) {
+        for (std::size_t i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard lck(mutex);
+        this->task = &task;
+        task_count = count;
+        next_task.store(0, std::memory_order_relaxed);
+        busy_workers = workers.size();
+        ++generation;
+    }
+    start_cv.notify_all();
+
+    process_tasks();
+
+    std::unique_lock lck(mutex);
+    done_cv.wait(lck, [this]() { return busy_workers == 0; });
+    this->task = nullptr;
+}
+
+void kvoice::worker_pool::work() {
+    std::uint64_t seen_generation = 0;
+
+    std::unique_lock lck(mutex);
+    while (true) {
+        start_cv.wait(lck, [this, seen_generation]() { return !alive || generation != seen_generation; });
+        if (!alive) return;
+        seen_generation = generation;
+
+        lck.unlock();
+        process_tasks();
+        lck.lock();
+
+        if (--busy_workers == 0)
+            done_cv.notify_one();
+    }
+}
+
+void kvoice::worker_pool::process_tasks() {
+    for (auto i = next_task.fetch_add(1, std::memory_order_relaxed); i < task_count;
+         i = next_task.fetch_add(1, std::memory_order_relaxed))
+        (*task)(i);
+}
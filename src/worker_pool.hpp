@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "device_options.hpp"
+
+namespace kvoice {
+/**
+ * @brief fixed set of threads, that run indexed tasks together with the calling thread
+ * @details tasks are taken one by one from a shared counter, so uneven tasks are balanced
+ */
+class worker_pool {
+public:
+    /**
+     * @brief Constructor, starts workers
+     * @param worker_count count of threads in addition to the calling one
+     * @param options options of worker threads
+     */
+    worker_pool(std::uint32_t worker_count, const thread_options& options);
+    ~worker_pool();
+
+    worker_pool(const worker_pool&) = delete;
+    worker_pool& operator=(const worker_pool&) = delete;
+
+    /**
+     * @brief calls @p task for every index in [0, count) and waits until all calls are finished
+     * @param count count of tasks
+     * @param task task function
+     */
+    void run(std::size_t count, const std::function<void(std::size_t)>& task);
+
+private:
+    void work();
+    void process_tasks();
+
+    std::vector<std::thread> workers{};
+
+    std::mutex              mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    std::uint64_t           generation{ 0 };
+    std::size_t             busy_workers{ 0 };
+    bool                    alive{ true };
+
+    const std::function<void(std::size_t)>* task{ nullptr };
+    std::size_t                             task_count{ 0 };
+    std::atomic<std::size_t>                next_task{ 0 };
+};
+}
@@ -0,0 +1,71 @@
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "clock_tracker.hpp"
+#include "test_utils.hpp"
+
+namespace {
+constexpr std::int32_t        kSampleRate = 48000;
+constexpr std::uint64_t       kFrameSize = 480;
+constexpr kvoice::timestamp_t kStartTime = 1000000000;
+
+/**
+ * @brief feeds tracker with 10 ms packets of a sender, which clock deviates by @p ppm
+ * @param lost_at index of the first lost packet, packets aren't lost if it is 0
+ * @param lost_count count of lost packets
+ */
+void feed(kvoice::clock_tracker& tracker, double ppm, int seconds, int lost_at = 0, int lost_count = 0) {
+    std::mt19937                                rng{ 7 };
+    std::uniform_int_distribution<std::int64_t> jitter{ 0, 3000 };
+
+    std::uint64_t position = 0;
+    for (int i = 0; i < seconds * 100; ++i) {
+        // lost packets aren't observed, so the received position lags behind
+        if (lost_count && i >= lost_at && i < lost_at + lost_count) continue;
+
+        const auto send_time = static_cast<double>(i) * 10000.0 / (1.0 + ppm * 1e-6);
+        tracker.add(kStartTime + static_cast<kvoice::timestamp_t>(send_time) + jitter(rng), position);
+        position += kFrameSize;
+    }
+}
+
+void test_nominal_clock() {
+    kvoice::clock_tracker tracker{ kSampleRate, false };
+    KV_CHECK(tracker.get_deviation() == 0.0);
+    KV_CHECK(tracker.get_observed_time() == 0);
+
+    feed(tracker, 0.0, 30);
+
+    // delivery jitter is filtered by block minimums
+    KV_CHECK(std::abs(tracker.get_deviation()) < 5e-6);
+    KV_CHECK(tracker.get_observed_time() >= 25000000);
+}
+
+void test_drifting_clock() {
+    kvoice::clock_tracker fast{ kSampleRate, false };
+    feed(fast, 100.0, 30);
+    KV_CHECK(std::abs(fast.get_deviation() - 100e-6) < 5e-6);
+
+    kvoice::clock_tracker slow{ kSampleRate, false };
+    feed(slow, -250.0, 30);
+    KV_CHECK(std::abs(slow.get_deviation() + 250e-6) < 5e-6);
+}
+
+void test_lost_frames() {
+    // three lost packets in the middle of a block shift the offset by whole frames
+    kvoice::clock_tracker tracker{ kSampleRate, true };
+    feed(tracker, 100.0, 30, 1540, 3);
+
+    KV_CHECK(std::abs(tracker.get_deviation() - 100e-6) < 5e-6);
+    // compensated step doesn't exclude the block from estimation
+    KV_CHECK(tracker.get_observed_time() >= 27500000);
+}
+}
+
+int main() {
+    test_nominal_clock();
+    test_drifting_clock();
+    test_lost_frames();
+    return kvoice::test::report();
+}
@@ -0,0 +1,87 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+#include "level_meter.hpp"
+#include "test_utils.hpp"
+
+namespace {
+constexpr std::int32_t kSampleRate = 48000;
+constexpr std::size_t  kFrameSize = 480;
+// sine of 0.5 amplitude, its RMS is about -9 dBFS
+constexpr float kAmplitude = 0.5f;
+
+/**
+ * @brief feeds meter with @p frames 10 ms frames of a sine
+ */
+void feed_tone(kvoice::level_meter& meter, int frames) {
+    for (int i = 0; i < frames; ++i)
+        meter.add(kAmplitude * kAmplitude / 2.f * static_cast<float>(kFrameSize), kAmplitude, kFrameSize);
+}
+
+void feed_silence(kvoice::level_meter& meter, std::size_t count) {
+    for (std::size_t added = 0; added < count; added += kFrameSize)
+        meter.add_silence(kFrameSize);
+}
+
+bool is_close(float value, float expected) {
+    return std::abs(value - expected) <= expected * 0.01f + 1e-6f;
+}
+
+void test_speaking() {
+    kvoice::level_meter meter{ kSampleRate };
+    KV_CHECK(!meter.get_level().speaking);
+
+    feed_tone(meter, 100);
+    const auto level = meter.get_level();
+    KV_CHECK(level.speaking);
+    KV_CHECK(is_close(level.rms, kAmplitude / std::sqrt(2.f)));
+    KV_CHECK(is_close(level.peak, kAmplitude));
+
+    // speaking lasts for release time after the level drops
+    feed_silence(meter, kSampleRate / 10);
+    KV_CHECK(meter.get_level().speaking);
+    feed_silence(meter, kSampleRate);
+    KV_CHECK(!meter.get_level().speaking);
+}
+
+void test_decayed_view() {
+    // view of silence that wasn't added matches the meter that received it
+    for (const std::size_t silence : { kFrameSize * 5, kFrameSize * 30, kFrameSize * 100 }) {
+        kvoice::level_meter viewed{ kSampleRate };
+        kvoice::level_meter updated{ kSampleRate };
+        feed_tone(viewed, 100);
+        feed_tone(updated, 100);
+        feed_silence(updated, silence);
+
+        const auto expected = updated.get_level();
+        const auto level = viewed.get_level(silence);
+        KV_CHECK(is_close(level.rms, expected.rms));
+        KV_CHECK(is_close(level.peak, expected.peak));
+        KV_CHECK(level.speaking == expected.speaking);
+
+        // view doesn't change the meter
+        KV_CHECK(viewed.get_level().speaking);
+        KV_CHECK(is_close(viewed.get_level().rms, kAmplitude / std::sqrt(2.f)));
+    }
+}
+
+void test_stopped_sender() {
+    // sender without DTX stops sending, after a second it isn't speaking anymore
+    kvoice::level_meter meter{ kSampleRate };
+    feed_tone(meter, 100);
+
+    const auto level = meter.get_level(kSampleRate);
+    KV_CHECK(!level.speaking);
+    KV_CHECK(level.rms < 1e-4f);
+    KV_CHECK(level.peak < kAmplitude * 0.2f);
+}
+}
+
+int main() {
+    test_speaking();
+    test_decayed_view();
+    test_stopped_sender();
+    return kvoice::test::report();
+}
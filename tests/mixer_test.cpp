@@ -0,0 +1,223 @@
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <opus.h>
+
+#include "kvoice.hpp"
+#include "voice_exception.hpp"
+#include "test_utils.hpp"
+
+namespace {
+constexpr double      kPi = 3.14159265358979323846;
+constexpr int         kSampleRate = 48000;
+constexpr int         kFrameSize = 960;
+constexpr std::size_t kMaxPacketSize = 1500;
+// mixes are compared after the codecs have settled
+constexpr int kWarmupFrames = 10;
+
+/**
+ * @brief sender of a tone, that encodes it like a client does
+ */
+class tone_sender {
+public:
+    explicit tone_sender(double frequency)
+        : frequency(frequency) {
+        int opus_err;
+        encoder = opus_encoder_create(kSampleRate, 1, OPUS_APPLICATION_VOIP, &opus_err);
+        KV_CHECK(opus_err == OPUS_OK);
+    }
+
+    ~tone_sender() { opus_encoder_destroy(encoder); }
+
+    tone_sender(const tone_sender&) = delete;
+    tone_sender& operator=(const tone_sender&) = delete;
+
+    std::vector<std::uint8_t> next_packet() {
+        std::vector<float> frame(kFrameSize);
+        for (auto& sample : frame)
+            sample = static_cast<float>(0.5 * std::sin(2.0 * kPi * frequency * position++ / kSampleRate));
+
+        std::vector<std::uint8_t> packet(kMaxPacketSize);
+        const auto size = opus_encode_float(encoder, frame.data(), kFrameSize, packet.data(),
+                                            static_cast<opus_int32>(packet.size()));
+        KV_CHECK(size > 0);
+        packet.resize(size > 0 ? static_cast<std::size_t>(size) : 0);
+        return packet;
+    }
+
+private:
+    double        frequency{ 0.0 };
+    std::uint64_t position{ 0 };
+    OpusEncoder*  encoder{ nullptr };
+};
+
+/**
+ * @brief receiver of mixed packets of one listener, measures level of the decoded mix
+ */
+class mix_receiver {
+public:
+    mix_receiver() {
+        int opus_err;
+        decoder = opus_decoder_create(kSampleRate, 1, &opus_err);
+        KV_CHECK(opus_err == OPUS_OK);
+    }
+
+    ~mix_receiver() { opus_decoder_destroy(decoder); }
+
+    mix_receiver(const mix_receiver&) = delete;
+    mix_receiver& operator=(const mix_receiver&) = delete;
+
+    void receive(const void* data, std::size_t size, bool measured) {
+        std::vector<float> frame(kFrameSize);
+        const int          samples = opus_decode_float(decoder, static_cast<const unsigned char*>(data),
+                                                       static_cast<opus_int32>(size), frame.data(), kFrameSize, 0);
+        KV_CHECK(samples == kFrameSize);
+
+        ++packets;
+        last_packet.assign(static_cast<const std::uint8_t*>(data), static_cast<const std::uint8_t*>(data) + size);
+        if (!measured) return;
+
+        for (int i = 0; i < samples; ++i)
+            sum_squares += static_cast<double>(frame[i]) * frame[i];
+        measured_samples += samples > 0 ? samples : 0;
+    }
+
+    [[nodiscard]] double get_rms() const {
+        return measured_samples ? std::sqrt(sum_squares / static_cast<double>(measured_samples)) : 0.0;
+    }
+
+    int                       packets{ 0 };
+    std::vector<std::uint8_t> last_packet{};
+
+private:
+    OpusDecoder* decoder{ nullptr };
+    double       sum_squares{ 0.0 };
+    std::int64_t measured_samples{ 0 };
+};
+
+std::unique_ptr<kvoice::mixer> make_mixer(std::uint32_t worker_count) {
+    kvoice::mixer_options options;
+    options.sample_rate = kSampleRate;
+    options.frame_duration_ms = 20;
+    options.worker_count = worker_count;
+    return kvoice::create_mixer(options);
+}
+
+void test_mix_minus(std::uint32_t worker_count) {
+    const auto mixer = make_mixer(worker_count);
+
+    const auto speaker = mixer->add_participant();
+    const auto first_listener = mixer->add_participant();
+    const auto second_listener = mixer->add_participant();
+
+    tone_sender                                    sender{ 440.0 };
+    std::map<kvoice::participant_id, mix_receiver> receivers;
+    bool                                           shared_packets = true;
+
+    for (int frame = 0; frame < 50; ++frame) {
+        const auto packet = sender.next_packet();
+        KV_CHECK(mixer->push_opus_buffer(speaker, packet.data(), packet.size()));
+
+        mixer->mix_frame([&](kvoice::participant_id listener, const void* data, std::size_t size) {
+            receivers[listener].receive(data, size, frame >= kWarmupFrames);
+        });
+
+        // listeners, that don't speak, get the same packet
+        shared_packets = shared_packets &&
+                         receivers[first_listener].last_packet == receivers[second_listener].last_packet;
+    }
+
+    KV_CHECK(receivers[speaker].packets == 50);
+    KV_CHECK(receivers[first_listener].packets == 50);
+    KV_CHECK(receivers[second_listener].packets == 50);
+    KV_CHECK(shared_packets);
+
+    // the speaker doesn't hear itself, other listeners hear it
+    KV_CHECK(receivers[speaker].get_rms() < 0.01);
+    KV_CHECK(receivers[first_listener].get_rms() > 0.2);
+
+    const auto stats = mixer->get_stats();
+    KV_CHECK(stats.participants == 3);
+    KV_CHECK(stats.active_speakers == 1);
+    KV_CHECK(stats.decoded_packets == 50);
+    KV_CHECK(stats.dropped_packets == 0);
+    // mix of silent listeners is encoded once
+    KV_CHECK(stats.encoded_packets == 100);
+    KV_CHECK(stats.delivered_packets == 150);
+}
+
+void test_gain_and_listening() {
+    const auto mixer = make_mixer(0);
+
+    const auto speaker = mixer->add_participant();
+    const auto listener = mixer->add_participant();
+    const auto muted_listener = mixer->add_participant();
+    mixer->set_gain(speaker, 0.f);
+    mixer->set_listening(muted_listener, false);
+
+    tone_sender                                    sender{ 440.0 };
+    std::map<kvoice::participant_id, mix_receiver> receivers;
+    for (int frame = 0; frame < 30; ++frame) {
+        const auto packet = sender.next_packet();
+        mixer->push_opus_buffer(speaker, packet.data(), packet.size());
+        mixer->mix_frame([&](kvoice::participant_id id, const void* data, std::size_t size) {
+            receivers[id].receive(data, size, frame >= kWarmupFrames);
+        });
+    }
+
+    KV_CHECK(receivers[listener].get_rms() < 0.01);
+    KV_CHECK(receivers.find(muted_listener) == receivers.end());
+}
+
+void test_spatial_mix() {
+    const auto mixer = make_mixer(2);
+    mixer->set_spatial(true, kvoice::mixer_attenuation{ 1.f, 50.f, 1.f });
+
+    const auto speaker = mixer->add_participant();
+    const auto near_listener = mixer->add_participant();
+    const auto far_listener = mixer->add_participant();
+    mixer->set_position(near_listener, kvoice::vector{ 1.f, 0.f, 0.f });
+    mixer->set_position(far_listener, kvoice::vector{ 100.f, 0.f, 0.f });
+
+    tone_sender                                    sender{ 440.0 };
+    std::map<kvoice::participant_id, mix_receiver> receivers;
+    for (int frame = 0; frame < 30; ++frame) {
+        const auto packet = sender.next_packet();
+        mixer->push_opus_buffer(speaker, packet.data(), packet.size());
+        mixer->mix_frame([&](kvoice::participant_id id, const void* data, std::size_t size) {
+            receivers[id].receive(data, size, frame >= kWarmupFrames);
+        });
+    }
+
+    // speaker beyond max distance isn't mixed, every listener has its own mix
+    KV_CHECK(receivers[near_listener].get_rms() > 0.2);
+    KV_CHECK(receivers[far_listener].get_rms() < 0.01);
+    KV_CHECK(receivers[speaker].get_rms() < 0.01);
+    KV_CHECK(mixer->get_stats().encoded_packets == 90);
+}
+
+void test_invalid_options() {
+    kvoice::mixer_options options;
+    options.sample_rate = 44100;
+
+    bool thrown = false;
+    try {
+        kvoice::create_mixer(options);
+    } catch (kvoice::voice_exception&) {
+        thrown = true;
+    }
+    KV_CHECK(thrown);
+}
+}
+
+int main() {
+    test_mix_minus(0);
+    test_mix_minus(3);
+    test_gain_and_listening();
+    test_spatial_mix();
+    test_invalid_options();
+    return kvoice::test::report();
+}
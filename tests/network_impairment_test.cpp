@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "network_impairment.hpp"
+#include "test_utils.hpp"
+
+namespace {
+constexpr kvoice::timestamp_t kPacketInterval = 10000;
+
+struct delivery {
+    std::uint32_t       number;
+    kvoice::timestamp_t send_time;
+    kvoice::timestamp_t arrival_time;
+};
+
+// sends numbered packets every 10 ms and collects them until all are delivered
+std::vector<delivery> run(kvoice::network_impairment& network, std::uint32_t count) {
+    std::vector<delivery> result;
+    kvoice::timestamp_t   now = 0;
+
+    const auto receive = [&](const std::uint8_t* data, std::size_t size, kvoice::timestamp_t send_time) {
+        std::uint32_t number = 0;
+        KV_CHECK(size == sizeof(number));
+        std::memcpy(&number, data, sizeof(number));
+        result.push_back(delivery{ number, send_time, now });
+    };
+
+    for (std::uint32_t i = 0; i < count; ++i, now += kPacketInterval) {
+        network.send(reinterpret_cast<const std::uint8_t*>(&i), sizeof(i), now);
+        network.deliver(now, receive);
+    }
+    for (; network.in_flight(); now += kPacketInterval)
+        network.deliver(now, receive);
+    return result;
+}
+
+void test_clean_path() {
+    kvoice::network_impairment_options options;
+    options.base_delay = 25000;
+
+    kvoice::network_impairment network{ options };
+    const auto                 deliveries = run(network, 100);
+
+    KV_CHECK(deliveries.size() == 100);
+    for (std::uint32_t i = 0; i < deliveries.size(); ++i) {
+        KV_CHECK(deliveries[i].number == i);
+        KV_CHECK(deliveries[i].send_time == i * kPacketInterval);
+        // packet arrives at the first delivery after its delay
+        KV_CHECK(deliveries[i].arrival_time == deliveries[i].send_time + 30000);
+    }
+
+    const auto& stats = network.get_stats();
+    KV_CHECK(stats.sent == 100 && stats.delivered == 100);
+    KV_CHECK(stats.lost == 0 && stats.duplicated == 0 && stats.reordered == 0);
+}
+
+void test_determinism() {
+    kvoice::network_impairment_options options;
+    options.good_to_bad = 0.05;
+    options.bad_to_good = 0.3;
+    options.jitter = kvoice::jitter_distribution::pareto;
+    options.jitter_mean = 15000;
+    options.reorder = 0.05;
+    options.duplicate = 0.02;
+    options.seed = 42;
+
+    kvoice::network_impairment first{ options };
+    kvoice::network_impairment second{ options };
+    const auto                 first_deliveries = run(first, 1000);
+    const auto                 second_deliveries = run(second, 1000);
+
+    KV_CHECK(first_deliveries.size() == second_deliveries.size());
+    for (std::size_t i = 0; i < std::min(first_deliveries.size(), second_deliveries.size()); ++i) {
+        KV_CHECK(first_deliveries[i].number == second_deliveries[i].number);
+        KV_CHECK(first_deliveries[i].arrival_time == second_deliveries[i].arrival_time);
+    }
+    KV_CHECK(first.get_stats().lost == second.get_stats().lost);
+}
+
+void test_burst_loss() {
+    // mean loss is good_to_bad / (good_to_bad + bad_to_good), mean burst is 1 / bad_to_good
+    kvoice::network_impairment_options options;
+    options.good_to_bad = 0.01;
+    options.bad_to_good = 0.25;
+
+    constexpr std::uint32_t    kCount = 100000;
+    kvoice::network_impairment network{ options };
+    const auto                 deliveries = run(network, kCount);
+
+    const auto& stats = network.get_stats();
+    KV_CHECK(stats.lost + deliveries.size() == kCount);
+    KV_CHECK(std::abs(static_cast<double>(stats.lost) / kCount - 0.01 / 0.26) < 0.005);
+
+    std::uint64_t bursts = 0;
+    for (std::size_t i = 1; i < deliveries.size(); ++i) {
+        if (deliveries[i].number != deliveries[i - 1].number + 1) ++bursts;
+    }
+    KV_CHECK(bursts > 0);
+    if (bursts) KV_CHECK(std::abs(static_cast<double>(stats.lost) / bursts - 4.0) < 0.5);
+}
+
+void test_duplicates_and_reordering() {
+    kvoice::network_impairment_options options;
+    options.duplicate = 1.0;
+
+    kvoice::network_impairment duplicating{ options };
+    const auto                 copies = run(duplicating, 100);
+    KV_CHECK(copies.size() == 200);
+    KV_CHECK(duplicating.get_stats().duplicated == 100);
+
+    options.duplicate = 0.0;
+    options.reorder = 0.1;
+    options.reorder_delay = 40000;
+
+    kvoice::network_impairment reordering{ options };
+    const auto                 deliveries = run(reordering, 1000);
+    KV_CHECK(deliveries.size() == 1000);
+    KV_CHECK(reordering.get_stats().reordered > 50);
+
+    // held back packets are overtaken by the following ones
+    std::size_t overtaken = 0;
+    for (std::size_t i = 1; i < deliveries.size(); ++i) {
+        if (deliveries[i].number < deliveries[i - 1].number) ++overtaken;
+    }
+    KV_CHECK(overtaken > 0);
+}
+
+void test_jitter() {
+    kvoice::network_impairment_options options;
+    options.base_delay = 20000;
+    options.jitter = kvoice::jitter_distribution::uniform;
+    options.jitter_mean = 20000;
+
+    kvoice::network_impairment network{ options };
+    const auto                 deliveries = run(network, 10000);
+
+    // delivery happens every 10 ms, so the observed delay is rounded up to it
+    double total_delay = 0.0;
+    for (const auto& packet : deliveries) {
+        const auto delay = packet.arrival_time - packet.send_time;
+        KV_CHECK(delay >= 20000 && delay <= 60000);
+        total_delay += static_cast<double>(delay);
+    }
+    const double mean_delay = total_delay / static_cast<double>(deliveries.size());
+    KV_CHECK(mean_delay > 40000 && mean_delay < 50000);
+}
+}
+
+int main() {
+    test_clean_path();
+    test_determinism();
+    test_burst_loss();
+    test_duplicates_and_reordering();
+    test_jitter();
+    return kvoice::test::report();
+}
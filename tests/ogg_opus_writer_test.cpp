@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "byte_order.hpp"
+#include "ogg_opus_writer.hpp"
+#include "test_utils.hpp"
+
+namespace {
+constexpr std::uint8_t  kBeginOfStream = 0x02;
+constexpr std::uint8_t  kEndOfStream = 0x04;
+constexpr std::uint32_t kSerial = 0x12345678;
+
+struct page {
+    std::uint8_t                           flags{ 0 };
+    std::uint64_t                          granule{ 0 };
+    std::uint32_t                          sequence{ 0 };
+    std::vector<std::vector<std::uint8_t>> packets{};
+};
+
+// Ogg CRC-32, computed bit by bit to check the table of the writer
+std::uint32_t get_crc(const std::vector<std::uint8_t>& data) {
+    std::uint32_t crc = 0;
+    for (const auto byte : data) {
+        crc ^= static_cast<std::uint32_t>(byte) << 24;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = crc & 0x80000000u ? crc << 1 ^ 0x04c11db7u : crc << 1;
+    }
+    return crc;
+}
+
+// parses file into pages, packets of these tests never span pages
+std::vector<page> read_pages(const std::filesystem::path& path) {
+    std::ifstream             file(path, std::ios::binary);
+    std::vector<std::uint8_t> data{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    std::vector<page> result;
+    std::size_t       offset = 0;
+    while (offset + 27 <= data.size()) {
+        const auto* header = data.data() + offset;
+        KV_CHECK(std::memcmp(header, "OggS", 4) == 0);
+        KV_CHECK(header[4] == 0);
+        KV_CHECK(kvoice::get_le<std::uint32_t>(header + 14) == kSerial);
+
+        page current{ header[5], kvoice::get_le<std::uint64_t>(header + 6),
+                      kvoice::get_le<std::uint32_t>(header + 18) };
+
+        const std::size_t segment_count = header[26];
+        std::size_t       body_size = 0;
+        for (std::size_t i = 0; i < segment_count; ++i)
+            body_size += header[27 + i];
+
+        const auto page_size = 27 + segment_count + body_size;
+        KV_CHECK(offset + page_size <= data.size());
+        if (offset + page_size > data.size()) break;
+
+        // checksum is calculated with zero checksum field
+        std::vector<std::uint8_t> raw(header, header + page_size);
+        std::fill_n(raw.begin() + 22, 4, std::uint8_t{ 0 });
+        KV_CHECK(get_crc(raw) == kvoice::get_le<std::uint32_t>(header + 22));
+
+        const auto* body = header + 27 + segment_count;
+        std::vector<std::uint8_t> packet;
+        for (std::size_t i = 0; i < segment_count; ++i) {
+            const auto lacing = header[27 + i];
+            packet.insert(packet.end(), body, body + lacing);
+            body += lacing;
+            if (lacing < 255) {
+                current.packets.push_back(packet);
+                packet.clear();
+            }
+        }
+        KV_CHECK(packet.empty());
+
+        result.push_back(current);
+        offset += page_size;
+    }
+    KV_CHECK(offset == data.size());
+    return result;
+}
+
+kvoice::recorded_packet make_packet(const std::vector<std::uint8_t>& data, std::uint32_t gap_samples = 0) {
+    kvoice::recorded_packet result;
+    result.data = data.data();
+    result.size = data.size();
+    result.samples = 960;
+    result.gap_samples = gap_samples;
+    return result;
+}
+
+void test_headers_and_pages(const std::filesystem::path& path) {
+    const std::vector<std::uint8_t> packet(60, 0x5a);
+    const std::vector<std::uint8_t> large_packet(600, 0xa5);
+
+    std::uint64_t written;
+    {
+        kvoice::ogg_opus_writer writer{ path, kSerial, 16000, 4096, true };
+        for (int i = 0; i < 149; ++i)
+            writer.write_packet(make_packet(packet));
+        // size of 600 bytes is laced as 255, 255, 90
+        writer.write_packet(make_packet(large_packet));
+        writer.finish();
+        written = writer.get_written_bytes();
+    }
+    KV_CHECK(written == std::filesystem::file_size(path));
+
+    const auto pages = read_pages(path);
+    KV_CHECK(pages.size() == 6);
+    if (pages.size() != 6) return;
+
+    for (std::uint32_t i = 0; i < pages.size(); ++i)
+        KV_CHECK(pages[i].sequence == i);
+
+    // identification header of mono stream keeps the original rate
+    KV_CHECK(pages[0].flags == kBeginOfStream);
+    KV_CHECK(pages[0].packets.size() == 1);
+    const auto& head = pages[0].packets[0];
+    KV_CHECK(head.size() == 19 && std::memcmp(head.data(), "OpusHead", 8) == 0);
+    KV_CHECK(head[9] == 1);
+    KV_CHECK(kvoice::get_le<std::uint32_t>(head.data() + 12) == 16000);
+
+    KV_CHECK(pages[1].packets.size() == 1);
+    KV_CHECK(std::memcmp(pages[1].packets[0].data(), "OpusTags", 8) == 0);
+
+    // every page holds a second of audio
+    for (std::size_t i = 2; i < 5; ++i) {
+        KV_CHECK(pages[i].flags == 0);
+        KV_CHECK(pages[i].granule == 48000 * (i - 1));
+        KV_CHECK(pages[i].packets.size() == 50);
+    }
+    KV_CHECK(pages[4].packets.back() == large_packet);
+    KV_CHECK(pages[2].packets.front() == packet);
+
+    // end of stream is marked by the last page, even an empty one
+    KV_CHECK(pages[5].flags == kEndOfStream);
+    KV_CHECK(pages[5].granule == 144000);
+    KV_CHECK(pages[5].packets.empty());
+}
+
+void test_gaps(const std::filesystem::path& path, bool fill_gaps) {
+    const std::vector<std::uint8_t> packet(40, 0x11);
+    {
+        kvoice::ogg_opus_writer writer{ path, kSerial, 48000, 4096, fill_gaps };
+        writer.write_packet(make_packet(packet));
+        // 50 ms of dropped packets before the second one
+        writer.write_packet(make_packet(packet, 2400));
+    }
+
+    const auto pages = read_pages(path);
+    KV_CHECK(pages.size() == 3);
+    if (pages.size() != 3) return;
+
+    const auto& packets = pages[2].packets;
+    if (!fill_gaps) {
+        KV_CHECK(packets.size() == 2);
+        KV_CHECK(pages[2].granule == 1920);
+        return;
+    }
+
+    // gap is filled by empty CELT packets of 20, 20 and 10 ms
+    KV_CHECK(packets.size() == 5);
+    KV_CHECK(pages[2].granule == 1920 + 2400);
+    if (packets.size() != 5) return;
+
+    const std::vector<std::uint8_t> empty_20ms{ 31 << 3 };
+    const std::vector<std::uint8_t> empty_10ms{ 30 << 3 };
+    KV_CHECK(packets[1] == empty_20ms);
+    KV_CHECK(packets[2] == empty_20ms);
+    KV_CHECK(packets[3] == empty_10ms);
+    KV_CHECK(packets[4] == packet);
+}
+}
+
+int main() {
+    const auto path = std::filesystem::temp_directory_path() / "kvoice-test-ogg-opus-writer.opus";
+
+    test_headers_and_pages(path);
+    test_gaps(path, true);
+    test_gaps(path, false);
+
+    std::filesystem::remove(path);
+    return kvoice::test::report();
+}
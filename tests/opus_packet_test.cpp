@@ -0,0 +1,115 @@
+#include <cstdint>
+
+#include "kvoice.hpp"
+#include "test_utils.hpp"
+
+namespace {
+// TOC byte of packet: configuration, stereo flag and frame count code
+constexpr std::uint8_t make_toc(int config, bool stereo, int code) {
+    return static_cast<std::uint8_t>(config << 3 | (stereo ? 0x04 : 0) | code);
+}
+
+void test_silk_packet() {
+    // SILK narrowband 20 ms, VAD flag of the only subframe is set
+    const std::uint8_t packet[] = { make_toc(1, false, 0), 0x80, 0x11, 0x22 };
+
+    kvoice::opus_packet_info info;
+    KV_CHECK(kvoice::inspect_opus_packet(packet, sizeof(packet), 48000, info));
+    KV_CHECK(info.mode == kvoice::opus_mode::silk);
+    KV_CHECK(info.bandwidth == kvoice::opus_bandwidth::narrowband);
+    KV_CHECK(info.channels == 1);
+    KV_CHECK(info.frame_count == 1);
+    KV_CHECK(info.samples_per_frame == 960);
+    KV_CHECK(info.sample_count == 960);
+    KV_CHECK(info.voice_activity);
+    KV_CHECK(!info.is_dtx);
+    KV_CHECK(!info.has_fec);
+
+    // sample counts follow the requested rate
+    KV_CHECK(kvoice::inspect_opus_packet(packet, sizeof(packet), 16000, info));
+    KV_CHECK(info.sample_count == 320);
+}
+
+void test_silk_flags() {
+    // LBRR flag follows VAD flags of all 20 ms subframes
+    const std::uint8_t fec_packet[] = { make_toc(1, false, 0), 0xc0, 0x11 };
+
+    kvoice::opus_packet_info info;
+    KV_CHECK(kvoice::inspect_opus_packet(fec_packet, sizeof(fec_packet), 48000, info));
+    KV_CHECK(info.voice_activity);
+    KV_CHECK(info.has_fec);
+
+    // 60 ms frame has three subframes, VAD flags are clear, LBRR flag is the fourth bit
+    const std::uint8_t long_packet[] = { make_toc(3, false, 0), 0x10, 0x11 };
+    KV_CHECK(kvoice::inspect_opus_packet(long_packet, sizeof(long_packet), 48000, info));
+    KV_CHECK(info.sample_count == 2880);
+    KV_CHECK(!info.voice_activity);
+    KV_CHECK(info.has_fec);
+    KV_CHECK(!info.is_dtx);
+}
+
+void test_dtx_packet() {
+    const std::uint8_t empty_packet[] = { make_toc(1, false, 0) };
+    const std::uint8_t one_byte_packet[] = { make_toc(1, false, 0), 0x00 };
+
+    kvoice::opus_packet_info info;
+    KV_CHECK(kvoice::inspect_opus_packet(empty_packet, sizeof(empty_packet), 48000, info));
+    KV_CHECK(info.is_dtx);
+    KV_CHECK(!info.voice_activity);
+    KV_CHECK(info.sample_count == 960);
+
+    KV_CHECK(kvoice::inspect_opus_packet(one_byte_packet, sizeof(one_byte_packet), 48000, info));
+    KV_CHECK(info.is_dtx);
+    KV_CHECK(!info.has_fec);
+}
+
+void test_other_modes() {
+    const std::uint8_t celt_packet[] = { make_toc(31, true, 0), 0x01, 0x02, 0x03, 0x04 };
+
+    kvoice::opus_packet_info info;
+    KV_CHECK(kvoice::inspect_opus_packet(celt_packet, sizeof(celt_packet), 48000, info));
+    KV_CHECK(info.mode == kvoice::opus_mode::celt);
+    KV_CHECK(info.bandwidth == kvoice::opus_bandwidth::fullband);
+    KV_CHECK(info.channels == 2);
+    KV_CHECK(info.voice_activity);
+    KV_CHECK(!info.has_fec);
+
+    const std::uint8_t hybrid_packet[] = { make_toc(12, false, 0), 0x80, 0x01 };
+    KV_CHECK(kvoice::inspect_opus_packet(hybrid_packet, sizeof(hybrid_packet), 48000, info));
+    KV_CHECK(info.mode == kvoice::opus_mode::hybrid);
+    KV_CHECK(info.bandwidth == kvoice::opus_bandwidth::superwideband);
+    KV_CHECK(info.sample_count == 480);
+}
+
+void test_multiple_frames() {
+    // code 1 packet holds two frames of equal size
+    const std::uint8_t packet[] = { make_toc(1, false, 1), 0x00, 0x01, 0x80, 0x02 };
+
+    kvoice::opus_packet_info info;
+    KV_CHECK(kvoice::inspect_opus_packet(packet, sizeof(packet), 48000, info));
+    KV_CHECK(info.frame_count == 2);
+    KV_CHECK(info.sample_count == 1920);
+    // voice in any frame is reported
+    KV_CHECK(info.voice_activity);
+}
+
+void test_invalid_packet() {
+    kvoice::opus_packet_info info;
+    KV_CHECK(!kvoice::inspect_opus_packet(nullptr, 0, 48000, info));
+
+    // code 1 packet can't split odd payload into two equal frames
+    const std::uint8_t packet[] = { make_toc(1, false, 1), 0x01, 0x02, 0x03 };
+    KV_CHECK(!kvoice::inspect_opus_packet(packet, 0, 48000, info));
+    KV_CHECK(!kvoice::inspect_opus_packet(packet, sizeof(packet), 48000, info));
+}
+}
+
+int main() {
+    test_silk_packet();
+    test_silk_flags();
+    test_dtx_packet();
+    test_other_modes();
+    test_multiple_frames();
+    test_invalid_packet();
+    return kvoice::test::report();
+}
@@ -0,0 +1,152 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory_resource>
+#include <thread>
+
+#include "packet_ring.hpp"
+#include "test_utils.hpp"
+
+namespace {
+// packet content is derived from its number, so readers detect torn copies
+void fill_packet(std::uint8_t* data, std::uint64_t number, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i)
+        data[i] = static_cast<std::uint8_t>(number * 31 + i);
+}
+
+bool check_packet(const std::uint8_t* data, std::uint64_t number, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i)
+        if (data[i] != static_cast<std::uint8_t>(number * 31 + i)) return false;
+    return true;
+}
+
+std::size_t get_size(std::uint64_t number) {
+    return 1 + number * 7 % kvoice::kMaxCapturedPacketSize;
+}
+
+void publish(kvoice::packet_ring& ring, std::uint64_t number) {
+    fill_packet(ring.begin_write(), number, get_size(number));
+    ring.commit(get_size(number), static_cast<kvoice::timestamp_t>(number * 10000));
+}
+
+void test_read() {
+    kvoice::packet_ring ring{ std::pmr::get_default_resource() };
+    publish(ring, 0);
+
+    // subscriber receives only packets published after its creation
+    kvoice::packet_subscription_impl subscription{ &ring };
+    std::array<std::uint8_t, kvoice::kMaxCapturedPacketSize> buffer{};
+    kvoice::timestamp_t                                      capture_time = 0;
+    KV_CHECK(subscription.read(buffer.data(), capture_time) == 0);
+
+    publish(ring, 1);
+    publish(ring, 2);
+    for (std::uint64_t number = 1; number <= 2; ++number) {
+        KV_CHECK(subscription.read(buffer.data(), capture_time) == get_size(number));
+        KV_CHECK(check_packet(buffer.data(), number, get_size(number)));
+        KV_CHECK(capture_time == static_cast<kvoice::timestamp_t>(number * 10000));
+    }
+    KV_CHECK(subscription.read(buffer.data(), capture_time) == 0);
+    KV_CHECK(subscription.get_overflows() == 0);
+}
+
+void test_abandoned_write() {
+    kvoice::packet_ring ring{ std::pmr::get_default_resource() };
+    for (std::uint64_t number = 0; number < kvoice::packet_ring::kSlotCount; ++number)
+        publish(ring, number);
+
+    // packet, that failed to encode, isn't committed, the oldest packet stays readable
+    std::memset(ring.begin_write(), 0xff, kvoice::kMaxCapturedPacketSize);
+
+    std::array<std::uint8_t, kvoice::kMaxCapturedPacketSize> buffer{};
+    std::size_t                                              size = 0;
+    kvoice::timestamp_t                                      capture_time = 0;
+    KV_CHECK(ring.read(0, buffer.data(), size, capture_time));
+    KV_CHECK(size == get_size(0) && check_packet(buffer.data(), 0, size));
+    KV_CHECK(ring.get_written() == kvoice::packet_ring::kSlotCount);
+
+    // the next commit replaces it
+    publish(ring, kvoice::packet_ring::kSlotCount);
+    KV_CHECK(!ring.read(0, buffer.data(), size, capture_time));
+    KV_CHECK(ring.read(kvoice::packet_ring::kSlotCount, buffer.data(), size, capture_time));
+    KV_CHECK(check_packet(buffer.data(), kvoice::packet_ring::kSlotCount, size));
+}
+
+void test_overflow() {
+    kvoice::packet_ring              ring{ std::pmr::get_default_resource() };
+    kvoice::packet_subscription_impl subscription{ &ring };
+
+    constexpr std::uint64_t kPublished = kvoice::packet_ring::kSlotCount + 10;
+    for (std::uint64_t number = 0; number < kPublished; ++number)
+        publish(ring, number);
+
+    // subscriber, that fell behind, skips the overwritten packets and continues with the oldest kept one
+    std::array<std::uint8_t, kvoice::kMaxCapturedPacketSize> buffer{};
+    kvoice::timestamp_t                                      capture_time = 0;
+    KV_CHECK(subscription.read(buffer.data(), capture_time) == get_size(10));
+    KV_CHECK(check_packet(buffer.data(), 10, get_size(10)));
+    KV_CHECK(subscription.get_overflows() == 10);
+}
+
+void test_concurrent_readers() {
+    constexpr std::uint64_t kPublished = 200000;
+
+    kvoice::packet_ring ring{ std::pmr::get_default_resource() };
+    std::atomic<int>    ready{ 0 };
+    std::atomic<bool>   corrupted{ false };
+
+    const auto reader = [&](std::uint64_t& received, std::uint64_t& overflows) {
+        kvoice::packet_subscription_impl subscription{ &ring };
+        ready.fetch_add(1);
+
+        std::array<std::uint8_t, kvoice::kMaxCapturedPacketSize> buffer{};
+        kvoice::timestamp_t                                      capture_time = 0;
+        std::int64_t                                             last = -1;
+        while (last + 1 < static_cast<std::int64_t>(kPublished)) {
+            const auto size = subscription.read(buffer.data(), capture_time);
+            if (!size) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // packets come in order and never torn
+            const auto number = static_cast<std::int64_t>(capture_time / 10000);
+            if (number <= last || size != get_size(number) || !check_packet(buffer.data(), number, size))
+                corrupted = true;
+            last = number;
+            ++received;
+        }
+        overflows = subscription.get_overflows();
+    };
+
+    std::uint64_t first_received = 0, first_overflows = 0;
+    std::uint64_t second_received = 0, second_overflows = 0;
+    std::thread   first{ reader, std::ref(first_received), std::ref(first_overflows) };
+    std::thread   second{ reader, std::ref(second_received), std::ref(second_overflows) };
+
+    while (ready.load() < 2)
+        std::this_thread::yield();
+    for (std::uint64_t number = 0; number < kPublished; ++number) {
+        // every 100th packet fails to encode and is abandoned before the real one
+        if (number % 100 == 0) std::memset(ring.begin_write(), 0xff, kvoice::kMaxCapturedPacketSize);
+        publish(ring, number);
+    }
+
+    first.join();
+    second.join();
+
+    KV_CHECK(!corrupted);
+    KV_CHECK(first_received + first_overflows == kPublished);
+    KV_CHECK(second_received + second_overflows == kPublished);
+}
+}
+
+int main() {
+    test_read();
+    test_abandoned_write();
+    test_overflow();
+    test_concurrent_readers();
+    return kvoice::test::report();
+}
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "resampler.hpp"
+#include "test_utils.hpp"
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+// output samples affected by the start of the filter
+constexpr std::size_t kWarmup = 64;
+
+std::vector<float> make_tone(double frequency, std::uint32_t sample_rate, std::size_t count, std::size_t offset = 0) {
+    std::vector<float> result(count);
+    for (std::size_t i = 0; i < count; ++i)
+        result[i] = static_cast<float>(0.5 * std::sin(2.0 * kPi * frequency * (offset + i) / sample_rate));
+    return result;
+}
+
+// resamples input by chunks of @p chunk samples
+std::vector<float> resample(kvoice::resampler& resampler, const std::vector<float>& input, std::size_t chunk) {
+    std::vector<float> output;
+    std::vector<float> buffer(resampler.get_max_output(chunk));
+    for (std::size_t offset = 0; offset < input.size(); offset += chunk) {
+        const auto count = std::min(chunk, input.size() - offset);
+        const auto produced = resampler.process(input.data() + offset, count, buffer.data(), buffer.size());
+        KV_CHECK(produced <= resampler.get_max_output(count));
+        output.insert(output.end(), buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(produced));
+    }
+    return output;
+}
+
+double get_max_error(const std::vector<float>& output, double frequency, std::uint32_t sample_rate) {
+    double error = 0.0;
+    const auto expected = make_tone(frequency, sample_rate, output.size());
+    for (std::size_t i = kWarmup; i < output.size(); ++i)
+        error = std::max(error, std::abs(static_cast<double>(output[i]) - expected[i]));
+    return error;
+}
+
+void test_upsampling() {
+    kvoice::resampler resampler{ 16000, 48000, 160 };
+    const auto        output = resample(resampler, make_tone(440.0, 16000, 16000), 160);
+
+    // a second of input gives a second of output, except samples held back by the filter
+    KV_CHECK(output.size() <= 48000 && output.size() >= 48000 - 64);
+    KV_CHECK(get_max_error(output, 440.0, 48000) < 1e-3);
+}
+
+void test_downsampling() {
+    kvoice::resampler resampler{ 48000, 16000, 480 };
+    const auto        output = resample(resampler, make_tone(1000.0, 48000, 48000), 480);
+
+    KV_CHECK(output.size() <= 16000 && output.size() >= 16000 - 32);
+    KV_CHECK(get_max_error(output, 1000.0, 16000) < 1e-3);
+}
+
+void test_chunk_independence() {
+    const auto input = make_tone(700.0, 44100, 8820);
+
+    kvoice::resampler whole{ 44100, 48000, input.size() };
+    kvoice::resampler chunked{ 44100, 48000, 441 };
+    const auto        expected = resample(whole, input, input.size());
+    const auto        output = resample(chunked, input, 441);
+
+    // filter history makes the result independent of the split
+    KV_CHECK(output.size() == expected.size());
+    for (std::size_t i = 0; i < std::min(output.size(), expected.size()); ++i)
+        KV_CHECK(std::abs(output[i] - expected[i]) < 1e-6f);
+}
+
+void test_correction() {
+    kvoice::resampler resampler{ 48000, 48000, 480 };
+    resampler.set_correction(1.001);
+    const auto output = resample(resampler, make_tone(440.0, 48000, 480000), 480);
+
+    // input is consumed 0.1% faster, so there is less output
+    KV_CHECK(output.size() <= 479521 && output.size() >= 479521 - 32);
+}
+
+void test_reset() {
+    const auto input = make_tone(440.0, 24000, 2400);
+
+    kvoice::resampler resampler{ 24000, 48000, 240 };
+    const auto        first = resample(resampler, input, 240);
+    resampler.reset();
+    const auto second = resample(resampler, input, 240);
+
+    KV_CHECK(first == second);
+}
+
+void test_bounded_input() {
+    kvoice::resampler resampler{ 48000, 48000, 480 };
+
+    // input over the history capacity is dropped instead of growing the history
+    const auto         input = make_tone(440.0, 48000, 4800);
+    std::vector<float> output(resampler.get_max_output(input.size()));
+    const auto         produced = resampler.process(input.data(), input.size(), output.data(), output.size());
+    KV_CHECK(produced <= resampler.get_max_output(480));
+
+    // output capacity limits a call, the rest of accepted input is produced by the next call
+    resampler.reset();
+    std::size_t total = resampler.process(input.data(), 480, output.data(), 100);
+    KV_CHECK(total == 100);
+    total += resampler.process(input.data() + 480, 0, output.data(), output.size());
+    KV_CHECK(total <= 480 && total >= 480 - 32);
+}
+
+void test_buffered_pull(double correction) {
+    kvoice::buffered_resampler resampler{ 48000, 48000, 4096 };
+    resampler.set_correction(correction);
+
+    std::size_t input_position = 0;
+    const auto  source = [&input_position](float* buffer, std::size_t capacity) {
+        const auto tone = make_tone(440.0, 48000, capacity, input_position);
+        std::copy(tone.begin(), tone.end(), buffer);
+        input_position += capacity;
+        return capacity;
+    };
+
+    // small requests are filled too, although the resampler holds back a filter length
+    std::vector<float> output;
+    std::vector<float> buffer(4096);
+    for (int i = 0; i < 200; ++i) {
+        for (const std::size_t count : { 1, 7, 33, 480, 1024, 4096 }) {
+            KV_CHECK(resampler.pull(buffer.data(), count, source) == count);
+            output.insert(output.end(), buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(count));
+        }
+    }
+
+    // output is continuous tone, that follows the corrected ratio
+    double error = 0.0;
+    for (std::size_t i = kWarmup; i < output.size(); ++i) {
+        const double expected = 0.5 * std::sin(2.0 * kPi * 440.0 * correction * i / 48000);
+        error = std::max(error, std::abs(output[i] - expected));
+    }
+    KV_CHECK(error < 1e-3);
+}
+
+void test_buffered_end_of_input() {
+    kvoice::buffered_resampler resampler{ 16000, 48000, 1024 };
+
+    std::size_t left = 1600;
+    const auto  source = [&left](float* buffer, std::size_t capacity) {
+        const auto count = std::min(capacity, left);
+        std::fill_n(buffer, count, 0.25f);
+        left -= count;
+        return count;
+    };
+
+    // output stops only when the source runs out of input
+    std::vector<float> buffer(512);
+    std::size_t        total = 0;
+    for (;;) {
+        const auto count = resampler.pull(buffer.data(), buffer.size(), source);
+        total += count;
+        if (count < buffer.size()) break;
+    }
+    KV_CHECK(left == 0);
+    KV_CHECK(total <= 4800 && total >= 4800 - 64);
+    KV_CHECK(resampler.pull(buffer.data(), buffer.size(), source) == 0);
+}
+}
+
+int main() {
+    test_upsampling();
+    test_downsampling();
+    test_chunk_independence();
+    test_correction();
+    test_reset();
+    test_bounded_input();
+    test_buffered_pull(1.0007);
+    test_buffered_pull(0.9993);
+    test_buffered_end_of_input();
+    return kvoice::test::report();
+}
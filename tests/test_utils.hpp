@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace kvoice::test {
+/**
+ * @brief returns count of failed checks of the test executable
+ */
+inline int& get_failures() noexcept {
+    static int failures = 0;
+    return failures;
+}
+
+/**
+ * @brief reports failed check, test keeps running, so every failure is reported
+ */
+inline void check(bool condition, const char* expression, const char* file, int line) noexcept {
+    if (condition) return;
+
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    ++get_failures();
+}
+
+/**
+ * @brief returns exit code of the test executable
+ */
+inline int report() noexcept {
+    if (get_failures()) std::fprintf(stderr, "%d check(s) failed\n", get_failures());
+    return get_failures() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+}
+
+// unlike assert, checks are kept in release builds
+#define KV_CHECK(condition) kvoice::test::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "time_stretcher.hpp"
+#include "test_utils.hpp"
+
+namespace {
+constexpr double        kPi = 3.14159265358979323846;
+constexpr std::uint32_t kSampleRate = 48000;
+
+std::vector<float> make_tone(double frequency, std::size_t count) {
+    std::vector<float> result(count);
+    for (std::size_t i = 0; i < count; ++i)
+        result[i] = static_cast<float>(0.5 * std::sin(2.0 * kPi * frequency * i / kSampleRate));
+    return result;
+}
+
+// pushes input by 10 ms chunks and pulls everything, that is ready
+std::vector<float> stretch(kvoice::time_stretcher& stretcher, const std::vector<float>& input) {
+    std::vector<float> output;
+    std::vector<float> buffer(kSampleRate / 100);
+
+    const auto pull_all = [&]() {
+        while (const auto count = stretcher.pull(buffer.data(), buffer.size()))
+            output.insert(output.end(), buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(count));
+    };
+
+    for (std::size_t offset = 0; offset < input.size(); offset += buffer.size()) {
+        stretcher.push(input.data() + offset, std::min(buffer.size(), input.size() - offset));
+        pull_all();
+    }
+    stretcher.flush();
+    pull_all();
+    return output;
+}
+
+// frequency measured by rising zero crossings in the middle of the signal
+double get_frequency(const std::vector<float>& signal) {
+    const auto begin = signal.size() / 4;
+    const auto end = signal.size() * 3 / 4;
+
+    std::size_t crossings = 0;
+    for (auto i = begin + 1; i < end; ++i) {
+        if (signal[i - 1] < 0.f && signal[i] >= 0.f) ++crossings;
+    }
+    return static_cast<double>(crossings) * kSampleRate / static_cast<double>(end - begin);
+}
+
+void test_unity_speed() {
+    kvoice::time_stretcher stretcher{ kSampleRate };
+    const auto             input = make_tone(440.0, kSampleRate);
+    const auto             output = stretch(stretcher, input);
+
+    // halves of adjacent windows sum to one, so the signal is restored
+    KV_CHECK(output.size() == input.size());
+    for (std::size_t i = 0; i < std::min(output.size(), input.size()); ++i)
+        KV_CHECK(std::abs(output[i] - input[i]) < 1e-5f);
+
+    KV_CHECK(std::abs(stretcher.get_input_position() - static_cast<double>(input.size())) < 1e-6);
+    KV_CHECK(stretcher.get_buffered() == 0);
+}
+
+void test_speed(double speed) {
+    kvoice::time_stretcher stretcher{ kSampleRate };
+    stretcher.set_speed(speed);
+
+    const auto input = make_tone(440.0, kSampleRate * 2);
+    const auto output = stretch(stretcher, input);
+
+    // duration follows the speed, pitch doesn't
+    const double expected = static_cast<double>(input.size()) / speed;
+    KV_CHECK(std::abs(static_cast<double>(output.size()) - expected) < expected * 0.02);
+    KV_CHECK(std::abs(get_frequency(output) - 440.0) < 440.0 * 0.03);
+
+    // all input is consumed
+    KV_CHECK(std::abs(stretcher.get_input_position() - static_cast<double>(input.size())) < 1.0);
+}
+
+void test_buffered() {
+    kvoice::time_stretcher stretcher{ kSampleRate };
+    const auto             input = make_tone(440.0, 4800);
+
+    stretcher.push(input.data(), input.size());
+    KV_CHECK(stretcher.get_buffered() == input.size());
+
+    std::vector<float> output(960);
+    const auto         count = stretcher.pull(output.data(), output.size());
+    KV_CHECK(count == output.size());
+    KV_CHECK(stretcher.get_buffered() == input.size() - count);
+
+    // reset drops everything, the input position keeps counting from the end of pushed input
+    stretcher.reset();
+    KV_CHECK(stretcher.get_buffered() == 0);
+    KV_CHECK(stretcher.pull(output.data(), output.size()) == 0);
+    KV_CHECK(stretcher.get_input_position() == static_cast<double>(input.size()));
+}
+}
+
+int main() {
+    test_unity_speed();
+    test_speed(1.25);
+    test_speed(0.8);
+    test_buffered();
+    return kvoice::test::report();
+}
@@ -0,0 +1,406 @@
+// headless benchmark of the receive path under simulated network impairments
+// usage: kvoice-netbench [--profile clean|wifi|lte|congested] [--streams <count>] [--duration <s>] [--trace <file>]
+//                        [--delay <ms>] [--loss <good_to_bad>:<bad_to_good>:<loss_good>:<loss_bad>]
+//                        [--jitter none|uniform|normal|pareto[:<mean_ms>[:<stddev_ms>]]] [--reorder <p>[:<ms>]]
+//                        [--duplicate <p>] [--mode queued|callback] [--format float|int16]
+//                        [--latency ultra_low|balanced|robust] [--buffering <ms>] [--update <ms>] [--seed <n>]
+
+#include "kvoice/kvoice.hpp"
+#include "network_impairment.hpp"
+
+#include <opus.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr std::uint32_t      kMixingRate = 48000;
+// frames mixed by one render call, 5 ms
+constexpr std::uint32_t      kRenderFrames = 240;
+constexpr kvoice::timestamp_t kRenderTime = kvoice::samples_to_timestamp(kRenderFrames, kMixingRate);
+// synthetic capture is encoded in 20 ms frames
+constexpr int                kFrameSize = 960;
+constexpr kvoice::timestamp_t kFrameTime = 20000;
+// virtual clock starts here, so no timestamp is 0
+constexpr kvoice::timestamp_t kStartTime = 1000000;
+// audio rendered after the last packet, so buffered packets are played out
+constexpr kvoice::timestamp_t kTailTime = 1000000;
+
+constexpr double kPi = 3.14159265358979323846;
+
+std::atomic<kvoice::timestamp_t> virtual_time{ kStartTime };
+
+kvoice::timestamp_t get_virtual_time() noexcept {
+    return virtual_time.load(std::memory_order_relaxed);
+}
+
+struct source_packet {
+    // send time relative to the start of capture
+    kvoice::timestamp_t       offset;
+    std::vector<std::uint8_t> data;
+};
+
+struct bench_options {
+    kvoice::network_impairment_options network{};
+    kvoice::stream_options             stream{};
+    std::string                        trace_path{};
+    std::uint32_t                      streams{ 1 };
+    double                             duration{ 30.0 };
+    kvoice::latency_profile            latency{ kvoice::latency_profile::balanced };
+    // 0 leaves buffering to the latency profile
+    std::uint32_t                      buffering_ms{ 0 };
+    kvoice::timestamp_t                update_period{ 20000 };
+};
+
+kvoice::timestamp_t ms(double value) {
+    return static_cast<kvoice::timestamp_t>(value * 1000.0);
+}
+
+/**
+ * @brief applies named network conditions
+ */
+bool apply_profile(const std::string& name, kvoice::network_impairment_options& network) {
+    network = kvoice::network_impairment_options{};
+    if (name == "clean") return true;
+
+    if (name == "wifi") {
+        network.base_delay = ms(10);
+        network.jitter = kvoice::jitter_distribution::normal;
+        network.jitter_mean = ms(15);
+        network.jitter_stddev = ms(10);
+        network.good_to_bad = 0.01;
+        network.bad_to_good = 0.5;
+        network.loss_bad = 0.5;
+        return true;
+    }
+    if (name == "lte") {
+        network.base_delay = ms(40);
+        network.jitter = kvoice::jitter_distribution::pareto;
+        network.jitter_mean = ms(20);
+        network.good_to_bad = 0.02;
+        network.bad_to_good = 0.3;
+        network.loss_good = 0.001;
+        network.loss_bad = 0.7;
+        network.reorder = 0.01;
+        network.reorder_delay = ms(30);
+        return true;
+    }
+    if (name == "congested") {
+        network.base_delay = ms(60);
+        network.jitter = kvoice::jitter_distribution::pareto;
+        network.jitter_mean = ms(50);
+        network.good_to_bad = 0.05;
+        network.bad_to_good = 0.25;
+        network.loss_good = 0.01;
+        network.loss_bad = 0.8;
+        network.reorder = 0.02;
+        network.reorder_delay = ms(60);
+        network.duplicate = 0.01;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief splits "a:b:c" into numbers, missing values are kept
+ */
+void parse_values(const char* arg, double* values, std::size_t count) {
+    for (std::size_t i = 0; i < count && *arg; ++i) {
+        char* end = nullptr;
+        values[i] = std::strtod(arg, &end);
+        if (*end != ':') break;
+        arg = end + 1;
+    }
+}
+
+bool parse_args(int argc, char** argv, bench_options& options) {
+    // profile is applied first, so other flags override it
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--profile") == 0 && !apply_profile(argv[i + 1], options.network)) {
+            std::fprintf(stderr, "unknown profile %s\n", argv[i + 1]);
+            return false;
+        }
+    }
+
+    auto& network = options.network;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string name = argv[i];
+        const char*       value = argv[i + 1];
+
+        if (name == "--profile") {
+            continue;
+        } else if (name == "--streams") {
+            options.streams = std::max(1, std::atoi(value));
+        } else if (name == "--duration") {
+            options.duration = std::atof(value);
+        } else if (name == "--trace") {
+            options.trace_path = value;
+        } else if (name == "--delay") {
+            network.base_delay = ms(std::atof(value));
+        } else if (name == "--loss") {
+            double values[]{ network.good_to_bad, network.bad_to_good, network.loss_good, network.loss_bad };
+            parse_values(value, values, std::size(values));
+            network.good_to_bad = values[0];
+            network.bad_to_good = values[1];
+            network.loss_good = values[2];
+            network.loss_bad = values[3];
+        } else if (name == "--jitter") {
+            const std::string type{ value, std::strcspn(value, ":") };
+            if (type == "none") network.jitter = kvoice::jitter_distribution::none;
+            else if (type == "uniform") network.jitter = kvoice::jitter_distribution::uniform;
+            else if (type == "normal") network.jitter = kvoice::jitter_distribution::normal;
+            else if (type == "pareto") network.jitter = kvoice::jitter_distribution::pareto;
+            else {
+                std::fprintf(stderr, "unknown jitter distribution %s\n", type.c_str());
+                return false;
+            }
+
+            double values[]{ network.jitter_mean / 1000.0, network.jitter_stddev / 1000.0 };
+            if (value[type.size()] == ':')
+                parse_values(value + type.size() + 1, values, std::size(values));
+            network.jitter_mean = ms(values[0]);
+            network.jitter_stddev = ms(values[1]);
+        } else if (name == "--reorder") {
+            double values[]{ network.reorder, network.reorder_delay / 1000.0 };
+            parse_values(value, values, std::size(values));
+            network.reorder = values[0];
+            network.reorder_delay = ms(values[1]);
+        } else if (name == "--duplicate") {
+            network.duplicate = std::atof(value);
+        } else if (name == "--mode") {
+            options.stream.mode = std::strcmp(value, "callback") == 0 ? kvoice::playback_mode::callback
+                                                                      : kvoice::playback_mode::queued;
+        } else if (name == "--format") {
+            options.stream.format = std::strcmp(value, "int16") == 0 ? kvoice::sample_format::int16
+                                                                     : kvoice::sample_format::float32;
+        } else if (name == "--latency") {
+            if (std::strcmp(value, "ultra_low") == 0) options.latency = kvoice::latency_profile::ultra_low;
+            else if (std::strcmp(value, "balanced") == 0) options.latency = kvoice::latency_profile::balanced;
+            else if (std::strcmp(value, "robust") == 0) options.latency = kvoice::latency_profile::robust;
+            else {
+                std::fprintf(stderr, "unknown latency profile %s\n", value);
+                return false;
+            }
+        } else if (name == "--buffering") {
+            options.buffering_ms = static_cast<std::uint32_t>(std::atoi(value));
+        } else if (name == "--update") {
+            options.update_period = ms(std::atof(value));
+        } else if (name == "--seed") {
+            network.seed = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief encodes speech-like signal: voiced harmonics with syllable envelope and pauses, DTX is enabled
+ */
+std::vector<source_packet> encode_synthetic(double duration) {
+    int         error = 0;
+    OpusEncoder* encoder = opus_encoder_create(kMixingRate, 1, OPUS_APPLICATION_VOIP, &error);
+    if (error != OPUS_OK) return {};
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(24000));
+    opus_encoder_ctl(encoder, OPUS_SET_DTX(1));
+
+    std::vector<source_packet> packets;
+    std::vector<float>         pcm(kFrameSize);
+    std::vector<std::uint8_t>  data(1500);
+
+    const auto frames = static_cast<std::size_t>(duration * 1000000.0 / kFrameTime);
+    double     phase = 0.0;
+    for (std::size_t frame = 0; frame < frames; ++frame) {
+        for (int i = 0; i < kFrameSize; ++i) {
+            const double t = static_cast<double>(frame * kFrameSize + i) / kMixingRate;
+            // 4 s of talk followed by 1 s of silence
+            const bool   talking = std::fmod(t, 5.0) < 4.0;
+            const double envelope = talking ? 0.5 - 0.5 * std::cos(2.0 * kPi * 4.0 * t) : 0.0;
+            const double pitch = 140.0 + 40.0 * std::sin(2.0 * kPi * 0.7 * t);
+
+            phase += 2.0 * kPi * pitch / kMixingRate;
+            double sample = 0.0;
+            for (int harmonic = 1; harmonic <= 8; ++harmonic)
+                sample += std::sin(phase * harmonic) / harmonic;
+            pcm[i] = static_cast<float>(0.2 * envelope * sample);
+        }
+
+        const int size = opus_encode_float(encoder, pcm.data(), kFrameSize, data.data(),
+                                           static_cast<opus_int32>(data.size()));
+        if (size <= 0) continue;
+        packets.push_back({ static_cast<kvoice::timestamp_t>(frame) * kFrameTime,
+                            std::vector<std::uint8_t>(data.begin(), data.begin() + size) });
+    }
+
+    opus_encoder_destroy(encoder);
+    return packets;
+}
+
+/**
+ * @brief takes packets of recorded trace, capture times are used as send times when they are known
+ */
+std::vector<source_packet> load_trace(const std::string& path) {
+    const auto trace = kvoice::open_packet_trace(path);
+
+    std::vector<source_packet> packets;
+    for (const auto& event : trace->get_events()) {
+        if (event.type != kvoice::trace_event_type::packet) continue;
+        packets.push_back({ event.has_capture_time ? event.capture_time : event.time,
+                            std::vector<std::uint8_t>(event.data, event.data + event.size) });
+    }
+    if (packets.empty()) return packets;
+
+    std::stable_sort(packets.begin(), packets.end(), [](const source_packet& lhs, const source_packet& rhs) {
+        return lhs.offset < rhs.offset;
+    });
+    const auto first = packets.front().offset;
+    for (auto& packet : packets)
+        packet.offset -= first;
+    return packets;
+}
+
+struct stream_result {
+    kvoice::stream_stats             stats{};
+    kvoice::network_impairment_stats network{};
+    std::vector<kvoice::timestamp_t> latencies{};
+};
+
+double get_percentile(std::vector<kvoice::timestamp_t>& values, double percentile) {
+    if (values.empty()) return 0.0;
+    const auto index = static_cast<std::size_t>(percentile * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return static_cast<double>(values[index]) / 1000.0;
+}
+}
+
+int main(int argc, char** argv) {
+    bench_options options;
+    if (!parse_args(argc, argv, options)) return 1;
+
+    std::vector<source_packet> packets;
+    try {
+        packets = options.trace_path.empty() ? encode_synthetic(options.duration) : load_trace(options.trace_path);
+    } catch (std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    if (packets.empty()) {
+        std::fprintf(stderr, "no packets to send\n");
+        return 1;
+    }
+
+    // every timestamp inside the library comes from the simulation
+    kvoice::set_clock_source(get_virtual_time);
+
+    kvoice::sound_output_options output_options;
+    output_options.loopback = true;
+    output_options.latency = options.latency;
+    auto [output, error_msg] = kvoice::create_sound_output("", kMixingRate, options.streams + 1, output_options);
+    if (!output) {
+        std::fprintf(stderr, "%s\n", error_msg.c_str());
+        return 1;
+    }
+    output->set_buffering_time(options.buffering_ms);
+
+    std::vector<std::unique_ptr<kvoice::stream>>     streams;
+    std::vector<kvoice::network_impairment>          networks;
+    std::vector<std::vector<kvoice::timestamp_t>>    latencies(options.streams);
+    for (std::uint32_t i = 0; i < options.streams; ++i) {
+        streams.push_back(output->create_stream(options.stream));
+
+        // every stream sees its own realization of the same conditions
+        auto network = options.network;
+        network.seed += i;
+        networks.emplace_back(network);
+    }
+
+    std::vector<float> mix(kRenderFrames * 2);
+    std::size_t        next_packet = 0;
+    auto               next_update = kStartTime;
+    const auto         end_time = kStartTime + packets.back().offset + options.network.base_delay + kTailTime;
+
+    const auto cpu_start = std::clock();
+
+    for (auto now = kStartTime; now < end_time; now += kRenderTime) {
+        virtual_time = now;
+
+        for (; next_packet < packets.size() && kStartTime + packets[next_packet].offset <= now; ++next_packet) {
+            const auto& packet = packets[next_packet];
+            for (auto& network : networks)
+                network.send(packet.data.data(), packet.data.size(), kStartTime + packet.offset);
+        }
+
+        for (std::size_t i = 0; i < streams.size(); ++i) {
+            auto* s = streams[i].get();
+            networks[i].deliver(now, [s](const std::uint8_t* data, std::size_t count, kvoice::timestamp_t send_time) {
+                s->push_opus_buffer(data, count, send_time);
+            });
+        }
+
+        if (now >= next_update) {
+            for (auto& s : streams)
+                s->update();
+            next_update += options.update_period;
+        }
+
+        output->render(mix.data(), kRenderFrames);
+
+        for (std::size_t i = 0; i < streams.size(); ++i) {
+            const auto latency = streams[i]->get_stats().mouth_to_ear_latency;
+            if (latency > 0) latencies[i].push_back(latency);
+        }
+    }
+
+    const double cpu_time = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    const double audio_time = static_cast<double>(end_time - kStartTime) / 1000000.0;
+
+    std::vector<stream_result> results(streams.size());
+    for (std::size_t i = 0; i < streams.size(); ++i) {
+        results[i].stats = streams[i]->get_stats();
+        results[i].network = networks[i].get_stats();
+        results[i].latencies = std::move(latencies[i]);
+    }
+
+    streams.clear();
+    output.reset();
+    kvoice::set_clock_source(nullptr);
+
+    std::printf("streams: %u, audio: %.1f s, packets: %zu\n", options.streams, audio_time, packets.size());
+    std::printf("%-6s %6s %6s %6s %6s %8s %8s %8s %9s %9s %8s\n", "stream", "lost", "dup", "reord", "drop",
+                "p50 ms", "p95 ms", "max ms", "underruns", "starve ms", "starve %");
+
+    double worst_p95 = 0.0;
+    double total_underrun_time = 0.0;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        auto&        result = results[i];
+        const double p50 = get_percentile(result.latencies, 0.5);
+        const double p95 = get_percentile(result.latencies, 0.95);
+        const double max = get_percentile(result.latencies, 1.0);
+        const double underrun_ms = static_cast<double>(result.stats.underrun_time) / 1000.0;
+
+        worst_p95 = std::max(worst_p95, p95);
+        total_underrun_time += underrun_ms;
+
+        std::printf("%-6zu %6llu %6llu %6llu %6llu %8.1f %8.1f %8.1f %9llu %9.0f %8.2f\n", i,
+                    static_cast<unsigned long long>(result.network.lost),
+                    static_cast<unsigned long long>(result.network.duplicated),
+                    static_cast<unsigned long long>(result.network.reordered),
+                    static_cast<unsigned long long>(result.stats.dropped_packets), p50, p95, max,
+                    static_cast<unsigned long long>(result.stats.underruns), underrun_ms,
+                    underrun_ms / (audio_time * 10.0));
+    }
+
+    std::printf("worst p95 latency: %.1f ms, mean starvation: %.2f%%\n", worst_p95,
+                total_underrun_time / results.size() / (audio_time * 10.0));
+    std::printf("cpu: %.3f s, per stream: %.3f%% of real time\n", cpu_time,
+                cpu_time / results.size() / audio_time * 100.0);
+}
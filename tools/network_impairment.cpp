@@ -0,0 +1,83 @@
+#include "network_impairment.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// tail index of Pareto jitter, finite variance
+constexpr double kParetoShape = 2.5;
+}
+
+kvoice::network_impairment::network_impairment(const network_impairment_options& options)
+    : options(options),
+      rng(options.seed) {
+}
+
+void kvoice::network_impairment::send(const std::uint8_t* data, std::size_t count, timestamp_t send_time) {
+    ++stats.sent;
+    if (is_lost()) {
+        ++stats.lost;
+        return;
+    }
+
+    schedule(data, count, send_time);
+    if (chance(rng) < options.duplicate) {
+        ++stats.duplicated;
+        schedule(data, count, send_time);
+    }
+}
+
+void kvoice::network_impairment::deliver(timestamp_t now, const std::function<on_packet_delivered_t>& cb) {
+    while (!packets.empty() && packets.front().arrival_time <= now) {
+        // packet is moved out before the callback, so it can send new packets
+        std::pop_heap(packets.begin(), packets.end(), later_arrival{});
+        auto top = std::move(packets.back());
+        packets.pop_back();
+
+        ++stats.delivered;
+        cb(top.data.data(), top.data.size(), top.send_time);
+    }
+}
+
+bool kvoice::network_impairment::is_lost() {
+    // state changes before the packet, so burst length is geometric with mean 1 / bad_to_good
+    if (bad_state ? chance(rng) < options.bad_to_good : chance(rng) < options.good_to_bad)
+        bad_state = !bad_state;
+
+    return chance(rng) < (bad_state ? options.loss_bad : options.loss_good);
+}
+
+kvoice::timestamp_t kvoice::network_impairment::get_delay() {
+    const auto mean = static_cast<double>(options.jitter_mean);
+    double     jitter = 0.0;
+
+    switch (options.jitter) {
+    case jitter_distribution::none:
+        break;
+    case jitter_distribution::uniform:
+        jitter = std::uniform_real_distribution<double>{ 0.0, 2.0 * mean }(rng);
+        break;
+    case jitter_distribution::normal:
+        jitter = std::normal_distribution<double>{ mean, static_cast<double>(options.jitter_stddev) }(rng);
+        break;
+    case jitter_distribution::pareto: {
+        // scale is chosen so the distribution has the requested mean
+        const double scale = mean * (kParetoShape - 1.0) / kParetoShape;
+        jitter = scale / std::pow(1.0 - chance(rng), 1.0 / kParetoShape);
+        break;
+    }
+    }
+
+    auto delay = options.base_delay + static_cast<timestamp_t>(std::max(jitter, 0.0));
+    if (chance(rng) < options.reorder) {
+        ++stats.reordered;
+        delay += options.reorder_delay;
+    }
+    return delay;
+}
+
+void kvoice::network_impairment::schedule(const std::uint8_t* data, std::size_t count, timestamp_t send_time) {
+    packets.push_back(packet{ send_time + get_delay(), next_sequence++, send_time,
+                              std::vector<std::uint8_t>(data, data + count) });
+    std::push_heap(packets.begin(), packets.end(), later_arrival{});
+}
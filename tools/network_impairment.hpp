@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "kvoice/kv_clock.hpp"
+
+namespace kvoice {
+/**
+ * @brief distribution of random delay added to every packet
+ */
+enum class jitter_distribution {
+    none,
+    /**
+     * @brief uniform in [0, 2 * mean]
+     */
+    uniform,
+    /**
+     * @brief normal with given mean and standard deviation, negative values are clamped to 0
+     */
+    normal,
+    /**
+     * @brief Pareto with given mean and shape 2.5, rare long delays like on congested links
+     */
+    pareto
+};
+
+/**
+ * @brief options of simulated network path
+ */
+struct network_impairment_options {
+    /**
+     * @brief one way delay of every packet
+     */
+    timestamp_t base_delay{ 20000 };
+
+    /**
+     * @brief probability of moving from good to bad state of Gilbert-Elliott channel per packet
+     */
+    double good_to_bad{ 0.0 };
+    /**
+     * @brief probability of moving from bad to good state of Gilbert-Elliott channel per packet
+     */
+    double bad_to_good{ 1.0 };
+    /**
+     * @brief loss probability in good state
+     */
+    double loss_good{ 0.0 };
+    /**
+     * @brief loss probability in bad state
+     */
+    double loss_bad{ 1.0 };
+
+    jitter_distribution jitter{ jitter_distribution::none };
+    timestamp_t         jitter_mean{ 0 };
+    timestamp_t         jitter_stddev{ 0 };
+
+    /**
+     * @brief probability of holding packet back, so the following packets overtake it
+     */
+    double      reorder{ 0.0 };
+    timestamp_t reorder_delay{ 40000 };
+
+    /**
+     * @brief probability of delivering packet twice, the copy has its own jitter
+     */
+    double duplicate{ 0.0 };
+
+    std::uint32_t seed{ 1 };
+};
+
+/**
+ * @brief counters of simulated network path
+ */
+struct network_impairment_stats {
+    std::uint64_t sent{ 0 };
+    std::uint64_t lost{ 0 };
+    std::uint64_t duplicated{ 0 };
+    std::uint64_t reordered{ 0 };
+    std::uint64_t delivered{ 0 };
+};
+
+/**
+ * @brief deterministic simulation of lossy network path between packet source and @p stream::push_opus_buffer
+ * @details packets are held until their arrival time, random decisions depend only on the seed
+ */
+class network_impairment {
+public:
+    /**
+     * @brief type of callback, that receives delivered packet
+     * @param data packet data
+     * @param count size of @p data
+     * @param send_time time the packet was sent at
+     */
+    using on_packet_delivered_t = void(const std::uint8_t* data, std::size_t count, timestamp_t send_time);
+
+    explicit network_impairment(const network_impairment_options& options);
+
+    /**
+     * @brief sends packet through the path
+     * @param data packet data
+     * @param count size of @p data
+     * @param send_time current time
+     */
+    void send(const std::uint8_t* data, std::size_t count, timestamp_t send_time);
+
+    /**
+     * @brief delivers packets, that arrived before @p now, in arrival order
+     * @param now current time
+     * @param cb receiver of packets
+     */
+    void deliver(timestamp_t now, const std::function<on_packet_delivered_t>& cb);
+
+    /**
+     * @brief returns true if packets are still in flight
+     */
+    [[nodiscard]] bool in_flight() const noexcept { return !packets.empty(); }
+
+    [[nodiscard]] const network_impairment_stats& get_stats() const noexcept { return stats; }
+
+private:
+    struct packet {
+        timestamp_t               arrival_time;
+        // keeps send order of packets with the same arrival time
+        std::uint64_t             sequence;
+        timestamp_t               send_time;
+        std::vector<std::uint8_t> data;
+    };
+
+    struct later_arrival {
+        bool operator()(const packet& lhs, const packet& rhs) const noexcept {
+            return lhs.arrival_time != rhs.arrival_time ? lhs.arrival_time > rhs.arrival_time
+                                                        : lhs.sequence > rhs.sequence;
+        }
+    };
+
+    bool        is_lost();
+    timestamp_t get_delay();
+    void        schedule(const std::uint8_t* data, std::size_t count, timestamp_t send_time);
+
+    network_impairment_options options;
+    network_impairment_stats   stats{};
+
+    std::mt19937                           rng;
+    std::uniform_real_distribution<double> chance{ 0.0, 1.0 };
+    bool                                   bad_state{ false };
+    std::uint64_t                          next_sequence{ 0 };
+    // min-heap by arrival time
+    std::vector<packet>                    packets{};
+};
+}
@@ -0,0 +1,158 @@
+// replays packet trace through loopback output with the recorded arrival and update timing
+// usage: kvoice-replay <trace file> [--speed <factor>], speed 0 replays as fast as possible
+
+#include "kvoice/kvoice.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace {
+// frames mixed by one render call, 5 ms at 48 kHz
+constexpr std::uint32_t kRenderFrames = 240;
+// audio rendered after the last event, so buffered packets are played out
+constexpr kvoice::timestamp_t kTailTime = 2000000;
+
+// virtual clock of the library, advanced by rendered audio and events
+std::atomic<kvoice::timestamp_t> virtual_time{ 0 };
+
+kvoice::timestamp_t get_virtual_time() noexcept {
+    return virtual_time.load(std::memory_order_relaxed);
+}
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <trace file> [--speed <factor>]\n", argv[0]);
+        return 1;
+    }
+
+    double speed = 0.0;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc)
+            speed = std::atof(argv[++i]);
+    }
+
+    std::unique_ptr<kvoice::packet_trace> trace;
+    try {
+        trace = kvoice::open_packet_trace(argv[1]);
+    } catch (std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    const auto& info = trace->get_info();
+    const auto& events = trace->get_events();
+    if (events.empty()) {
+        std::fprintf(stderr, "trace is empty\n");
+        return 1;
+    }
+
+    // every timestamp inside the library comes from trace time now
+    const auto start_time = events.front().time;
+    virtual_time = start_time;
+    kvoice::set_clock_source(get_virtual_time);
+
+    kvoice::sound_output_options output_options;
+    output_options.loopback = true;
+    auto [output, error_msg] = kvoice::create_sound_output("", info.mixing_rate, 16, output_options);
+    if (!output) {
+        std::fprintf(stderr, "%s\n", error_msg.c_str());
+        return 1;
+    }
+
+    kvoice::stream_options options;
+    options.decode_sample_rate = info.decode_sample_rate;
+    options.mode = info.mode;
+    options.format = info.format;
+    auto stream = output->create_stream(options);
+
+    std::vector<float>  mix(kRenderFrames * 2);
+    std::uint64_t       rendered_frames = 0;
+    std::uint64_t       packets = 0;
+    std::uint64_t       rejected_packets = 0;
+    kvoice::timestamp_t max_latency = 0;
+    double              latency_sum = 0.0;
+    std::uint64_t       latency_count = 0;
+
+    const auto wall_start = std::chrono::steady_clock::now();
+    const auto cpu_start = std::clock();
+
+    const auto rendered_time = [&]() {
+        return start_time + kvoice::samples_to_timestamp(static_cast<std::int64_t>(rendered_frames), info.mixing_rate);
+    };
+
+    // mixes audio up to the given time and samples latency after every block
+    const auto render_until = [&](kvoice::timestamp_t time) {
+        while (rendered_time() + kvoice::samples_to_timestamp(kRenderFrames, info.mixing_rate) <= time) {
+            output->render(mix.data(), kRenderFrames);
+            rendered_frames += kRenderFrames;
+            virtual_time = rendered_time();
+
+            const auto latency = stream->get_stats().mouth_to_ear_latency;
+            if (latency > 0) {
+                max_latency = std::max(max_latency, latency);
+                latency_sum += static_cast<double>(latency);
+                ++latency_count;
+            }
+
+            if (speed > 0.0) {
+                const auto elapsed = std::chrono::microseconds{
+                    static_cast<std::int64_t>(static_cast<double>(virtual_time - start_time) / speed) };
+                std::this_thread::sleep_until(wall_start + elapsed);
+            }
+        }
+    };
+
+    for (const auto& event : events) {
+        render_until(event.time);
+        virtual_time = std::max(event.time, rendered_time());
+
+        if (event.type == kvoice::trace_event_type::update) {
+            stream->update();
+            continue;
+        }
+
+        ++packets;
+        const bool accepted = event.has_capture_time
+                                  ? stream->push_opus_buffer(event.data, event.size, event.capture_time)
+                                  : stream->push_opus_buffer(event.data, event.size);
+        if (!accepted) ++rejected_packets;
+    }
+
+    // stream isn't updated by the trace anymore, so the tail is updated every block
+    const auto end_time = events.back().time + kTailTime;
+    while (rendered_time() < end_time) {
+        render_until(rendered_time() + kvoice::samples_to_timestamp(kRenderFrames, info.mixing_rate));
+        stream->update();
+    }
+
+    const double cpu_time = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    const double audio_time = static_cast<double>(rendered_frames) / info.mixing_rate;
+    const auto   stats = stream->get_stats();
+
+    std::printf("audio: %.2f s, cpu: %.3f s(%.2f%% of real time)\n", audio_time, cpu_time,
+                audio_time > 0.0 ? cpu_time / audio_time * 100.0 : 0.0);
+    std::printf("packets: %llu, rejected: %llu, dropped: %llu, dtx: %llu, underruns: %llu\n",
+                static_cast<unsigned long long>(packets), static_cast<unsigned long long>(rejected_packets),
+                static_cast<unsigned long long>(stats.dropped_packets),
+                static_cast<unsigned long long>(stats.dtx_packets),
+                static_cast<unsigned long long>(stats.underruns));
+    if (latency_count) {
+        std::printf("mouth-to-ear latency: avg %.1f ms, max %.1f ms\n", latency_sum / latency_count / 1000.0,
+                    static_cast<double>(max_latency) / 1000.0);
+    } else {
+        std::printf("mouth-to-ear latency: unknown(trace has no capture times)\n");
+    }
+
+    stream.reset();
+    output.reset();
+    kvoice::set_clock_source(nullptr);
+}